@@ -17,6 +17,10 @@
 #define DEFAULT_RAM_PROFILE             kRamProfileServer
 
 #define DEFAULT_MTU_PROFILE             1500
+#define MAX_BUSY_POLL_US                10000
+#define DEFAULT_POOL_PURGE_IDLE_SEC     60
+#define MAX_BUFFER_ARENA_MB             65536
+#define MAX_ACCEPT_BUDGET               1024
 
 enum settings_ram_profiles
 {
@@ -171,6 +175,53 @@ static void parseConfigPartOfJson(const cJSON *config_array)
     }
 }
 
+static uint32_t parseBusyPollBudget(const cJSON *budget_obj)
+{
+    if (! cJSON_IsNumber(budget_obj) || budget_obj->valueint < 0 || budget_obj->valueint > MAX_BUSY_POLL_US)
+    {
+        printError("CoreSettings: busy-poll must be a number of microseconds in range [0 - %d]\n", MAX_BUSY_POLL_US);
+        terminateProgram(1);
+    }
+    return (uint32_t) budget_obj->valueint;
+}
+
+// "busy-poll": 50 spins every worker for up to 50us, "busy-poll": [50, 0] only the first one
+static void parseBusyPoll(const cJSON *busy_poll_obj)
+{
+    if (busy_poll_obj == NULL)
+    {
+        return;
+    }
+    settings->busy_poll_us = memoryAllocate(sizeof(uint32_t) * settings->workers_count);
+    memorySet(settings->busy_poll_us, 0, sizeof(uint32_t) * settings->workers_count);
+
+    if (cJSON_IsArray(busy_poll_obj))
+    {
+        if ((unsigned int) cJSON_GetArraySize(busy_poll_obj) > settings->workers_count)
+        {
+            printError("CoreSettings: busy-poll has more entries than workers, extra entries are ignored\n");
+        }
+        unsigned int wid         = 0;
+        const cJSON *budget_obj = NULL;
+        cJSON_ArrayForEach(budget_obj, busy_poll_obj)
+        {
+            if (wid >= settings->workers_count)
+            {
+                break;
+            }
+            settings->busy_poll_us[wid++] = parseBusyPollBudget(budget_obj);
+        }
+    }
+    else
+    {
+        uint32_t budget_us = parseBusyPollBudget(busy_poll_obj);
+        for (unsigned int wid = 0; wid < settings->workers_count; wid++)
+        {
+            settings->busy_poll_us[wid] = budget_us;
+        }
+    }
+}
+
 static void parseMiscPartOfJson(cJSON *misc_obj)
 {
     if (cJSON_IsObject(misc_obj) && (misc_obj->child != NULL))
@@ -195,6 +246,38 @@ static void parseMiscPartOfJson(cJSON *misc_obj)
             settings->workers_count = (unsigned int) getNCPU();
         }
 
+        parseBusyPoll(cJSON_GetObjectItemCaseSensitive(misc_obj, "busy-poll"));
+
+        int purge_idle_sec = DEFAULT_POOL_PURGE_IDLE_SEC;
+        getIntFromJsonObjectOrDefault(&purge_idle_sec, misc_obj, "pool-purge-idle", DEFAULT_POOL_PURGE_IDLE_SEC);
+        if (purge_idle_sec < 0)
+        {
+            printError("CoreSettings: pool-purge-idle must be a number of seconds (0 = never), using default value %d\n",
+                       DEFAULT_POOL_PURGE_IDLE_SEC);
+            purge_idle_sec = DEFAULT_POOL_PURGE_IDLE_SEC;
+        }
+        settings->pool_purge_idle_ms = (uint32_t) purge_idle_sec * 1000;
+
+        int arena_mb = 0;
+        getIntFromJsonObjectOrDefault(&arena_mb, misc_obj, "hugepage-arena", 0);
+        if (arena_mb < 0 || arena_mb > MAX_BUFFER_ARENA_MB)
+        {
+            printError("CoreSettings: hugepage-arena must be a number of megabytes per worker in range [0 - %d]\n",
+                       MAX_BUFFER_ARENA_MB);
+            terminateProgram(1);
+        }
+        settings->buffer_arena_mb = (uint32_t) arena_mb;
+
+        int accept_budget = 0;
+        getIntFromJsonObjectOrDefault(&accept_budget, misc_obj, "accept-budget", 0);
+        if (accept_budget < 0 || accept_budget > MAX_ACCEPT_BUDGET)
+        {
+            printError("CoreSettings: accept-budget must be a number of connections per event in range [0 - %d]\n",
+                       MAX_ACCEPT_BUDGET);
+            terminateProgram(1);
+        }
+        settings->accept_budget = (uint32_t) accept_budget;
+
         const cJSON *json_ram_profile = cJSON_GetObjectItemCaseSensitive(misc_obj, "ram-profile");
         if (cJSON_IsNumber(json_ram_profile))
         {
@@ -267,7 +350,8 @@ static void parseMiscPartOfJson(cJSON *misc_obj)
     else
     {
         settings->libs_path     = stringDuplicate(DEFAULT_LIBS_PATH);
-        settings->workers_count = (unsigned int) getNCPU();
+        settings->workers_count      = (unsigned int) getNCPU();
+        settings->pool_purge_idle_ms = DEFAULT_POOL_PURGE_IDLE_SEC * 1000;
         printf("misc block unspecified in json, using defaults. cpu cores: %d\n", settings->workers_count);
     }
 }
@@ -336,6 +420,10 @@ void destroyCoreSettings(void)
     memoryFree(settings->dns_log_file);
     memoryFree(settings->dns_log_level);
     memoryFree(settings->libs_path);
+    if (settings->busy_poll_us)
+    {
+        memoryFree(settings->busy_poll_us);
+    }
 
     // Free full paths
     memoryFree(settings->internal_log_file_fullpath);
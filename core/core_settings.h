@@ -36,6 +36,10 @@ struct core_settings_s
     char        *libs_path;
 
     uint16_t mtu_size;
+    uint32_t *busy_poll_us; // per worker spin budget, NULL when busy polling is off
+    uint32_t pool_purge_idle_ms; // idle time before pooled memory goes back to the os, 0 = never
+    uint32_t buffer_arena_mb;    // per worker hugepage arena for large buffers, 0 = off
+    uint32_t accept_budget;      // connections a listener accepts per event, 0 = event loop default
     vec_config_path_t config_paths;
 };
 
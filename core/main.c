@@ -47,9 +47,13 @@ int main(void)
     createDirIfNotExists(getCoreSettings()->log_path);
 
     ww_construction_data_t runtime_data = {
-        .workers_count = getCoreSettings()->workers_count,
-        .ram_profile   = getCoreSettings()->ram_profile,
-        .mtu_size      = getCoreSettings()->mtu_size,
+        .workers_count      = getCoreSettings()->workers_count,
+        .ram_profile        = getCoreSettings()->ram_profile,
+        .mtu_size           = getCoreSettings()->mtu_size,
+        .busy_poll_us       = getCoreSettings()->busy_poll_us,
+        .pool_purge_idle_ms = getCoreSettings()->pool_purge_idle_ms,
+        .buffer_arena_mb    = getCoreSettings()->buffer_arena_mb,
+        .accept_budget      = getCoreSettings()->accept_budget,
         .internal_logger_data =
             (logger_construction_data_t) {.log_file_path = getCoreSettings()->internal_log_file_fullpath,
                                           .log_level     = getCoreSettings()->internal_log_level,
@@ -0,0 +1,98 @@
+// connections/sec a listener accepts during a connection storm, for a few accept budgets
+// built by the bench_accept_storm target, configure with -DWW_BUILD_BENCHMARKS=ON
+//
+// client threads connect to a loopback listener as fast as they can (the handshake completes in the kernel, so
+// they easily outrun the accepting loop) and reset each connection right away; the loop accepts and closes them.
+// a listener that falls behind lets the backlog overflow, the dropped SYNs come back a second later and show up as
+// a collapse of the rate. budget 3 is the old fixed batch; on linux every budget also grows while the backlog is
+// filling up, see wloopSetAcceptBudget
+
+#include "buffer_pool.h"
+#include "loggers/internal_logger.h"
+#include "master_pool.h"
+#include "wloop.h"
+#include "wsocket.h"
+#include "wthread.h"
+#include "wtime.h"
+
+#include <stdio.h>
+
+#define CLIENT_THREADS      4
+#define CONNECTS_PER_CLIENT 20000
+
+static sockaddr_u listen_addr;
+static uint64_t   accepted;
+
+static WTHREAD_ROUTINE(clientThread)
+{
+    discard userdata;
+    struct linger reset = {.l_onoff = 1, .l_linger = 0};
+
+    for (int i = 0; i < CONNECTS_PER_CLIENT; ++i)
+    {
+        int fd = (int) socket(AF_INET, SOCK_STREAM, 0);
+        // NOTE: closing with a reset keeps the ephemeral ports out of TIME_WAIT
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, (const char *) &reset, sizeof(reset));
+        if (connect(fd, &listen_addr.sa, sockaddrLen(&listen_addr)) != 0)
+        {
+            printf("connect failed: %s\n", socketStrError(socketERRNO()));
+            closesocket(fd);
+            break;
+        }
+        closesocket(fd);
+    }
+    return 0;
+}
+
+static void onAccept(wio_t *io)
+{
+    wioClose(io);
+    if (++accepted == (uint64_t) CLIENT_THREADS * CONNECTS_PER_CLIENT)
+    {
+        wloopStop(weventGetLoop(io));
+    }
+}
+
+static void benchStorm(buffer_pool_t *pool, uint32_t budget)
+{
+    wloop_t *loop = wloopCreate(WLOOP_FLAG_AUTO_FREE, pool, 0);
+    wloopSetAcceptBudget(loop, budget);
+
+    wio_t    *listener = wloopCreateTcpServer(loop, "127.0.0.1", 0, onAccept);
+    socklen_t len      = sizeof(listen_addr);
+    getsockname(wioGetFD(listener), &listen_addr.sa, &len); // the listener keeps the requested port 0
+    accepted = 0;
+
+    wthread_t clients[CLIENT_THREADS];
+    uint64_t  start = getHRTimeUs();
+    for (int i = 0; i < CLIENT_THREADS; ++i)
+    {
+        clients[i] = threadCreate(clientThread, NULL);
+    }
+    wloopRun(loop);
+    for (int i = 0; i < CLIENT_THREADS; ++i)
+    {
+        threadJoin(clients[i]);
+    }
+    double secs = (double) (getHRTimeUs() - start) / 1e6;
+
+    printf("budget=%-4u connections=%llu time=%.3fs rate=%.0f cps\n", budget, (unsigned long long) accepted, secs,
+           (double) accepted / secs);
+}
+
+int main(void)
+{
+    createInternalLogger(NULL, true);
+    setInternalLoggerLevelByStr("ERROR");
+
+    master_pool_t *mp_large = masterpoolCreateWithCapacity(64);
+    master_pool_t *mp_small = masterpoolCreateWithCapacity(64);
+    buffer_pool_t *pool     = bufferpoolCreate(mp_large, mp_small, 64, 4096, 1500);
+
+    const uint32_t budgets[] = {3, 16, 64, 256};
+    for (size_t i = 0; i < ARRAY_SIZE(budgets); ++i)
+    {
+        benchStorm(pool, budgets[i]);
+    }
+    return 0;
+}
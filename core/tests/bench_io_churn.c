@@ -0,0 +1,149 @@
+// connections/sec through the accept -> hand off -> close path, with the loop slabs and with WLOOP_FLAG_NO_SLAB
+// built by the bench_io_churn target, configure with -DWW_BUILD_BENCHMARKS=ON
+//
+// like the socket manager, an acceptor loop detaches every accepted io and posts it to a worker loop, which
+// attaches it, arms a read timeout and closes it when the client resets. so each connection allocates a wio on
+// the acceptor, frees the previous wio of that fd on the worker and adds and deletes a timer. event_allocs counts
+// the allocations that went through the event layer allocator during the run
+
+#include "buffer_pool.h"
+#include "ev_memory.h"
+#include "loggers/internal_logger.h"
+#include "master_pool.h"
+#include "wloop.h"
+#include "wsocket.h"
+#include "wthread.h"
+#include "wtime.h"
+#include "worker.h"
+
+#include <stdio.h>
+
+#define CLIENT_THREADS      2 // more clients than cores pile up handed off fds faster than the worker closes them
+#define CONNECTS_PER_CLIENT 20000
+#define TOTAL_CONNECTS      ((uint64_t) CLIENT_THREADS * CONNECTS_PER_CLIENT)
+
+static sockaddr_u listen_addr;
+static wloop_t   *acceptor_loop;
+static wloop_t   *worker_loop;
+static uint64_t   closed;
+
+static WTHREAD_ROUTINE(clientThread)
+{
+    discard userdata;
+    struct linger reset = {.l_onoff = 1, .l_linger = 0};
+
+    for (int i = 0; i < CONNECTS_PER_CLIENT; ++i)
+    {
+        int fd = (int) socket(AF_INET, SOCK_STREAM, 0);
+        // NOTE: closing with a reset keeps the ephemeral ports out of TIME_WAIT
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, (const char *) &reset, sizeof(reset));
+        if (connect(fd, &listen_addr.sa, sockaddrLen(&listen_addr)) != 0)
+        {
+            printf("connect failed: %s\n", socketStrError(socketERRNO()));
+        }
+        closesocket(fd);
+    }
+    return 0;
+}
+
+static WTHREAD_ROUTINE(workerThread)
+{
+    discard userdata;
+    tl_wid = 1;
+    wloopRun(worker_loop);
+    return 0;
+}
+
+static void onStop(wevent_t *ev)
+{
+    wloopStop(ev->loop);
+}
+
+static void onRead(wio_t *io, sbuf_t *buf)
+{
+    bufferpoolReuseBuffer(wloopGetBufferPool(weventGetLoop(io)), buf);
+}
+
+static void onClose(wio_t *io)
+{
+    if (++closed == TOTAL_CONNECTS)
+    {
+        wevent_t ev;
+        memorySet(&ev, 0, sizeof(wevent_t));
+        ev.event_type = (wevent_type_e) (WEVENT_TYPE_CUSTOM + 1);
+        ev.cb         = onStop;
+        wloopPostEvent(acceptor_loop, &ev);
+        wloopStop(weventGetLoop(io));
+    }
+}
+
+static void onHandOff(wevent_t *ev)
+{
+    wio_t *io = weventGetUserdata(ev);
+    wioAttach(ev->loop, io);
+    wioSetCallBackRead(io, onRead);
+    wioSetCallBackClose(io, onClose);
+    wioSetReadTimeout(io, 30000);
+    wioRead(io);
+}
+
+static void onAccept(wio_t *io)
+{
+    wioDetach(io);
+
+    wevent_t ev;
+    memorySet(&ev, 0, sizeof(wevent_t));
+    ev.event_type = (wevent_type_e) (WEVENT_TYPE_CUSTOM + 1);
+    ev.cb         = onHandOff;
+    ev.userdata   = io;
+    wloopPostEvent(worker_loop, &ev);
+}
+
+static void benchChurn(const char *name, master_pool_t *mp_large, master_pool_t *mp_small, int flags)
+{
+    // NOTE: a buffer pool belongs to the first thread that uses it, the worker thread is new on every run
+    buffer_pool_t *acceptor_pool = bufferpoolCreate(mp_large, mp_small, 64, 4096, 1500);
+    buffer_pool_t *worker_pool   = bufferpoolCreate(mp_large, mp_small, 64, 4096, 1500);
+
+    acceptor_loop = wloopCreate(WLOOP_FLAG_AUTO_FREE | flags, acceptor_pool, 0);
+    worker_loop   = wloopCreate(WLOOP_FLAG_AUTO_FREE | flags, worker_pool, 1);
+    closed        = 0;
+
+    wio_t    *listener = wloopCreateTcpServer(acceptor_loop, "127.0.0.1", 0, onAccept);
+    socklen_t len      = sizeof(listen_addr);
+    getsockname(wioGetFD(listener), &listen_addr.sa, &len); // the listener keeps the requested port 0
+
+    long      allocs_before = eventloopAllocCount();
+    uint64_t  start         = getHRTimeUs();
+    wthread_t worker        = threadCreate(workerThread, NULL);
+    wthread_t clients[CLIENT_THREADS];
+    for (int i = 0; i < CLIENT_THREADS; ++i)
+    {
+        clients[i] = threadCreate(clientThread, NULL);
+    }
+    wloopRun(acceptor_loop);
+    for (int i = 0; i < CLIENT_THREADS; ++i)
+    {
+        threadJoin(clients[i]);
+    }
+    threadJoin(worker);
+    double secs = (double) (getHRTimeUs() - start) / 1e6;
+
+    printf("%-7s connections=%llu time=%.3fs rate=%.0f cps event_allocs=%ld\n", name, (unsigned long long) closed,
+           secs, (double) closed / secs, eventloopAllocCount() - allocs_before);
+    bufferpoolDestroy(acceptor_pool);
+    bufferpoolDestroy(worker_pool);
+}
+
+int main(void)
+{
+    createInternalLogger(NULL, true);
+    setInternalLoggerLevelByStr("ERROR");
+
+    master_pool_t *mp_large = masterpoolCreateWithCapacity(64);
+    master_pool_t *mp_small = masterpoolCreateWithCapacity(64);
+
+    benchChurn("malloc", mp_large, mp_small, WLOOP_FLAG_NO_SLAB);
+    benchChurn("slab", mp_large, mp_small, 0);
+    return 0;
+}
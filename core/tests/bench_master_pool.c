@@ -0,0 +1,167 @@
+// buffers/sec migrating between workers through the master pools, mutex pool vs lock-free pool
+// built by the bench_master_pool target, configure with -DWW_BUILD_BENCHMARKS=ON
+//
+// every pair of threads is a producer worker that takes buffers from its own buffer pool and a consumer worker
+// that gives them back to its own pool, like a tunnel that reads on one worker and writes on another;
+// the producer pool keeps running dry and the consumer pool keeps overflowing, so every refill and every
+// drain goes through the shared master pool. the handoff between the two threads is the same ring for both runs
+//
+// every buffer also carries a tag while it is in flight: the producer marks it owned by its pair and numbers it,
+// the consumer checks that it gets every number of its pair once and in order, then clears the mark. a buffer
+// that a master pool hands out twice is still marked when the second producer gets it, a lost or duplicated
+// handoff breaks the numbering. any of these makes the bench exit with 1
+
+#include "buffer_pool.h"
+#include "loggers/internal_logger.h"
+#include "master_pool.h"
+#include "wmutex.h"
+#include "wthread.h"
+#include "wtime.h"
+
+#include <stdio.h>
+
+#define MIGRATED_BUFFERS (1U << 21)
+#define HANDOFF_CAPACITY 1024
+#define POOL_BUFCOUNT    64
+#define MAX_PAIRS        4
+#define OWNED_MAGIC      0x5757f00dbeef0000ULL
+
+typedef struct item_tag_s
+{
+    uint64_t owner; // OWNED_MAGIC | pair while in flight, 0 once consumed
+    uint64_t seq;
+
+} item_tag_t;
+
+typedef struct pair_arg_s
+{
+    master_pool_t     *mp_large;
+    master_pool_t     *mp_small;
+    master_pool_ring_t handoff;
+    uint64_t           count;
+    uint64_t           pair;
+    uint64_t           consumed;
+    uint64_t           double_owned; // written by the producer only
+    uint64_t           misordered;   // written by the consumer only
+
+} pair_arg_t;
+
+static buffer_pool_t *createThreadPool(pair_arg_t *arg)
+{
+    return bufferpoolCreate(arg->mp_large, arg->mp_small, POOL_BUFCOUNT, 4096, 1500);
+}
+
+static WTHREAD_ROUTINE(producerThread)
+{
+    pair_arg_t    *arg  = userdata;
+    buffer_pool_t *pool = createThreadPool(arg);
+
+    for (uint64_t i = 0; i < arg->count; ++i)
+    {
+        sbuf_t     *b   = bufferpoolGetLargeBuffer(pool);
+        item_tag_t *tag = (item_tag_t *) sbufGetMutablePtr(b);
+        if ((tag->owner & ~(uint64_t) 0xFFFF) == OWNED_MAGIC)
+        {
+            arg->double_owned++;
+        }
+        *tag = (item_tag_t) {.owner = OWNED_MAGIC | arg->pair, .seq = i};
+        while (! masterpoolringPush(&arg->handoff, b))
+        {
+            YIELD_THREAD();
+        }
+    }
+    bufferpoolDestroy(pool);
+    return 0;
+}
+
+static WTHREAD_ROUTINE(consumerThread)
+{
+    pair_arg_t    *arg  = userdata;
+    buffer_pool_t *pool = createThreadPool(arg);
+
+    for (uint64_t i = 0; i < arg->count; ++i)
+    {
+        sbuf_t *b;
+        while ((b = masterpoolringPop(&arg->handoff)) == NULL)
+        {
+            YIELD_THREAD();
+        }
+        item_tag_t *tag = (item_tag_t *) sbufGetMutablePtr(b);
+        if (tag->owner != (OWNED_MAGIC | arg->pair) || tag->seq != i)
+        {
+            arg->misordered++;
+        }
+        tag->owner = 0;
+        arg->consumed++;
+        bufferpoolReuseBuffer(pool, b);
+    }
+    bufferpoolDestroy(pool);
+    return 0;
+}
+
+static bool benchMigration(const char *name, master_pool_t *(*create)(uint32_t), int npairs)
+{
+    wthread_t  producers[MAX_PAIRS];
+    wthread_t  consumers[MAX_PAIRS];
+    pair_arg_t args[MAX_PAIRS];
+
+    master_pool_t *mp_large = create(64);
+    master_pool_t *mp_small = create(64);
+    uint64_t       per_pair = MIGRATED_BUFFERS / (uint64_t) npairs;
+    uint64_t       total    = per_pair * (uint64_t) npairs;
+
+    uint64_t start = getHRTimeUs();
+    for (int i = 0; i < npairs; ++i)
+    {
+        args[i] = (pair_arg_t) {.mp_large = mp_large, .mp_small = mp_small, .count = per_pair, .pair = (uint64_t) i};
+        masterpoolringInit(&args[i].handoff, HANDOFF_CAPACITY);
+        producers[i] = threadCreate(producerThread, &args[i]);
+        consumers[i] = threadCreate(consumerThread, &args[i]);
+    }
+    for (int i = 0; i < npairs; ++i)
+    {
+        threadJoin(producers[i]);
+        threadJoin(consumers[i]);
+        masterpoolringDeInit(&args[i].handoff);
+    }
+    double secs = (double) (getHRTimeUs() - start) / 1e6;
+    printf("%-9s pairs=%d buffers=%llu time=%.3fs rate=%.2fM buf/s\n", name, npairs, (unsigned long long) total,
+           secs, (double) total / secs / 1e6);
+
+    bool ok = true;
+    for (int i = 0; i < npairs; ++i)
+    {
+        if (args[i].consumed != per_pair || args[i].double_owned != 0 || args[i].misordered != 0)
+        {
+            printf("%-9s pair %d: consumed=%llu of %llu double_owned=%llu misordered=%llu\n", name, i,
+                   (unsigned long long) args[i].consumed, (unsigned long long) per_pair,
+                   (unsigned long long) args[i].double_owned, (unsigned long long) args[i].misordered);
+            ok = false;
+        }
+    }
+
+    // buffer pools destroyed their buffers, whatever went back to the master pools is freed here
+    masterpoolMakeEmpty(mp_large, NULL);
+    masterpoolMakeEmpty(mp_small, NULL);
+    masterpoolDestroy(mp_large);
+    masterpoolDestroy(mp_small);
+    return ok;
+}
+
+int main(void)
+{
+    createInternalLogger(NULL, true);
+    setInternalLoggerLevelByStr("ERROR");
+
+    bool ok = true;
+    for (int npairs = 1; npairs <= MAX_PAIRS; npairs *= 2)
+    {
+        ok = benchMigration("mutex", masterpoolCreateWithCapacity, npairs) && ok;
+        ok = benchMigration("lockfree", masterpoolCreateWithCapacityLockFree, npairs) && ok;
+    }
+    if (! ok)
+    {
+        printf("items were lost or duplicated\n");
+    }
+    return ok ? 0 : 1;
+}
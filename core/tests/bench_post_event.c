@@ -0,0 +1,125 @@
+// messages/sec through wloopPostEvent between worker threads
+// built by the bench_post_event target, configure with -DWW_BUILD_BENCHMARKS=ON
+// run it on two revisions to compare the post path
+
+#include "buffer_pool.h"
+#include "loggers/internal_logger.h"
+#include "master_pool.h"
+#include "wloop.h"
+#include "worker.h"
+#include "wthread.h"
+#include "wtime.h"
+
+#include <stdio.h>
+
+#define STREAM_MESSAGES   (1U << 22)
+#define PINGPONG_MESSAGES (1U << 17)
+#define MAX_PRODUCERS     8
+
+static atomic_uint_fast64_t consumed;
+static wloop_t             *consumer_loop;
+
+static void onMessage(wevent_t *ev)
+{
+    discard ev;
+    atomic_fetch_add_explicit(&consumed, 1, memory_order_release);
+}
+
+static WTHREAD_ROUTINE(consumerThread)
+{
+    discard userdata;
+    tl_wid = 1;
+    wloopRun(consumer_loop);
+    return 0;
+}
+
+typedef struct producer_arg_s
+{
+    uint64_t count;
+    wid_t    wid;
+} producer_arg_t;
+
+static WTHREAD_ROUTINE(producerThread)
+{
+    producer_arg_t *arg = userdata;
+    tl_wid              = arg->wid;
+    for (uint64_t i = 0; i < arg->count; ++i)
+    {
+        wevent_t ev = (wevent_t) {.loop = consumer_loop, .cb = onMessage};
+        wloopPostEvent(consumer_loop, &ev);
+    }
+    return 0;
+}
+
+static void waitConsumed(uint64_t total)
+{
+    while (atomic_load_explicit(&consumed, memory_order_acquire) < total)
+    {
+        ;
+    }
+}
+
+static void benchStream(int nproducers)
+{
+    wthread_t      threads[MAX_PRODUCERS];
+    producer_arg_t args[MAX_PRODUCERS];
+    uint64_t       per_producer = STREAM_MESSAGES / (uint64_t) nproducers;
+    uint64_t       total        = per_producer * (uint64_t) nproducers;
+
+    atomic_store(&consumed, 0);
+    uint64_t start = getHRTimeUs();
+    for (int i = 0; i < nproducers; ++i)
+    {
+        args[i]    = (producer_arg_t) {.count = per_producer, .wid = (wid_t) (2 + i)};
+        threads[i] = threadCreate(producerThread, &args[i]);
+    }
+    for (int i = 0; i < nproducers; ++i)
+    {
+        threadJoin(threads[i]);
+    }
+    waitConsumed(total);
+    double secs = (double) (getHRTimeUs() - start) / 1e6;
+    printf("stream    producers=%d messages=%llu time=%.3fs rate=%.2fM msg/s\n", nproducers,
+           (unsigned long long) total, secs, (double) total / secs / 1e6);
+}
+
+// one message in flight at a time, every post finds the consumer asleep or about to sleep
+static void benchPingPong(void)
+{
+    atomic_store(&consumed, 0);
+    uint64_t start = getHRTimeUs();
+    for (uint64_t i = 0; i < PINGPONG_MESSAGES; ++i)
+    {
+        wevent_t ev = (wevent_t) {.loop = consumer_loop, .cb = onMessage};
+        wloopPostEvent(consumer_loop, &ev);
+        waitConsumed(i + 1);
+    }
+    double secs = (double) (getHRTimeUs() - start) / 1e6;
+    printf("pingpong  messages=%u time=%.3fs rate=%.2fK msg/s latency=%.2fus\n", PINGPONG_MESSAGES, secs,
+           (double) PINGPONG_MESSAGES / secs / 1e3, secs * 1e6 / (double) PINGPONG_MESSAGES);
+}
+
+int main(void)
+{
+    createInternalLogger(NULL, true);
+    setInternalLoggerLevelByStr("ERROR");
+
+    master_pool_t *mp_large = masterpoolCreateWithCapacity(64);
+    master_pool_t *mp_small = masterpoolCreateWithCapacity(64);
+    buffer_pool_t *pool     = bufferpoolCreate(mp_large, mp_small, 16, 4096, 1500);
+
+    consumer_loop      = wloopCreate(WLOOP_FLAG_AUTO_FREE, pool, 1);
+    wthread_t consumer = threadCreate(consumerThread, NULL);
+    while (wloopStatus(consumer_loop) != WLOOP_STATUS_RUNNING)
+    {
+        ;
+    }
+
+    benchStream(1);
+    benchStream(3);
+    benchPingPong();
+
+    wloopStop(consumer_loop);
+    threadJoin(consumer);
+    return 0;
+}
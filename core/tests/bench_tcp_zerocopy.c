@@ -0,0 +1,157 @@
+// tcp throughput of plain sends vs MSG_ZEROCOPY sends through wioWrite
+// built by the bench_tcp_zerocopy target, configure with -DWW_BUILD_BENCHMARKS=ON
+//
+// without arguments a sink thread drains a loopback connection; loopback always copies, so the zerocopy run shows
+// the completion overhead and the switch back to plain sends. pass "host port" of a remote sink
+// (e.g. nc -l 9000 > /dev/null) to measure a real nic
+
+#include "buffer_pool.h"
+#include "loggers/internal_logger.h"
+#include "master_pool.h"
+#include "wloop.h"
+#include "wsocket.h"
+#include "wthread.h"
+#include "wtime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRANSFER_BYTES  (4ULL << 30) // 4GB per run
+#define SEND_SIZE       65536
+#define QUEUE_HIGHWATER (1U << 20)
+#define ZEROCOPY_SIZE   16384
+
+typedef struct run_s
+{
+    wio_t   *io;
+    uint64_t queued;
+    uint64_t zc_sends;
+    uint64_t zc_copied;
+
+} run_t;
+
+static int  sink_listener;
+static bool sink_complete;
+
+static WTHREAD_ROUTINE(sinkThread)
+{
+    discard userdata;
+    static char buf[1 << 18];
+
+    int      fd    = (int) accept(sink_listener, NULL, NULL);
+    uint64_t total = 0;
+    ssize_t  n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+    {
+        total += (uint64_t) n;
+    }
+    closesocket(fd);
+    sink_complete = total == TRANSFER_BYTES;
+    return 0;
+}
+
+static void pump(wio_t *io)
+{
+    run_t         *run  = weventGetUserdata(io);
+    buffer_pool_t *pool = wloopGetBufferPool(weventGetLoop(io));
+
+    while (run->queued < TRANSFER_BYTES && wioGetWriteBufSize(io) < QUEUE_HIGHWATER && ! wioIsClosed(io))
+    {
+        sbuf_t *buf = bufferpoolGetLargeBuffer(pool);
+        sbufSetLength(buf, SEND_SIZE);
+        run->queued += SEND_SIZE;
+        wioWrite(io, buf);
+    }
+    if (run->queued >= TRANSFER_BYTES && wioCheckWriteComplete(io) && ! wioIsClosed(io))
+    {
+        wioGetZeroCopyStats(io, &run->zc_sends, &run->zc_copied);
+        wioClose(io);
+    }
+}
+
+static void onWrite(wio_t *io)
+{
+    pump(io);
+}
+
+static void onClose(wio_t *io)
+{
+    wloopStop(weventGetLoop(io));
+}
+
+static int connectTo(const char *host, int port)
+{
+    sockaddr_u addr;
+    memorySet(&addr, 0, sizeof(addr));
+    sockaddrSetIpAddressPort(&addr, host, port);
+
+    int fd = (int) socket(addr.sa.sa_family, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, &addr.sa, sockaddrLen(&addr)) != 0)
+    {
+        printf("connect to %s:%d failed\n", host, port);
+        exit(1);
+    }
+    return fd;
+}
+
+static void benchSend(const char *name, buffer_pool_t *pool, const char *host, int port, bool zerocopy)
+{
+    wthread_t sink;
+    if (host == NULL)
+    {
+        sink_listener = (int) socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_u addr;
+        memorySet(&addr, 0, sizeof(addr));
+        sockaddrSetIpAddressPort(&addr, "127.0.0.1", 0);
+        socklen_t len = sockaddrLen(&addr);
+        bind(sink_listener, &addr.sa, len);
+        listen(sink_listener, 1);
+        getsockname(sink_listener, &addr.sa, &len);
+        port = sockaddrPort(&addr);
+        sink = threadCreate(sinkThread, NULL);
+    }
+
+    wloop_t *loop = wloopCreate(WLOOP_FLAG_AUTO_FREE, pool, 0);
+    run_t    run  = {0};
+    run.io        = wioGet(loop, connectTo(host ? host : "127.0.0.1", port));
+    weventSetUserData(run.io, &run);
+    wioSetCallBackWrite(run.io, onWrite);
+    wioSetCallBackClose(run.io, onClose);
+    if (zerocopy && wioEnableTcpZeroCopy(run.io, ZEROCOPY_SIZE) != 0)
+    {
+        printf("%-9s not supported by the kernel, the run below uses plain sends\n", name);
+    }
+
+    uint64_t start = getHRTimeUs();
+    pump(run.io);
+    wloopRun(loop);
+    bool complete = true;
+    if (host == NULL)
+    {
+        threadJoin(sink);
+        closesocket(sink_listener);
+        complete = sink_complete;
+    }
+    double secs = (double) (getHRTimeUs() - start) / 1e6;
+
+    printf("%-9s bytes=%llu time=%.3fs rate=%.2f Gbit/s zerocopy-sends=%llu copied=%llu%s\n", name,
+           (unsigned long long) TRANSFER_BYTES, secs, (double) TRANSFER_BYTES * 8 / secs / 1e9,
+           (unsigned long long) run.zc_sends, (unsigned long long) run.zc_copied, complete ? "" : " INCOMPLETE");
+}
+
+int main(int argc, char **argv)
+{
+    createInternalLogger(NULL, true);
+    setInternalLoggerLevelByStr("ERROR");
+
+    const char *host = argc > 2 ? argv[1] : NULL;
+    int         port = argc > 2 ? atoi(argv[2]) : 0;
+
+    master_pool_t *mp_large = masterpoolCreateWithCapacity(256);
+    master_pool_t *mp_small = masterpoolCreateWithCapacity(64);
+    buffer_pool_t *pool     = bufferpoolCreate(mp_large, mp_small, 64, SEND_SIZE, 1500);
+
+    benchSend("copy", pool, host, port, false);
+    benchSend("zerocopy", pool, host, port, true);
+    return 0;
+}
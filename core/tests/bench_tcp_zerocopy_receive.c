@@ -0,0 +1,158 @@
+// tcp receive throughput of copying reads vs TCP_ZEROCOPY_RECEIVE mapped reads through the wio read callback
+// built by the bench_tcp_zerocopy_receive target, configure with -DWW_BUILD_BENCHMARKS=ON
+//
+// a source thread pushes data over loopback, the loop reads it and hands every buffer straight back like a relay
+// whose write completed. loopback only gives page aligned payload when the sender uses MSG_ZEROCOPY (its pages
+// travel as fragments), so the source sends that way when the kernel allows it; with plain sends nothing can be
+// mapped and the mapped run shows the probing cost and the switch back to copying
+
+#include "buffer_pool.h"
+#include "loggers/internal_logger.h"
+#include "master_pool.h"
+#include "wevent.h"
+#include "wloop.h"
+#include "wsocket.h"
+#include "wthread.h"
+#include "wtime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRANSFER_BYTES (4ULL << 30) // 4GB per run
+#define SEND_SIZE      (1U << 20)
+
+typedef struct run_s
+{
+    uint64_t received;
+    uint64_t mapped;
+    uint64_t copied;
+
+} run_t;
+
+static sockaddr_u source_addr;
+static bool       source_zerocopy;
+static uint8_t   *source_payload; // lives until exit, zerocopy sends may still point at it after the source closed
+
+static void drainCompletions(int fd)
+{
+#ifdef WIO_TCP_ZEROCOPY
+    // NOTE: the payload never changes, completions only have to be taken off the error queue
+    char          control[128];
+    struct msghdr msg = {.msg_control = control, .msg_controllen = sizeof(control)};
+    while (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0)
+    {
+        msg.msg_controllen = sizeof(control);
+    }
+#else
+    discard fd;
+#endif
+}
+
+static WTHREAD_ROUTINE(sourceThread)
+{
+    discard userdata;
+
+    int fd    = (int) socket(AF_INET, SOCK_STREAM, 0);
+    int flags = 0;
+#ifdef WIO_TCP_ZEROCOPY
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0)
+    {
+        flags = MSG_ZEROCOPY;
+    }
+#endif
+    source_zerocopy = flags != 0;
+    connect(fd, &source_addr.sa, sockaddrLen(&source_addr));
+
+    uint64_t sent = 0;
+    while (sent < TRANSFER_BYTES)
+    {
+        ssize_t n = send(fd, source_payload, (size_t) min((uint64_t) SEND_SIZE, TRANSFER_BYTES - sent), flags);
+        if (n < 0)
+        {
+            if (errno != ENOBUFS)
+            {
+                break;
+            }
+            // optmem is full of unreaped completions
+            drainCompletions(fd);
+            continue;
+        }
+        sent += (uint64_t) n;
+        drainCompletions(fd);
+    }
+    closesocket(fd);
+    return 0;
+}
+
+static void onRead(wio_t *io, sbuf_t *buf)
+{
+    run_t *run = weventGetUserdata(io);
+    run->received += sbufGetLength(buf);
+    bufferpoolReuseBuffer(wloopGetBufferPool(weventGetLoop(io)), buf);
+
+    if (run->received >= TRANSFER_BYTES)
+    {
+        wioGetZeroCopyReceiveStats(io, &run->mapped, &run->copied);
+        wioClose(io);
+    }
+}
+
+static void onClose(wio_t *io)
+{
+    wloopStop(weventGetLoop(io));
+}
+
+static void benchReceive(const char *name, buffer_pool_t *pool, bool mapped)
+{
+    int listener = (int) socket(AF_INET, SOCK_STREAM, 0);
+    memorySet(&source_addr, 0, sizeof(source_addr));
+    sockaddrSetIpAddressPort(&source_addr, "127.0.0.1", 0);
+    socklen_t len = sockaddrLen(&source_addr);
+    bind(listener, &source_addr.sa, len);
+    listen(listener, 1);
+    getsockname(listener, &source_addr.sa, &len);
+
+    wthread_t source = threadCreate(sourceThread, NULL);
+    int       fd     = (int) accept(listener, NULL, NULL);
+    closesocket(listener);
+
+    wloop_t *loop = wloopCreate(WLOOP_FLAG_AUTO_FREE, pool, 0);
+    run_t    run  = {0};
+    wio_t   *io   = wioGet(loop, fd);
+    weventSetUserData(io, &run);
+    wioSetCallBackRead(io, onRead);
+    wioSetCallBackClose(io, onClose);
+    if (mapped && wioEnableTcpZeroCopyReceive(io) != 0)
+    {
+        printf("%-7s not supported, the run below copies\n", name);
+    }
+
+    uint64_t start = getHRTimeUs();
+    wioRead(io);
+    wloopRun(loop);
+    threadJoin(source);
+    double secs = (double) (getHRTimeUs() - start) / 1e6;
+
+    printf("%-7s bytes=%llu time=%.3fs rate=%.2f Gbit/s mapped=%llu copied=%llu source=%s%s\n", name,
+           (unsigned long long) run.received, secs, (double) run.received * 8 / secs / 1e9,
+           (unsigned long long) run.mapped, (unsigned long long) run.copied, source_zerocopy ? "zerocopy" : "copy",
+           run.received == TRANSFER_BYTES ? "" : " INCOMPLETE");
+}
+
+int main(void)
+{
+    createInternalLogger(NULL, true);
+    setInternalLoggerLevelByStr("ERROR");
+
+    master_pool_t *mp_large = masterpoolCreateWithCapacity(256);
+    master_pool_t *mp_small = masterpoolCreateWithCapacity(64);
+    buffer_pool_t *pool     = bufferpoolCreate(mp_large, mp_small, 64, 65536, 1500);
+
+    source_payload = aligned_alloc(4096, SEND_SIZE);
+    memorySet(source_payload, 0x5a, SEND_SIZE);
+
+    benchReceive("copy", pool, false);
+    benchReceive("mapped", pool, true);
+    return 0;
+}
@@ -0,0 +1,372 @@
+// checks the completion based tcp reads of the io_uring backend (multishot recv over the provided buffer ring)
+// built by the test_io_uring_recv target, configure with -DWW_BUILD_BENCHMARKS=ON -DWW_IO_URING=ON; exits with 1
+// when a check fails
+//
+// a sender thread pushes a numbered byte pattern over STREAMS loopback connections in uneven chunks, so reads end
+// anywhere inside a buffer. the loop
+//   - stalls once while the senders keep going, the recvs then run the ring dry and have to be armed again
+//   - pauses and resumes one stream, which cancels its recv and hands out what completed in between
+//   - detaches one stream in the middle and posts it to a second loop, which must go on without a lost byte
+//   - closes one stream itself while its recv is armed and data is still arriving
+// every other stream ends with the eof of the sender, after all of its data
+
+#include "buffer_pool.h"
+#include "loggers/internal_logger.h"
+#include "master_pool.h"
+#include "wevent.h"
+#include "wloop.h"
+#include "worker.h"
+#include "wsocket.h"
+#include "wthread.h"
+#include "wtime.h"
+
+#include <stdio.h>
+
+#ifndef EVENT_IO_URING
+
+int main(void)
+{
+    printf("skipped: ww is not built with WW_IO_URING\n");
+    return 0;
+}
+
+#else
+
+#define STREAMS         8
+#define STREAM_BYTES    (4U << 20)
+#define MAX_CHUNK       20000
+#define PAUSED_STREAM   1
+#define DETACHED_STREAM 2
+#define CLOSED_STREAM   3
+#define HANDOFF_AT      (1U << 20)
+#define STALL_MS        300
+
+typedef struct stream_s
+{
+    uint32_t seed;
+    uint64_t got;
+    uint64_t reads;
+    uint64_t partial_reads; // reads that did not fill their buffer
+    uint64_t rearms;        // recvs armed again while reads were never paused
+    uint8_t  last_gen;
+    bool     known;
+    bool     bad;
+    bool     readiness_read; // a read that did not come through the recv completions
+    bool     ended;
+    bool     moving;         // the hand off to the second loop is scheduled
+    bool     moved;          // detached and read on the second loop since then
+    bool     moved_armed;    // the recv was armed when it was detached
+    int      detach_tries;
+    bool     paused;
+    int      pauses;
+
+} stream_t;
+
+static stream_t   streams[STREAMS];
+static sockaddr_u listen_addr;
+static wloop_t   *main_loop;
+static wloop_t   *second_loop;
+static atomic_int ended;
+static atomic_int sender_failed;
+static atomic_int detached_released; // the sender holds the rest of the detached stream back until the detach
+
+static uint8_t patternByte(uint32_t seed, uint64_t off)
+{
+    return off < 4 ? ((uint8_t *) &seed)[off] : (uint8_t) (off * 13 + seed);
+}
+
+static WTHREAD_ROUTINE(senderThread)
+{
+    discard userdata;
+    int      fds[STREAMS];
+    uint64_t sent[STREAMS] = {0};
+    uint8_t *chunk         = memoryAllocate(MAX_CHUNK);
+    uint32_t rnd           = 7;
+
+    for (int i = 0; i < STREAMS; ++i)
+    {
+        fds[i] = (int) socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fds[i], &listen_addr.sa, sockaddrLen(&listen_addr)) != 0)
+        {
+            printf("connect failed: %s\n", socketStrError(socketERRNO()));
+            atomicStore(&sender_failed, 1);
+            return 0;
+        }
+    }
+
+    for (int open = STREAMS; open > 0;)
+    {
+        open = 0;
+        for (int i = 0; i < STREAMS; ++i)
+        {
+            if (fds[i] < 0)
+            {
+                continue;
+            }
+            if (i == DETACHED_STREAM && sent[i] >= HANDOFF_AT && ! atomicLoad(&detached_released))
+            {
+                open++;
+                YIELD_THREAD();
+                continue;
+            }
+            rnd          = rnd * 1103515245 + 12345;
+            uint32_t len = min((rnd >> 8) % MAX_CHUNK + 1, (uint32_t) (STREAM_BYTES - sent[i]));
+            for (uint32_t k = 0; k < len; ++k)
+            {
+                chunk[k] = patternByte(1000 + (uint32_t) i, sent[i] + k);
+            }
+            uint32_t done = 0;
+            while (done < len)
+            {
+                ssize_t n = send(fds[i], chunk + done, len - done, MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    break;
+                }
+                done += (uint32_t) n;
+            }
+            sent[i] += done;
+            if (done < len || sent[i] == STREAM_BYTES)
+            {
+                // the closed stream fails here once the loop closed it, the others are complete
+                if (done < len && i != CLOSED_STREAM)
+                {
+                    printf("stream %d: send failed after %llu bytes\n", i, (unsigned long long) sent[i]);
+                    atomicStore(&sender_failed, 1);
+                }
+                closesocket(fds[i]);
+                fds[i] = -1;
+                continue;
+            }
+            open++;
+        }
+    }
+    memoryFree(chunk);
+    return 0;
+}
+
+static WTHREAD_ROUTINE(secondLoopThread)
+{
+    discard userdata;
+    tl_wid = 1;
+    wloopRun(second_loop);
+    return 0;
+}
+
+static void onStop(wevent_t *ev)
+{
+    wloopStop(ev->loop);
+}
+
+static void stopLoop(wloop_t *loop)
+{
+    wevent_t ev;
+    memorySet(&ev, 0, sizeof(wevent_t));
+    ev.event_type = (wevent_type_e) (WEVENT_TYPE_CUSTOM + 1);
+    ev.cb         = onStop;
+    wloopPostEvent(loop, &ev);
+}
+
+static void streamEnded(stream_t *s)
+{
+    s->ended = true;
+    if (atomicAddExplicit(&ended, 1, memory_order_relaxed) + 1 == STREAMS)
+    {
+        stopLoop(main_loop);
+        stopLoop(second_loop);
+    }
+}
+
+static void onClose(wio_t *io)
+{
+    stream_t *s = weventGetUserdata(io);
+    if (s != NULL && ! s->ended)
+    {
+        streamEnded(s);
+    }
+}
+
+static void onHandOff(wevent_t *ev);
+
+static void onResume(wtimer_t *timer)
+{
+    wio_t    *io = weventGetUserdata(timer);
+    stream_t *s  = weventGetUserdata(io);
+    s->paused    = false;
+    if (! wioIsClosed(io))
+    {
+        wioRead(io);
+    }
+}
+
+static void onDetach(wtimer_t *timer)
+{
+    wio_t    *io = weventGetUserdata(timer);
+    stream_t *s  = weventGetUserdata(io);
+    // the stream is quiet now, its recv waits armed on this loop's ring and detaching has to end it; a ring
+    // that ran dry ended it already, so wait for the re-arm
+    if (io->uring_rx_state != IO_URING_RX_ARMED && ++s->detach_tries < 1000)
+    {
+        wtimer_t *retry = wtimerAdd(weventGetLoop(io), onDetach, 1, 1);
+        weventSetUserData(retry, io);
+        return;
+    }
+    s->moved       = true;
+    s->moved_armed = io->uring_rx_state == IO_URING_RX_ARMED;
+    // let more data reach the socket, the recv takes it into this loop's ring while the io is being detached
+    atomicStore(&detached_released, 1);
+    wwSleepMS(20);
+    wioReadStop(io);
+    wioDetach(io);
+
+    wevent_t ev;
+    memorySet(&ev, 0, sizeof(wevent_t));
+    ev.event_type = (wevent_type_e) (WEVENT_TYPE_CUSTOM + 1);
+    ev.cb         = onHandOff;
+    ev.userdata   = io;
+    wloopPostEvent(second_loop, &ev);
+}
+
+static void onRead(wio_t *io, sbuf_t *buf)
+{
+    stream_t      *s   = weventGetUserdata(io);
+    const uint8_t *p   = sbufGetRawPtr(buf);
+    uint32_t       len = sbufGetLength(buf);
+
+    if (s == NULL)
+    {
+        // the first 4 bytes carry the seed of the stream
+        uint32_t seed;
+        memoryCopy(&seed, p, sizeof(seed));
+        s = &streams[(seed - 1000) % STREAMS];
+        weventSetUserData(io, s);
+        s->seed     = seed;
+        s->known    = true;
+        s->last_gen = io->uring_rx_gen;
+    }
+    for (uint32_t i = 0; i < len && ! s->bad; ++i)
+    {
+        if (p[i] != patternByte(s->seed, s->got + i))
+        {
+            printf("stream %u: wrong byte at %llu\n", s->seed - 1000, (unsigned long long) (s->got + i));
+            s->bad = true;
+        }
+    }
+    if (io->uring_rx_state == IO_URING_RX_OFF)
+    {
+        s->readiness_read = true;
+    }
+    if (io->uring_rx_gen != s->last_gen)
+    {
+        s->last_gen = io->uring_rx_gen;
+        if (s->pauses == 0 && ! s->moved)
+        {
+            s->rearms++;
+        }
+    }
+    if (sbufGetRightCapacity(buf) > 0)
+    {
+        s->partial_reads++;
+    }
+    s->got += len;
+    s->reads++;
+    bufferpoolReuseBuffer(wloopGetBufferPool(weventGetLoop(io)), buf);
+
+    uint32_t index = s->seed - 1000;
+    if (index == PAUSED_STREAM && ! s->paused && s->reads % 64 == 0)
+    {
+        s->paused = true;
+        s->pauses++;
+        wioReadStop(io);
+        wtimer_t *timer = wtimerAdd(weventGetLoop(io), onResume, 2, 1);
+        weventSetUserData(timer, io);
+    }
+    else if (index == DETACHED_STREAM && ! s->moving && s->got >= HANDOFF_AT)
+    {
+        // NOTE: like the socket manager, the io is detached from outside of its own callbacks
+        s->moving       = true;
+        wtimer_t *timer = wtimerAdd(weventGetLoop(io), onDetach, 1, 1);
+        weventSetUserData(timer, io);
+    }
+    else if (index == CLOSED_STREAM && s->got >= HANDOFF_AT)
+    {
+        weventSetUserData(io, NULL);
+        wioClose(io);
+        streamEnded(s);
+    }
+}
+
+static void onHandOff(wevent_t *ev)
+{
+    wio_t *io = weventGetUserdata(ev);
+    wioAttach(ev->loop, io);
+    wioRead(io);
+}
+
+static void onAccept(wio_t *io)
+{
+    wioSetCallBackRead(io, onRead);
+    wioSetCallBackClose(io, onClose);
+    wioRead(io);
+}
+
+static void onStall(wtimer_t *timer)
+{
+    discard timer;
+    // the senders keep going, the kernel fills the whole ring before the loop gets to the completions
+    wwSleepMS(STALL_MS);
+}
+
+int main(void)
+{
+    createInternalLogger(NULL, true);
+    setInternalLoggerLevelByStr("ERROR");
+
+    master_pool_t *mp_large   = masterpoolCreateWithCapacity(64);
+    master_pool_t *mp_small   = masterpoolCreateWithCapacity(64);
+    buffer_pool_t *main_pool  = bufferpoolCreate(mp_large, mp_small, 64, 4096, 1500);
+    buffer_pool_t *other_pool = bufferpoolCreate(mp_large, mp_small, 64, 4096, 1500);
+
+    main_loop   = wloopCreate(WLOOP_FLAG_AUTO_FREE, main_pool, 0);
+    second_loop = wloopCreate(WLOOP_FLAG_AUTO_FREE, other_pool, 1);
+
+    wio_t    *listener = wloopCreateTcpServer(main_loop, "127.0.0.1", 0, onAccept);
+    socklen_t len      = sizeof(listen_addr);
+    getsockname(wioGetFD(listener), &listen_addr.sa, &len);
+
+    wtimerAdd(main_loop, onStall, 20, 1);
+    wthread_t second = threadCreate(secondLoopThread, NULL);
+    wthread_t sender = threadCreate(senderThread, NULL);
+    wloopRun(main_loop);
+    threadJoin(sender);
+    threadJoin(second);
+
+    bool     ok         = atomicLoad(&sender_failed) == 0;
+    bool     completion = true;
+    uint64_t rearms     = 0;
+    uint64_t partial    = 0;
+    for (int i = 0; i < STREAMS; ++i)
+    {
+        stream_t *s      = &streams[i];
+        uint64_t  expect = i == CLOSED_STREAM ? s->got : STREAM_BYTES;
+        printf("stream %d: got=%llu reads=%llu partial=%llu rearms=%llu pauses=%d%s%s\n", i,
+               (unsigned long long) s->got, (unsigned long long) s->reads, (unsigned long long) s->partial_reads,
+               (unsigned long long) s->rearms, s->pauses, s->moved_armed ? " moved while armed" : "",
+               s->bad ? " BAD" : "");
+        ok         = ok && s->known && s->ended && ! s->bad && s->got == expect;
+        completion = completion && ! s->readiness_read;
+        rearms += s->rearms;
+        partial += s->partial_reads;
+    }
+    if (! completion)
+    {
+        // NOTE: kernels before 6.0 have no multishot recv, the backend falls back to readiness
+        printf("skipped: reads were readiness based\n");
+        return ok ? 0 : 1;
+    }
+    ok = ok && streams[PAUSED_STREAM].pauses > 0 && streams[DETACHED_STREAM].moved_armed && rearms > 0 && partial > 0;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+#endif
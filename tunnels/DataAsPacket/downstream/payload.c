@@ -17,14 +17,15 @@ static void localThreadDataaspacketTunnelDownStreamPayload(worker_t *worker, voi
         return;
     }
 
-    tunnelPrevDownStreamPayload(t, l, buf);
+    // the packet is shared with the other workers, the next tunnels may rewrite it
+    buf = sbufCopyOnWriteByPool(lineGetBufferPool(l), buf);
+    tunnelPrevDownStreamPayload(t, ls->line, buf);
 }
 
 void dataaspacketTunnelDownStreamPayload(tunnel_t *t, line_t *l, sbuf_t *buf)
 {
     dataaspacket_lstate_t *ls = lineGetState(l, t);
 
-    tunnelPrevDownStreamPayload(t, tunnelchainGetWorkerPacketLine(tunnelGetChain(t), lineGetWID(l)), buf);
     if (ls->paused)
     {
         bufferpoolReuseBuffer(lineGetBufferPool(l), buf);
@@ -33,6 +34,8 @@ void dataaspacketTunnelDownStreamPayload(tunnel_t *t, line_t *l, sbuf_t *buf)
 
     if (ls->line == NULL)
     {
+        // NOTE: every worker gets a reference to the same packet, copies are made on the receiving workers and
+        // the last one to get there takes the original
         for (wid_t wi = 0; wi < getWorkersCount() - WORKER_ADDITIONS; wi++)
         {
             if (wi == lineGetWID(l))
@@ -47,7 +50,7 @@ void dataaspacketTunnelDownStreamPayload(tunnel_t *t, line_t *l, sbuf_t *buf)
             dataaspacket_lstate_t *wls = lineGetState(line, t);
             if (! wls->paused)
             {
-                sendWorkerMessage(wi,localThreadDataaspacketTunnelDownStreamPayload,t,l,buf);
+                sendWorkerMessage(wi, localThreadDataaspacketTunnelDownStreamPayload, t, line, sbufShare(buf));
             }
         }
         bufferpoolReuseBuffer(lineGetBufferPool(l), buf);
@@ -2,22 +2,29 @@
 
 #include "loggers/network_logger.h"
 
-static sbuf_t *tryReadCompleteFrame(muxclient_lstate_t *parent_ls, mux_frame_t *frame)
+static bool tryReadCompleteFrame(muxclient_lstate_t *parent_ls, mux_frame_t *frame, sbuf_chain_t *frame_chain)
 {
     if (bufferstreamLen(parent_ls->read_stream) < kMuxFrameLength)
     {
-        return NULL;
+        return false;
     }
 
-    bufferstreamViewBytesAt(parent_ls->read_stream, 0, (uint8_t *) frame, kMuxFrameLength);
+    // NOTE: the header is read in place unless it crosses a buffer boundary, then it lands in frame
+    const mux_frame_t *header =
+        (const mux_frame_t *) bufferstreamPeek(parent_ls->read_stream, 0, kMuxFrameLength, (uint8_t *) frame);
 
-    size_t total_frame_size = (size_t) frame->length + (size_t) kMuxFrameLength;
+    size_t total_frame_size = (size_t) header->length + (size_t) kMuxFrameLength;
     if (total_frame_size > bufferstreamLen(parent_ls->read_stream))
     {
-        return NULL;
+        return false;
+    }
+    if (header != frame)
+    {
+        *frame = *header;
     }
 
-    return bufferstreamReadExact(parent_ls->read_stream, total_frame_size);
+    bufferstreamReadExactChain(parent_ls->read_stream, total_frame_size, frame_chain);
+    return true;
 }
 
 static muxclient_lstate_t *findChildByConnectionId(muxclient_lstate_t *parent_ls, uint32_t cid)
@@ -59,14 +66,14 @@ static void moveChildToFront(muxclient_lstate_t *parent_ls, muxclient_lstate_t *
     parent_ls->child_next = child_ls;
 }
 
-static bool handleCloseFrame(tunnel_t *t, line_t *parent_l, mux_frame_t *frame, sbuf_t *frame_buffer,
+static bool handleCloseFrame(tunnel_t *t, line_t *parent_l, mux_frame_t *frame, sbuf_chain_t *frame_chain,
                              muxclient_tstate_t *ts, muxclient_lstate_t *parent_ls, muxclient_lstate_t *child_ls)
 {
     line_t *child_l = child_ls->l;
     wid_t   wid     = lineGetWID(parent_l);
 
     LOGD("MuxClient: DownStreamPayload: Close frame received, cid: %u", frame->cid);
-    bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+    sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
     muxclientLeaveConnection(child_ls);
     muxclientLinestateDestroy(child_ls);
     tunnelPrevDownStreamFinish(t, child_l);
@@ -85,7 +92,26 @@ static bool handleCloseFrame(tunnel_t *t, line_t *parent_l, mux_frame_t *frame,
     return true;
 }
 
-static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *frame, sbuf_t *frame_buffer,
+// NOTE: the frame body is forwarded in the buffers it arrived in, only the header is dropped
+static void forwardDataFrame(tunnel_t *t, line_t *parent_l, line_t *child_l, sbuf_chain_t *frame_chain)
+{
+    sbufchainShiftRight(lineGetBufferPool(parent_l), frame_chain, kMuxFrameLength);
+
+    lineLock(child_l);
+    sbuf_t *buf;
+    while ((buf = sbufchainPopFront(frame_chain)) != NULL)
+    {
+        if (! lineIsAlive(child_l))
+        {
+            bufferpoolReuseBuffer(lineGetBufferPool(parent_l), buf);
+            continue;
+        }
+        tunnelPrevDownStreamPayload(t, child_l, buf);
+    }
+    lineUnlock(child_l);
+}
+
+static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *frame, sbuf_chain_t *frame_chain,
                                  muxclient_tstate_t *ts, muxclient_lstate_t *parent_ls, muxclient_lstate_t *child_ls)
 {
     line_t *child_l = child_ls->l;
@@ -96,11 +122,11 @@ static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *fra
         LOGE("MuxClient: DownStreamPayload: Open frame received, cid: %u, but no Open flag should be sent to "
              "MuxClient node",
              frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         break;
 
     case kMuxFlagClose:
-        if (! handleCloseFrame(t, parent_l, frame, frame_buffer, ts, parent_ls, child_ls))
+        if (! handleCloseFrame(t, parent_l, frame, frame_chain, ts, parent_ls, child_ls))
         {
             return;
         }
@@ -108,25 +134,24 @@ static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *fra
 
     case kMuxFlagFlowPause:
         // LOGD("MuxClient: DownStreamPayload: FlowPause frame received, cid: %u", frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         tunnelPrevDownStreamPause(t, child_l);
         break;
 
     case kMuxFlagFlowResume:
         // LOGD("MuxClient: DownStreamPayload: FlowResume frame received, cid: %u", frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         tunnelPrevDownStreamResume(t, child_l);
         break;
 
     case kMuxFlagData:
         // LOGD("MuxClient: DownStreamPayload: Data frame received, cid: %u", frame->cid);
-        sbufShiftRight(frame_buffer, kMuxFrameLength);
-        tunnelPrevDownStreamPayload(t, child_l, frame_buffer);
+        forwardDataFrame(t, parent_l, child_l, frame_chain);
         break;
 
     default:
         LOGD("MuxClient: DownStreamPayload: Unknown frame type received, cid: %u", frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         break;
     }
 }
@@ -182,10 +207,11 @@ void muxclientTunnelDownStreamPayload(tunnel_t *t, line_t *parent_l, sbuf_t *buf
 
     while (true)
     {
-        mux_frame_t frame        = {0};
-        sbuf_t     *frame_buffer = tryReadCompleteFrame(parent_ls, &frame);
+        mux_frame_t  frame = {0};
+        sbuf_chain_t frame_chain;
+        sbufchainInit(&frame_chain);
 
-        if (! frame_buffer)
+        if (! tryReadCompleteFrame(parent_ls, &frame, &frame_chain))
         {
             break;
         }
@@ -194,14 +220,14 @@ void muxclientTunnelDownStreamPayload(tunnel_t *t, line_t *parent_l, sbuf_t *buf
         if (! child_ls)
         {
             // LOGD("MuxClient: DownStreamPayload: No child line state found for cid: %u", frame.cid);
-            bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+            sbufchainRelease(lineGetBufferPool(parent_l), &frame_chain);
             continue;
         }
 
         moveChildToFront(parent_ls, child_ls);
 
         lineLock(parent_l);
-        processFrameForChild(t, parent_l, &frame, frame_buffer, ts, parent_ls, child_ls);
+        processFrameForChild(t, parent_l, &frame, &frame_chain, ts, parent_ls, child_ls);
 
         if (! lineIsAlive(parent_l))
         {
@@ -2,28 +2,35 @@
 
 #include "loggers/network_logger.h"
 
-static sbuf_t *tryReadCompleteFrame(muxserver_lstate_t *parent_ls, mux_frame_t *frame)
+static bool tryReadCompleteFrame(muxserver_lstate_t *parent_ls, mux_frame_t *frame, sbuf_chain_t *frame_chain)
 {
     if (bufferstreamLen(parent_ls->read_stream) < kMuxFrameLength)
     {
-        return NULL;
+        return false;
     }
 
-    bufferstreamViewBytesAt(parent_ls->read_stream, 0, (uint8_t *) frame, kMuxFrameLength);
+    // NOTE: the header is read in place unless it crosses a buffer boundary, then it lands in frame
+    const mux_frame_t *header =
+        (const mux_frame_t *) bufferstreamPeek(parent_ls->read_stream, 0, kMuxFrameLength, (uint8_t *) frame);
 
-    size_t total_frame_size = (size_t) frame->length + (size_t) kMuxFrameLength;
+    size_t total_frame_size = (size_t) header->length + (size_t) kMuxFrameLength;
     if (total_frame_size > bufferstreamLen(parent_ls->read_stream))
     {
-        return NULL;
+        return false;
+    }
+    if (header != frame)
+    {
+        *frame = *header;
     }
 
-    return bufferstreamReadExact(parent_ls->read_stream, total_frame_size);
+    bufferstreamReadExactChain(parent_ls->read_stream, total_frame_size, frame_chain);
+    return true;
 }
 
 static bool handleOpenFrame(tunnel_t *t, line_t *parent_l, muxserver_lstate_t *parent_ls, mux_frame_t *frame,
-                            sbuf_t *frame_buffer)
+                            sbuf_chain_t *frame_chain)
 {
-    bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+    sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
     LOGD("MuxServer: UpStreamPayload: Open frame received, cid: %u", frame->cid);
 
     line_t             *child_l      = lineCreate(tunnelchainGetLinePools(tunnelGetChain(t)), lineGetWID(parent_l));
@@ -82,7 +89,26 @@ static void moveChildToFront(muxserver_lstate_t *parent_ls, muxserver_lstate_t *
     parent_ls->child_next = child_ls;
 }
 
-static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *frame, sbuf_t *frame_buffer,
+// NOTE: the frame body is forwarded in the buffers it arrived in, only the header is dropped
+static void forwardDataFrame(tunnel_t *t, line_t *parent_l, line_t *child_l, sbuf_chain_t *frame_chain)
+{
+    sbufchainShiftRight(lineGetBufferPool(parent_l), frame_chain, kMuxFrameLength);
+
+    lineLock(child_l);
+    sbuf_t *buf;
+    while ((buf = sbufchainPopFront(frame_chain)) != NULL)
+    {
+        if (! lineIsAlive(child_l))
+        {
+            bufferpoolReuseBuffer(lineGetBufferPool(parent_l), buf);
+            continue;
+        }
+        tunnelNextUpStreamPayload(t, child_l, buf);
+    }
+    lineUnlock(child_l);
+}
+
+static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *frame, sbuf_chain_t *frame_chain,
                                  muxserver_lstate_t *child_ls)
 {
     line_t *child_l = child_ls->l;
@@ -91,7 +117,7 @@ static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *fra
     {
     case kMuxFlagClose:
         LOGD("MuxServer: UpStreamPayload: Close frame received, cid: %u", frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         muxserverLeaveConnection(child_ls);
         muxserverLinestateDestroy(child_ls);
         tunnelNextUpStreamFinish(t, child_l);
@@ -100,25 +126,24 @@ static void processFrameForChild(tunnel_t *t, line_t *parent_l, mux_frame_t *fra
 
     case kMuxFlagFlowPause:
         // LOGD("MuxServer: UpStreamPayload: FlowPause frame received, cid: %u", frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         tunnelNextUpStreamPause(t, child_l);
         break;
 
     case kMuxFlagFlowResume:
         // LOGD("MuxServer: UpStreamPayload: FlowResume frame received, cid: %u", frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         tunnelNextUpStreamResume(t, child_l);
         break;
 
     case kMuxFlagData:
         // LOGD("MuxServer: UpStreamPayload: Data frame received, cid: %u", frame->cid);
-        sbufShiftRight(frame_buffer, kMuxFrameLength);
-        tunnelNextUpStreamPayload(t, child_l, frame_buffer);
+        forwardDataFrame(t, parent_l, child_l, frame_chain);
         break;
 
     default:
         // LOGD("MuxServer: UpStreamPayload: Unknown frame type received, cid: %u", frame->cid);
-        bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+        sbufchainRelease(lineGetBufferPool(parent_l), frame_chain);
         break;
     }
 }
@@ -169,17 +194,18 @@ void muxserverTunnelUpStreamPayload(tunnel_t *t, line_t *parent_l, sbuf_t *buf)
 
     while (true)
     {
-        mux_frame_t frame        = {0};
-        sbuf_t     *frame_buffer = tryReadCompleteFrame(parent_ls, &frame);
+        mux_frame_t  frame = {0};
+        sbuf_chain_t frame_chain;
+        sbufchainInit(&frame_chain);
 
-        if (! frame_buffer)
+        if (! tryReadCompleteFrame(parent_ls, &frame, &frame_chain))
         {
             break;
         }
 
         if (frame.flags == kMuxFlagOpen)
         {
-            if (handleOpenFrame(t, parent_l, parent_ls, &frame, frame_buffer))
+            if (handleOpenFrame(t, parent_l, parent_ls, &frame, &frame_chain))
             {
                 continue;
             }
@@ -190,14 +216,14 @@ void muxserverTunnelUpStreamPayload(tunnel_t *t, line_t *parent_l, sbuf_t *buf)
         if (! child_ls)
         {
             // LOGD("MuxServer: UpStreamPayload: No child line state found for cid: %u", frame.cid);
-            bufferpoolReuseBuffer(lineGetBufferPool(parent_l), frame_buffer);
+            sbufchainRelease(lineGetBufferPool(parent_l), &frame_chain);
             continue;
         }
 
         moveChildToFront(parent_ls, child_ls);
 
         lineLock(parent_l);
-        processFrameForChild(t, parent_l, &frame, frame_buffer, child_ls);
+        processFrameForChild(t, parent_l, &frame, &frame_chain, child_ls);
 
         if (! lineIsAlive(parent_l))
         {
@@ -153,15 +153,7 @@ err_t lwipThreadPtcTcpRecvCallback(void *arg, struct tcp_pcb *tpcb, struct pbuf
     */
     if (p->tot_len <= bufferpoolGetLargeBufferSize(bp))
     {
-
-        if (p->tot_len <= bufferpoolGetSmallBufferSize(bp))
-        {
-            buf = bufferpoolGetSmallBuffer(bp);
-        }
-        else
-        {
-            buf = bufferpoolGetLargeBuffer(bp);
-        }
+        buf = bufferpoolGetBufferForCapacity(bp, p->tot_len);
 
         sbufSetLength(buf, p->tot_len);
         pbuf_copy_partial(p, sbufGetMutablePtr(buf), p->tot_len, 0);
@@ -36,7 +36,7 @@ static void reverseclientBeginConnectMessageReceived(worker_t *worker, void *arg
     }
     lineUnlock(ul);
 
-    sbuf_t* handshakebuf = bufferpoolGetLargeBuffer(lineGetBufferPool(ul));
+    sbuf_t* handshakebuf = bufferpoolGetBufferForCapacity(lineGetBufferPool(ul), kHandShakeLength);
     sbufReserveSpace(handshakebuf, kHandShakeLength);
     memorySet(sbufGetMutablePtr(handshakebuf), kHandShakeByte, kHandShakeLength);
     sbufSetLength(handshakebuf, kHandShakeLength);
@@ -12,6 +12,8 @@ typedef struct tcpconnector_tstate_s
     bool            option_tcp_no_delay;  // apply TCP no delay option on sockets
     bool            option_tcp_fast_open; // apply TCP fast open option on sockets
     bool            option_reuse_addr;    // apply reuse address option on sockets
+    bool            option_zerocopy;      // send large buffers with MSG_ZEROCOPY (linux)
+    bool            option_zerocopy_rx;   // map received pages instead of copying them (linux)
     int             domain_strategy;      // prefer ipv4 or ipv6
     int             fwmark;               // firewall mark on linux (beta)
     uint64_t        outbound_ip_range;    // range for outbound ip (this means free bind)
@@ -41,7 +43,8 @@ enum
     kLineStateSize      = sizeof(tcpconnector_lstate_t),
     kMaxPauseQueueSize  = 1024 * 1024, // 1MB
     kReadWriteTimeoutMs = 300 * 1000,
-    kPauseQueueCapacity = 2
+    kPauseQueueCapacity = 2,
+    kZeroCopyThreshold  = 16 * 1024 // smaller sends are cheaper to copy than to pin and track
 };
 
 typedef enum tcpconnector_strategy
@@ -30,6 +30,8 @@ tunnel_t *tcpconnectorTunnelCreate(node_t *node)
     getBoolFromJsonObjectOrDefault(&(state->option_tcp_no_delay), settings, "nodelay", true);
     getBoolFromJsonObjectOrDefault(&(state->option_tcp_fast_open), settings, "fastopen", false);
     getBoolFromJsonObjectOrDefault(&(state->option_reuse_addr), settings, "reuseaddr", false);
+    getBoolFromJsonObjectOrDefault(&(state->option_zerocopy), settings, "zerocopy", false);
+    getBoolFromJsonObjectOrDefault(&(state->option_zerocopy_rx), settings, "zerocopy-receive", false);
     getIntFromJsonObjectOrDefault(&(state->domain_strategy), settings, "domain-strategy", 0);
 
     state->dest_addr_selected =
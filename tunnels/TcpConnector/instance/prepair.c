@@ -4,6 +4,13 @@
 
 void tcpconnectorTunnelOnPrepair(tunnel_t *t)
 {
-    discard t;
-}
+    tcpconnector_tstate_t *ts = tunnelGetState(t);
 
+    // NOTE: mapped payload is read only, only a TcpListener right before us forwards it without writing to it
+    if (ts->option_zerocopy_rx &&
+        (t->prev == NULL || stringCompare(tunnelGetNode(t->prev)->type, "TcpListener") != 0))
+    {
+        LOGW("TcpConnector: zerocopy-receive is ignored, the previous node is not a TcpListener");
+        ts->option_zerocopy_rx = false;
+    }
+}
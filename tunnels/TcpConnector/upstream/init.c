@@ -113,6 +113,15 @@ void tcpconnectorTunnelUpStreamInit(tunnel_t *t, line_t *l)
     wio_t *io = wioGet(loop, sockfd);
     assert(io != NULL);
 
+    if (ts->option_zerocopy)
+    {
+        wioEnableTcpZeroCopy(io, kZeroCopyThreshold);
+    }
+    if (ts->option_zerocopy_rx)
+    {
+        wioEnableTcpZeroCopyReceive(io);
+    }
+
     sockaddr_u addr = addresscontextToSockAddr(dest_ctx);
 
     wioSetPeerAddr(io, (struct sockaddr *) &(addr), (int) sockaddrLen(&(addr)));
@@ -59,6 +59,10 @@ void tcplistenerOnInboundConnected(wevent_t *ev)
     tcplistener_tstate_t   *ts   = tunnelGetState(t);
 
     wioAttach(loop, io);
+    if (ts->option_zerocopy)
+    {
+        wioEnableTcpZeroCopy(io, kZeroCopyThreshold);
+    }
 
     line_t               *l  = lineCreate(tunnelchainGetLinePools(tunnelGetChain(t)), wid);
     tcplistener_lstate_t *ls = lineGetState(l, t);
@@ -14,6 +14,7 @@ typedef struct tcplistener_tstate_s
     uint16_t listen_port_min;          // min port to listen on (minimum of the range)
     uint16_t listen_port_max;          // max port to listen on (maximum of the range)
     bool     option_tcp_no_delay;      // apply TCP no delay option on sockets
+    bool     option_zerocopy;          // send large buffers with MSG_ZEROCOPY (linux)
 
 } tcplistener_tstate_t;
 
@@ -39,7 +40,8 @@ enum
     kDefaultKeepAliveTimeOutMs     = 5 * 1000,    // same as NGINX
     kEstablishedKeepAliveTimeOutMs = 300 * 1000,  // since the connection is established,
 
-    kPauseQueueCapacity = 2
+    kPauseQueueCapacity = 2,
+    kZeroCopyThreshold  = 16 * 1024 // smaller sends are cheaper to copy than to pin and track
 };
 
 WW_EXPORT void         tcplistenerTunnelDestroy(tunnel_t *t);
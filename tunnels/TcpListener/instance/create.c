@@ -73,6 +73,7 @@ tunnel_t *tcplistenerTunnelCreate(node_t *node)
     }
 
     getBoolFromJsonObject(&(state->option_tcp_no_delay), settings, "nodelay");
+    getBoolFromJsonObjectOrDefault(&(state->option_zerocopy), settings, "zerocopy", false);
 
     if (! getStringFromJsonObject(&(state->listen_address), settings, "address"))
     {
@@ -83,6 +84,8 @@ tunnel_t *tcplistenerTunnelCreate(node_t *node)
     socket_filter_option_t filter_opt;
     socketfilteroptionInit(&filter_opt);
     filter_opt.no_delay = state->option_tcp_no_delay;
+    getBoolFromJsonObject(&(filter_opt.reuse_port), settings, "reuseport");
+    getBoolFromJsonObject(&(filter_opt.incoming_cpu), settings, "incoming-cpu");
 
 
     getStringFromJsonObject(&(filter_opt.interface), settings, "interface");
@@ -108,41 +111,8 @@ tunnel_t *tcplistenerTunnelCreate(node_t *node)
         }
     }
 
-    const cJSON *wlist          = cJSON_GetObjectItemCaseSensitive(settings, "whitelist");
-    if (cJSON_IsArray(wlist))
-    {
-        int len = cJSON_GetArraySize(wlist);
-        if (len > 0)
-        {
-
-            int          i         = 0;
-            const cJSON *list_item = NULL;
-            cJSON_ArrayForEach(list_item, wlist)
-            {
-                char    *ip_str = NULL;
-                ipmask_t ipmask;
-
-                if (! getStringFromJson(&(ip_str), list_item) || ! verifyIPCdir(ip_str))
-                {
-                    LOGF("JSON Error: TcpListener->settings->whitelist (array of strings field) index %d : The data "
-                         "was empty or invalid",
-                         i);
-                    terminateProgram(1);
-                }
-
-                int parse_result = parseIPWithSubnetMask(ip_str, &(ipmask.ip), &(ipmask.mask));
-
-                if (parse_result == -1)
-                {
-                    LOGF("TcpListener: stopping due to whitelist address [%d] \"%s\" parse failure", i, ip_str);
-                    terminateProgram(1);
-                }
-                vec_ipmask_t_push(&filter_opt.white_list, ipmask);
-
-                i++;
-            }
-        }
-    }
+    socketfilteroptionParseIpRangeList(&filter_opt.white_list, settings, "whitelist", "TcpListener");
+    socketfilteroptionParseIpRangeList(&filter_opt.black_list, settings, "blacklist", "TcpListener");
 
     filter_opt.host             = state->listen_address;
     filter_opt.port_min         = state->listen_port_min;
@@ -28,6 +28,23 @@ void udpconnectorOnRecvFrom(wio_t *io, sbuf_t *buf)
         }
         lineUnlock(l);
     }
+
+    uint16_t segment_size = wioGetUdpGroSegmentSize(io);
+    if (segment_size != 0)
+    {
+        // gro coalesced datagrams, the prev tunnel expects one datagram per payload
+        // NOTE: the burst is already read, a pause on the way only stops the reads after it
+        buffer_pool_t *pool = wloopGetBufferPool(weventGetLoop(io));
+        lineLock(l);
+        while (sbufGetLength(payload) > 0 && lineIsAlive(l))
+        {
+            uint32_t len = min(sbufGetLength(payload), (uint32_t) segment_size);
+            tunnelPrevDownStreamPayload(t, l, sbufSplitByPool(pool, payload, len));
+        }
+        lineUnlock(l);
+        bufferpoolReuseBuffer(pool, payload);
+        return;
+    }
     tunnelPrevDownStreamPayload(t, l, payload);
 
 }
@@ -12,6 +12,8 @@ enum udp_connector_dynamic_value_status
 typedef struct udpconnector_tstate_s
 {
     bool              reuse_addr;         // whether to reuse address
+    bool              udp_gro;            // whether to receive gro coalesced datagrams
+    bool              udp_gso;            // whether to send equal sized datagrams with UDP_SEGMENT
     int               domain_strategy;    // DNS resolution strategy
     dynamic_value_t   dest_addr_selected; // selected destination address
     dynamic_value_t   dest_port_selected; // selected destination port
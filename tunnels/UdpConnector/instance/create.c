@@ -35,6 +35,8 @@ tunnel_t *udpconnectorTunnelCreate(node_t *node)
     }
 
     getBoolFromJsonObject(&(state->reuse_addr), settings, "reuseaddr");
+    getBoolFromJsonObjectOrDefault(&(state->udp_gro), settings, "gro", false);
+    getBoolFromJsonObjectOrDefault(&(state->udp_gso), settings, "gso", false);
 
     state->dest_addr_selected =
         parseDynamicStrValueFromJsonObject(settings, "address", 2, "src_context->address", "dest_context->address");
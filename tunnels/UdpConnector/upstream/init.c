@@ -38,6 +38,15 @@ void udpconnectorTunnelUpStreamInit(tunnel_t *t, line_t *l)
 
     udpconnectorLinestateInitialize(ls, t, l, io);
 
+    if (ts->udp_gro)
+    {
+        wioEnableUdpGro(io);
+    }
+    if (ts->udp_gso)
+    {
+        wioEnableUdpGso(io);
+    }
+
     wioSetCallBackRead(io, udpconnectorOnRecvFrom);
     wioRead(io);
 
@@ -16,6 +16,23 @@ static void onUdpConnectonExpire(widle_item_t *idle_udp)
     lineDestroy(line);
 }
 
+// gro hands us many same-sized datagrams in one buffer, the next tunnel expects one datagram per payload
+// NOTE: the burst is already read, a pause on the way only drops the payloads that come after it
+static void splitGroPayload(tunnel_t *t, udplistener_lstate_t *ls, sbuf_t *buf, uint16_t segment_size)
+{
+    line_t        *l    = ls->line;
+    buffer_pool_t *pool = lineGetBufferPool(l);
+
+    lineLock(l);
+    while (sbufGetLength(buf) > 0 && lineIsAlive(l))
+    {
+        uint32_t len = min(sbufGetLength(buf), (uint32_t) segment_size);
+        tunnelNextUpStreamPayload(t, l, sbufSplitByPool(pool, buf, len));
+    }
+    lineUnlock(l);
+    bufferpoolReuseBuffer(pool, buf);
+}
+
 // payload that comes here has passed filtering (whitelist, etc that we gave socketmanager) and is ready to be processed
 void onUdpListenerFilteredPayloadReceived(wevent_t *ev)
 {
@@ -28,7 +45,8 @@ void onUdpListenerFilteredPayloadReceived(wevent_t *ev)
     sbuf_t        *buf            = data->buf;
     uint16_t       real_localport = data->real_localport;
 
-    hash_t peeraddr_hash = sockaddrCalcHashWithPort((sockaddr_u *) wioGetPeerAddr(sock->io));
+    // NOTE: not the socket peeraddr, that one belongs to the socket thread and moves with every datagram
+    hash_t peeraddr_hash = sockaddrCalcHashWithPort(&data->peer_addr);
 
     widle_item_t *idle = idleTableGetIdleItemByHash(wid, table, peeraddr_hash);
     // if idle is NULL, it means this is the first packet from this peer, so we need to create a new connection
@@ -47,7 +65,7 @@ void onUdpListenerFilteredPayloadReceived(wevent_t *ev)
 
         udplistener_lstate_t *ls = lineGetState(l, t);
 
-        udplistenerLinestateInitialize(ls, l, t, sock, real_localport);
+        udplistenerLinestateInitialize(ls, l, t, sock, &data->peer_addr, real_localport);
 
         lineLock(l);
         {
@@ -85,6 +103,10 @@ void onUdpListenerFilteredPayloadReceived(wevent_t *ev)
         // drop the payload if the read is paused
         bufferpoolReuseBuffer(getWorkerBufferPool(wid), buf);
     }
+    else if (data->gro_segment_size != 0)
+    {
+        splitGroPayload(t, ls, buf, data->gro_segment_size);
+    }
     else
     {
         tunnelNextUpStreamPayload(t, ls->line, buf);
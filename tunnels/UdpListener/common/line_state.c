@@ -3,15 +3,16 @@
 #include "loggers/network_logger.h"
 
 void udplistenerLinestateInitialize(udplistener_lstate_t *ls, line_t *l, tunnel_t *t, udpsock_t *uio,
-                                    uint16_t real_localport)
+                                    const sockaddr_u *peer_addr, uint16_t real_localport)
 {
 
     l->routing_context.src_ctx.type_ip   = true; // we have a client ip
     l->routing_context.src_ctx.proto_udp = true; // udp
-    sockaddrToIpAddr((const sockaddr_u *) wioGetPeerAddr(uio->io), &(l->routing_context.src_ctx.ip_address));
+    sockaddrToIpAddr(peer_addr, &(l->routing_context.src_ctx.ip_address));
     l->routing_context.src_ctx.port = real_localport;
 
-    *ls = (udplistener_lstate_t){.line = l, .uio = uio, .tunnel = t, .read_paused = false};
+    *ls = (udplistener_lstate_t){
+        .line = l, .uio = uio, .peer_addr = *peer_addr, .tunnel = t, .read_paused = false};
 
     if (loggerCheckWriteLevel(getNetworkLogger(), LOG_LEVEL_DEBUG))
     {
@@ -23,7 +24,7 @@ void udplistenerLinestateInitialize(udplistener_lstate_t *ls, line_t *l, tunnel_
         char peeraddrstr[SOCKADDR_STRLEN]  = {0};
 
         LOGD("UdpListener: Accepted FD:%x  [%s] <= [%s]", wioGetFD(uio->io), SOCKADDR_STR(&log_localaddr, localaddrstr),
-             SOCKADDR_STR(wioGetPeerAddr(uio->io), peeraddrstr));
+             SOCKADDR_STR(peer_addr, peeraddrstr));
     }
 }
 
@@ -5,6 +5,6 @@
 void udplistenerTunnelDownStreamPayload(tunnel_t *t, line_t *l, sbuf_t *buf)
 {
     udplistener_lstate_t *ls = lineGetState(l, t);
-    postUdpWrite(ls->uio, lineGetWID(l), buf);
+    postUdpWrite(ls->uio, lineGetWID(l), &ls->peer_addr, buf);
 
 }
@@ -15,9 +15,10 @@ typedef struct udplistener_tstate_s
 
 typedef struct udplistener_lstate_s
 {
-    tunnel_t     *tunnel; // reference to the tunnel (UdpListener)
-    line_t       *line;   // reference to the line
-    udpsock_t    *uio;    // IO handle for the connection (socket)
+    tunnel_t     *tunnel;    // reference to the tunnel (UdpListener)
+    line_t       *line;      // reference to the line
+    udpsock_t    *uio;       // IO handle for the connection (socket)
+    sockaddr_u    peer_addr; // the listen socket is shared by all peers, replies go here
     widle_item_t *idle_handle;
 
     // These fields are used internally for the queue implementation for TCP
@@ -58,7 +59,7 @@ void udplistenerTunnelDownStreamPause(tunnel_t *t, line_t *l);
 void udplistenerTunnelDownStreamResume(tunnel_t *t, line_t *l);
 
 void udplistenerLinestateInitialize(udplistener_lstate_t *ls, line_t *l, tunnel_t *t, udpsock_t *uio,
-                                    uint16_t real_localport);
+                                    const sockaddr_u *peer_addr, uint16_t real_localport);
 void udplistenerLinestateDestroy(udplistener_lstate_t *ls);
 
 void onUdpListenerFilteredPayloadReceived(wevent_t *ev);
@@ -112,46 +112,17 @@ tunnel_t *udplistenerTunnelCreate(node_t *node)
         }
     }
 
-    const cJSON *wlist          = cJSON_GetObjectItemCaseSensitive(settings, "whitelist");
-    if (cJSON_IsArray(wlist))
-    {
-        int len = cJSON_GetArraySize(wlist);
-        if (len > 0)
-        {
-
-            int          i         = 0;
-            const cJSON *list_item = NULL;
-            cJSON_ArrayForEach(list_item, wlist)
-            {
-                char    *ip_str = NULL;
-                ipmask_t ipmask;
-
-                if (! getStringFromJson(&(ip_str), list_item) || ! verifyIPCdir(ip_str))
-                {
-                    LOGF("JSON Error: UdpListener->settings->whitelist (array of strings field) index %d : The data "
-                         "was empty or invalid",
-                         i);
-                    terminateProgram(1);
-                }
-
-                int parse_result = parseIPWithSubnetMask(ip_str, &(ipmask.ip), &(ipmask.mask));
-
-                if (parse_result == -1)
-                {
-                    LOGF("UdpListener: stopping due to whitelist address [%d] \"%s\" parse failure", i, ip_str);
-                    terminateProgram(1);
-                }
-                vec_ipmask_t_push(&filter_opt.white_list, ipmask);
-
-                i++;
-            }
-        }
-    }
+    socketfilteroptionParseIpRangeList(&filter_opt.white_list, settings, "whitelist", "UdpListener");
+    socketfilteroptionParseIpRangeList(&filter_opt.black_list, settings, "blacklist", "UdpListener");
 
     filter_opt.host             = state->listen_address;
     filter_opt.port_min         = state->listen_port_min;
     filter_opt.port_max         = state->listen_port_max;
-    filter_opt.protocol         = IPPROTO_TCP;
+    filter_opt.protocol         = IPPROTO_UDP;
+
+    getBoolFromJsonObjectOrDefault(&(filter_opt.udp_gro), settings, "gro", false);
+    getBoolFromJsonObjectOrDefault(&(filter_opt.udp_gso), settings, "gso", false);
+    getBoolFromJsonObjectOrDefault(&(filter_opt.reuse_port), settings, "reuseport", false);
    
     socketacceptorRegister(t, filter_opt, onUdpListenerFilteredPayloadReceived);
 
@@ -37,7 +37,23 @@ void udpstatelesssocketOnRecvFrom(wio_t *io, sbuf_t *buf)
 
 
     udpstatelesssocket_tstate_t *state = tunnelGetState(t);
-    state->WriteReceivedPacket(state->write_tunnel, l, buf);
+
+    uint16_t segment_size = wioGetUdpGroSegmentSize(io);
+    if (segment_size != 0)
+    {
+        // gro coalesced datagrams, each one is a separate packet for the next tunnel
+        buffer_pool_t *pool = getWorkerBufferPool(wid);
+        while (sbufGetLength(buf) > 0)
+        {
+            uint32_t len = min(sbufGetLength(buf), (uint32_t) segment_size);
+            state->WriteReceivedPacket(state->write_tunnel, l, sbufSplitByPool(pool, buf, len));
+        }
+        bufferpoolReuseBuffer(pool, buf);
+    }
+    else
+    {
+        state->WriteReceivedPacket(state->write_tunnel, l, buf);
+    }
 
 #ifdef DEBUG
     if (! lineIsAlive(l))
@@ -11,6 +11,8 @@ typedef struct udpstatelesssocket_tstate_s
     char    *listen_address; // address to listen on (ip)
     uint16_t listen_port;    // port to listen on
     int      fwmark;         // fwmark to set on the socket
+    bool     udp_gro;        // whether to receive gro coalesced datagrams
+    bool     udp_gso;        // whether to send equal sized datagrams with UDP_SEGMENT
 
     wio_t *io;     // socket file descriptor
     wid_t  io_wid; // the worker id that created the io
@@ -52,6 +52,9 @@ tunnel_t *udpstatelesssocketTunnelCreate(node_t *node)
     }
     state->listen_port = (uint16_t)temp_port;
 
+    getBoolFromJsonObjectOrDefault(&(state->udp_gro), settings, "gro", false);
+    getBoolFromJsonObjectOrDefault(&(state->udp_gso), settings, "gso", false);
+
 
 
     state->io = wloopCreateUdpServer(getWorkerLoop(getWID()), state->listen_address,state->listen_port);
@@ -64,6 +67,15 @@ tunnel_t *udpstatelesssocketTunnelCreate(node_t *node)
 
     state->io_wid = getWID();
 
+    if (state->udp_gro)
+    {
+        wioEnableUdpGro(state->io);
+    }
+    if (state->udp_gso)
+    {
+        wioEnableUdpGso(state->io);
+    }
+
     weventSetUserData(state->io, t);
     wioSetCallBackRead(state->io, udpstatelesssocketOnRecvFrom);
     wioRead(state->io);
@@ -0,0 +1,160 @@
+#ifndef WW_TWHEEL_H_
+#define WW_TWHEEL_H_
+
+/*
+ * Hierarchical timing wheel, O(1) insert and remove.
+ *
+ * Time is counted in ticks, the owner decides how long a tick is.
+ * Level 0 has one slot per tick, each higher level has one slot per full turn of the level below,
+ * when a level turns over the next slot of the level above is cascaded down.
+ * Expires farther than TWHEEL_RANGE ticks wait in the top level and are cascaded until they fit.
+ */
+
+#include <assert.h> // for assert
+#include <stdint.h> // for uint64_t
+
+#include "list.h"
+
+#define TWHEEL_LEVELS    4
+#define TWHEEL_SLOT_BITS 6
+#define TWHEEL_SLOTS     (1U << TWHEEL_SLOT_BITS)
+#define TWHEEL_SLOT_MASK (TWHEEL_SLOTS - 1)
+#define TWHEEL_RANGE     (1ULL << (TWHEEL_SLOT_BITS * TWHEEL_LEVELS))
+
+struct twheel_node {
+    struct list_head link;
+    uint64_t expire; // tick
+};
+
+struct twheel {
+    uint64_t now; // the next tick to expire
+    uint32_t nelts;
+    uint64_t bitmap[TWHEEL_LEVELS]; // non empty slots
+    struct list_head slots[TWHEEL_LEVELS][TWHEEL_SLOTS];
+};
+
+static inline void twheel_init(struct twheel* wheel, uint64_t now) {
+    wheel->now = now;
+    wheel->nelts = 0;
+    for (int l = 0; l < TWHEEL_LEVELS; ++l) {
+        wheel->bitmap[l] = 0;
+        for (unsigned int s = 0; s < TWHEEL_SLOTS; ++s) {
+            list_init(&wheel->slots[l][s]);
+        }
+    }
+}
+
+// an empty wheel has nothing to cascade, let it skip the ticks it slept through
+static inline void twheel_settle(struct twheel* wheel, uint64_t now) {
+    if (wheel->nelts == 0 && now > wheel->now) {
+        for (int l = 0; l < TWHEEL_LEVELS; ++l) {
+            wheel->bitmap[l] = 0;
+        }
+        wheel->now = now;
+    }
+}
+
+static inline void __twheel_link(struct twheel* wheel, struct twheel_node* node) {
+    uint64_t expire = node->expire < wheel->now ? wheel->now : node->expire;
+    uint64_t delta = expire - wheel->now;
+    if (delta >= TWHEEL_RANGE) {
+        delta = TWHEEL_RANGE - 1;
+        expire = wheel->now + delta;
+    }
+    int level = 0;
+    while (delta >= (1ULL << (TWHEEL_SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    unsigned int slot = (unsigned int)(expire >> (TWHEEL_SLOT_BITS * level)) & TWHEEL_SLOT_MASK;
+    list_add_tail(&node->link, &wheel->slots[level][slot]);
+    wheel->bitmap[level] |= 1ULL << slot;
+}
+
+static inline void twheel_insert(struct twheel* wheel, struct twheel_node* node) {
+    __twheel_link(wheel, node);
+    ++wheel->nelts;
+}
+
+// NOTE: slot bits are cleared lazily, a stale bit only costs a look at an empty list
+static inline void twheel_remove(struct twheel* wheel, struct twheel_node* node) {
+    assert(wheel->nelts > 0);
+    list_del_init(&node->link);
+    --wheel->nelts;
+}
+
+static inline void __twheel_cascade(struct twheel* wheel, int level, unsigned int slot) {
+    struct list_head* head = &wheel->slots[level][slot];
+    struct list_head moving;
+    list_init(&moving);
+    list_splice_init(head, &moving);
+    wheel->bitmap[level] &= ~(1ULL << slot);
+    while (!list_empty(&moving)) {
+        struct twheel_node* node = list_entry(moving.next, struct twheel_node, link);
+        list_del(&node->link);
+        __twheel_link(wheel, node);
+    }
+}
+
+// moves every node expiring at or before tick to the expired list, nodes stay counted until removed
+static inline void twheel_advance(struct twheel* wheel, uint64_t tick, struct list_head* expired) {
+    while (wheel->now <= tick) {
+        unsigned int slot = (unsigned int)wheel->now & TWHEEL_SLOT_MASK;
+        if (slot == 0) {
+            for (int l = 1; l < TWHEEL_LEVELS; ++l) {
+                unsigned int s = (unsigned int)(wheel->now >> (TWHEEL_SLOT_BITS * l)) & TWHEEL_SLOT_MASK;
+                if (wheel->bitmap[l] & (1ULL << s)) {
+                    __twheel_cascade(wheel, l, s);
+                }
+                if (s != 0) break;
+            }
+        }
+        if (wheel->bitmap[0] & (1ULL << slot)) {
+            list_splice_tail_init(&wheel->slots[0][slot], expired);
+            wheel->bitmap[0] &= ~(1ULL << slot);
+        }
+        ++wheel->now;
+        if (wheel->nelts == 0 && wheel->now <= tick) {
+            // nothing to cascade or expire, jump and drop the stale bits
+            for (int l = 0; l < TWHEEL_LEVELS; ++l) {
+                wheel->bitmap[l] = 0;
+            }
+            wheel->now = tick + 1;
+        }
+    }
+}
+
+// the tick by which the wheel must be advanced again, UINT64_MAX if empty
+static inline uint64_t twheel_next_tick(const struct twheel* wheel) {
+    if (wheel->nelts == 0) return UINT64_MAX;
+    uint64_t next = UINT64_MAX;
+    for (int l = 1; l < TWHEEL_LEVELS; ++l) {
+        if (wheel->bitmap[l]) {
+            // NOTE: higher levels are busy, wake up when level 0 turns over and cascade
+            next = (wheel->now + TWHEEL_SLOT_MASK) & ~(uint64_t)TWHEEL_SLOT_MASK;
+            break;
+        }
+    }
+    uint64_t bits = wheel->bitmap[0];
+    if (bits) {
+        unsigned int slot = (unsigned int)wheel->now & TWHEEL_SLOT_MASK;
+        uint64_t rotated = slot ? ((bits >> slot) | (bits << (TWHEEL_SLOTS - slot))) : bits;
+        uint64_t tick = wheel->now + (uint64_t)__builtin_ctzll(rotated);
+        if (tick < next) next = tick;
+    }
+    return next;
+}
+
+// any node still in the wheel, NULL if empty, meant for cleanup
+static inline struct twheel_node* twheel_any(struct twheel* wheel) {
+    if (wheel->nelts == 0) return NULL;
+    for (int l = 0; l < TWHEEL_LEVELS; ++l) {
+        for (unsigned int s = 0; s < TWHEEL_SLOTS; ++s) {
+            if (!list_empty(&wheel->slots[l][s])) {
+                return list_entry(wheel->slots[l][s].next, struct twheel_node, link);
+            }
+        }
+    }
+    return NULL;
+}
+
+#endif // WW_TWHEEL_H_
@@ -173,6 +173,30 @@ widle_item_t *idleTableGetIdleItemByHash(wid_t wid, widle_table_t *self, hash_t
     return (find_result.ref->second);
 }
 
+/**
+ * @brief Keeps the idle item of a hash alive regardless of its worker and returns its user data.
+ *
+ * @param self Pointer to the idle table.
+ * @param key Hash key of the idle item.
+ * @param age_ms Time in milliseconds to extend the item.
+ * @return User data of the idle item if found; NULL otherwise.
+ */
+void *idleTableKeepIdleItemByHashForAtleast(widle_table_t *self, hash_t key, uint64_t age_ms)
+{
+    void *userdata = NULL;
+    mutexLock(&(self->mutex));
+
+    hmap_idles_t_iter find_result = hmap_idles_t_find(&(self->hmap), key);
+    if (find_result.ref != hmap_idles_t_end(&(self->hmap)).ref)
+    {
+        widle_item_t *item = find_result.ref->second;
+        item->expire_at_ms = wloopNowMS(self->loop) + age_ms;
+        userdata           = item->userdata;
+    }
+    mutexUnlock(&(self->mutex));
+    return userdata;
+}
+
 /**
  * @brief Removes an idle item from the table by its hash key.
  *
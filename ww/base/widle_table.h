@@ -88,6 +88,19 @@ widle_item_t *idleItemNew(widle_table_t *self, hash_t key, void *userdata, Expir
  */
 widle_item_t *idleTableGetIdleItemByHash(wid_t wid, widle_table_t *self, hash_t key);
 
+/**
+ * @brief Keep the item of a hash alive, whichever worker created it, and return its user data.
+ *
+ * Unlike idleTableGetIdleItemByHash this can be used by any worker, the item itself never leaves the lock
+ * (the worker owning the table may expire and free it right after).
+ *
+ * @param self Pointer to the idle table.
+ * @param key Hash key of the item.
+ * @param age_ms Minimum age to keep the item.
+ * @return The user data of the item if found; otherwise, NULL.
+ */
+void *idleTableKeepIdleItemByHashForAtleast(widle_table_t *self, hash_t key, uint64_t age_ms);
+
 /**
  * @brief Update the expiration of an idle item.
  *
@@ -292,6 +292,18 @@ WW_INLINE int socketOptionReusePort(int sockfd, int on DEFAULT(1))
 #endif
 }
 
+WW_INLINE int socketOptionIncomingCpu(int sockfd, int cpu)
+{
+#ifdef SO_INCOMING_CPU
+    // NOTE: on a SO_REUSEPORT group, connections received on this cpu prefer this listener
+    return setsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, (const char *) &cpu, sizeof(int));
+#else
+    discard sockfd;
+    discard cpu;
+    return 0;
+#endif
+}
+
 WW_INLINE int socketOptionLinger(int sockfd, int timeout DEFAULT(1))
 {
 #ifdef SO_LINGER
@@ -421,16 +433,18 @@ static inline int parseIPWithSubnetMask(const char *ip_str, ip_addr_t *ip, ip_ad
         return ERR_ARG;
     }
 
-    if (ipaddr_aton(ip_part, ip))
+    // NOTE: ipaddr_aton would accept ipv6 here too and cap its prefix at 32
+    if (ip4addr_aton(ip_part, ip_2_ip4(ip)))
     {
         if (prefix_len < 0 || prefix_len > 32)
         {
             return ERR_ARG;
         }
 
+        ip->type          = IPADDR_TYPE_V4;
         subnet_mask->type = IPADDR_TYPE_V4;
         // Calculate the subnet mask for IPv4
-        u32_t subnet_mask_value = 0xFFFFFFFF << (32 - prefix_len);
+        u32_t subnet_mask_value = prefix_len == 0 ? 0 : 0xFFFFFFFF << (32 - prefix_len);
         IP4_ADDR(&subnet_mask->u_addr.ip4, (subnet_mask_value >> 24) & 0xFF, (subnet_mask_value >> 16) & 0xFF,
                  (subnet_mask_value >> 8) & 0xFF, subnet_mask_value & 0xFF);
 
@@ -1,13 +1,28 @@
 #include "buffer_pool.h"
 #include "loggers/internal_logger.h"
+#include "sbuf_arena.h"
 #include "shiftbuffer.h"
 #include "wplatform.h"
 
+enum
+{
+    // a busy worker may cache up to this many times its configured buffer count
+    kBufferPoolGrowFactor = 4,
+    // local cache is sized to serve 1/kDemandCacheDivisor of an interval's demand without touching the master pool
+    kDemandCacheDivisor = 8,
+    // weight of a new sample in the demand ewma is 1/2^kDemandEwmaShift
+    kDemandEwmaShift = 2
+};
+
 struct buffer_pool_s
 {
 
-    uint16_t cap;
+    uint16_t cap; // current target, moves between cap_min and cap_max with demand
     uint16_t free_threshold;
+    uint16_t cap_min;
+    uint16_t cap_max;
+    uint32_t demand;      // buffers handed out since the last bufferpoolAdaptToDemand
+    uint32_t demand_ewma; // buffers per adapt interval
     uint32_t large_buffers_container_len;
     uint32_t large_buffers_size;
     uint16_t large_buffer_left_padding;
@@ -16,6 +31,10 @@ struct buffer_pool_s
     uint32_t small_buffers_size;
     uint16_t small_buffer_left_padding;
 
+    uint32_t medium_buffers_container_len;
+    uint32_t medium_buffers_size; // 0 = no medium class, medium requests get a large buffer
+    uint16_t medium_buffer_left_padding;
+
 #if BUFFER_POOL_DEBUG == 1
     atomic_size_t in_use;
 #endif
@@ -24,10 +43,15 @@ struct buffer_pool_s
     tid_t tid;
 #endif
 
+    sbuf_arena_t *large_arena;       // created on first use, NULL when the arena is off or the layout changed
+    size_t        large_arena_bytes; // 0 = large buffers come from the heap
+
     master_pool_t *large_buffers_mp;
     sbuf_t       **large_buffers;
     master_pool_t *small_buffers_mp;
     sbuf_t       **small_buffers;
+    master_pool_t *medium_buffers_mp;
+    sbuf_t       **medium_buffers;
 };
 
 /**
@@ -73,6 +97,11 @@ uint16_t bufferpoolGetSmallBufferPadding(buffer_pool_t *pool)
     return pool->small_buffer_left_padding;
 }
 
+uint32_t bufferpoolGetMediumBufferSize(buffer_pool_t *pool)
+{
+    return pool->medium_buffers_size > 0 ? pool->medium_buffers_size : pool->large_buffers_size;
+}
+
 /**
  * Creates a large buffer using the provided create handler.
  * @param pool The master pool.
@@ -84,6 +113,21 @@ static master_pool_item_t *createLargeBufHandle(master_pool_t *pool, void *userd
     discard pool;
 
     buffer_pool_t *bpool = userdata;
+
+    if (bpool->large_arena_bytes > 0)
+    {
+        if (bpool->large_arena == NULL)
+        {
+            bpool->large_arena = sbufarenaCreate(bpool->large_buffers_size, bpool->large_buffer_left_padding,
+                                                 bpool->large_arena_bytes);
+        }
+        sbuf_t *b = sbufarenaAllocate(bpool->large_arena);
+        if (LIKELY(b != NULL))
+        {
+            return b;
+        }
+        // arena is full or could not map memory, the heap still works
+    }
     return sbufCreateWithPadding(bpool->large_buffers_size, bpool->large_buffer_left_padding);
 }
 
@@ -100,6 +144,19 @@ static master_pool_item_t *createSmallBufHandle(master_pool_t *pool, void *userd
     return sbufCreateWithPadding(bpool->small_buffers_size, bpool->small_buffer_left_padding);
 }
 
+/**
+ * Creates a medium buffer using the provided create handler.
+ * @param pool The master pool.
+ * @param userdata User data passed to the create handler.
+ * @return A pointer to the created medium buffer.
+ */
+static master_pool_item_t *createMediumBufHandle(master_pool_t *pool, void *userdata)
+{
+    discard        pool;
+    buffer_pool_t *bpool = userdata;
+    return sbufCreateWithPadding(bpool->medium_buffers_size, bpool->medium_buffer_left_padding);
+}
+
 /**
  * Destroys a large buffer using the provided destroy handler.
  * @param pool The master pool.
@@ -126,6 +183,19 @@ static void destroySmallBufHandle(master_pool_t *pool, master_pool_item_t *item,
     sbufDestroy(item);
 }
 
+/**
+ * Destroys a medium buffer using the provided destroy handler.
+ * @param pool The master pool.
+ * @param item The medium buffer to destroy.
+ * @param userdata User data passed to the destroy handler.
+ */
+static void destroyMediumBufHandle(master_pool_t *pool, master_pool_item_t *item, void *userdata)
+{
+    discard pool;
+    discard userdata;
+    sbufDestroy(item);
+}
+
 /**
  * Recharges the large buffers in the buffer pool by preallocating a number of buffers.
  * @param pool The buffer pool.
@@ -160,6 +230,23 @@ static void reChargeSmallBuffers(buffer_pool_t *pool)
 #endif
 }
 
+/**
+ * Recharges the medium buffers in the buffer pool by preallocating a number of buffers.
+ * @param pool The buffer pool.
+ */
+static void reChargeMediumBuffers(buffer_pool_t *pool)
+{
+    const uint32_t increase = min((pool->cap - pool->medium_buffers_container_len), pool->cap / 2);
+
+    masterpoolGetItems(pool->medium_buffers_mp,
+                       (void const **) &(pool->medium_buffers[pool->medium_buffers_container_len]), increase, pool);
+
+    pool->medium_buffers_container_len += increase;
+#if BUFFER_POOL_DEBUG == 1
+    LOGD("BufferPool: allocated %d new medium buffers, %zu are in use", increase, pool->in_use);
+#endif
+}
+
 /**
  * Performs the initial charge of the buffer pool.
  * @param pool The buffer pool.
@@ -214,6 +301,25 @@ static void shrinkSmallBuffers(buffer_pool_t *pool)
 #endif
 }
 
+/**
+ * Shrinks the medium buffers in the buffer pool by releasing a number of buffers.
+ * @param pool The buffer pool.
+ */
+static void shrinkMediumBuffers(buffer_pool_t *pool)
+{
+    const uint32_t decrease = min(pool->medium_buffers_container_len, pool->cap / 2);
+
+    masterpoolReuseItems(pool->medium_buffers_mp,
+                         (void **) &(pool->medium_buffers[pool->medium_buffers_container_len - decrease]), decrease,
+                         pool);
+
+    pool->medium_buffers_container_len -= decrease;
+
+#if BUFFER_POOL_DEBUG == 1
+    LOGD("BufferPool: freed %d medium buffers, %zu are in use", decrease, pool->in_use);
+#endif
+}
+
 sbuf_t *bufferpoolGetLargeBuffer(buffer_pool_t *pool)
 {
 #if BYPASS_BUFFERPOOL == 1
@@ -225,6 +331,7 @@ sbuf_t *bufferpoolGetLargeBuffer(buffer_pool_t *pool)
 #endif
 
     bufferpoolDebugCheckThreadAccess(pool);
+    pool->demand++;
 
     if (LIKELY(pool->large_buffers_container_len > 0))
     {
@@ -248,6 +355,7 @@ sbuf_t *bufferpoolGetSmallBuffer(buffer_pool_t *pool)
 #endif
 
     bufferpoolDebugCheckThreadAccess(pool);
+    pool->demand++;
 
     if (LIKELY(pool->small_buffers_container_len > 0))
     {
@@ -260,6 +368,78 @@ sbuf_t *bufferpoolGetSmallBuffer(buffer_pool_t *pool)
     return pool->small_buffers[pool->small_buffers_container_len];
 }
 
+sbuf_t *bufferpoolGetMediumBuffer(buffer_pool_t *pool)
+{
+    if (UNLIKELY(pool->medium_buffers_size == 0))
+    {
+        return bufferpoolGetLargeBuffer(pool);
+    }
+
+#if BYPASS_BUFFERPOOL == 1
+    return sbufCreateWithPadding(pool->medium_buffers_size, pool->medium_buffer_left_padding);
+#endif
+
+#if BUFFER_POOL_DEBUG == 1
+    pool->in_use += 1;
+#endif
+
+    bufferpoolDebugCheckThreadAccess(pool);
+    pool->demand++;
+
+    if (LIKELY(pool->medium_buffers_container_len > 0))
+    {
+        --(pool->medium_buffers_container_len);
+        return pool->medium_buffers[pool->medium_buffers_container_len];
+    }
+    reChargeMediumBuffers(pool);
+
+    --(pool->medium_buffers_container_len);
+    return pool->medium_buffers[pool->medium_buffers_container_len];
+}
+
+/**
+ * Gets the room a buffer of a size class really has after its left padding (the size is rounded up on creation).
+ * @param size The size of the class.
+ * @return The usable capacity.
+ */
+static inline uint32_t classCapacity(uint32_t size)
+{
+    uint16_t no_padding = 0;
+    return sbufCalcRealCapacity(size, &no_padding);
+}
+
+sbuf_t *bufferpoolGetBufferForCapacity(buffer_pool_t *pool, uint32_t capacity)
+{
+    if (capacity <= classCapacity(pool->small_buffers_size))
+    {
+        return bufferpoolGetSmallBuffer(pool);
+    }
+    if (capacity <= classCapacity(pool->medium_buffers_size))
+    {
+        return bufferpoolGetMediumBuffer(pool);
+    }
+    if (capacity <= classCapacity(pool->large_buffers_size))
+    {
+        return bufferpoolGetLargeBuffer(pool);
+    }
+    // NOTE: bigger than every class, bufferpoolReuseBuffer destroys it when it comes back
+    return sbufCreateWithPadding(capacity, pool->large_buffer_left_padding);
+}
+
+/**
+ * Checks whether a buffer has the layout sbufCreateWithPadding gives to a size class.
+ * @param b The buffer.
+ * @param size The size of the class.
+ * @param left_padding The left padding of the class.
+ * @return True if the buffer belongs to the class.
+ */
+static inline bool isBufferOfClass(sbuf_t *b, uint32_t size, uint16_t left_padding)
+{
+    // NOTE: capacity and padding are rounded up when the buffer is created, compare against the rounded values
+    uint32_t real_cap = sbufCalcRealCapacity(size, &left_padding);
+    return sbufGetTotalCapacity(b) == real_cap && sbufGetLeftPadding(b) == left_padding;
+}
+
 /**
  * Reuses a buffer by returning it to the buffer pool.
  * @param pool The buffer pool.
@@ -272,6 +452,17 @@ void bufferpoolReuseBuffer(buffer_pool_t *pool, sbuf_t *b)
     {
         return;
     }
+    if (UNLIKELY(! sbufShareDrop(b)))
+    {
+        // other owners still read it
+        return;
+    }
+    if (UNLIKELY(sbufIsMapped(b)))
+    {
+        // never came from a pool, the window goes back to its io
+        sbufDestroy(b);
+        return;
+    }
 
 #if BYPASS_BUFFERPOOL == 1
     sbufDestroy(b);
@@ -283,7 +474,7 @@ void bufferpoolReuseBuffer(buffer_pool_t *pool, sbuf_t *b)
 #endif
     sbufReset(b);
 
-    if (sbufGetTotalCapacityNoPadding(b) == pool->large_buffers_size && sbufGetLeftPadding(b) == pool->large_buffer_left_padding)
+    if (isBufferOfClass(b, pool->large_buffers_size, pool->large_buffer_left_padding))
     {
         if (UNLIKELY(pool->large_buffers_container_len > pool->free_threshold))
         {
@@ -291,7 +482,16 @@ void bufferpoolReuseBuffer(buffer_pool_t *pool, sbuf_t *b)
         }
         pool->large_buffers[(pool->large_buffers_container_len)++] = b;
     }
-    else if (sbufGetTotalCapacityNoPadding(b) == pool->small_buffers_size && sbufGetLeftPadding(b) == pool->small_buffer_left_padding)
+    else if (pool->medium_buffers_size > 0 &&
+             isBufferOfClass(b, pool->medium_buffers_size, pool->medium_buffer_left_padding))
+    {
+        if (UNLIKELY(pool->medium_buffers_container_len > pool->free_threshold))
+        {
+            shrinkMediumBuffers(pool);
+        }
+        pool->medium_buffers[(pool->medium_buffers_container_len)++] = b;
+    }
+    else if (isBufferOfClass(b, pool->small_buffers_size, pool->small_buffer_left_padding))
     {
         if (UNLIKELY(pool->small_buffers_container_len > pool->free_threshold))
         {
@@ -307,7 +507,8 @@ void bufferpoolReuseBuffer(buffer_pool_t *pool, sbuf_t *b)
 
 sbuf_t *sbufAppendMerge(buffer_pool_t *pool, sbuf_t *restrict b1, sbuf_t *restrict b2)
 {
-    b1 = sbufConcat(b1, b2);
+    // NOTE: b1 is written to, a shared buffer or a mapped view gets a private copy first
+    b1 = sbufConcat(sbufCopyOnWriteByPool(pool, b1), b2);
     bufferpoolReuseBuffer(pool, b2);
     return b1;
 }
@@ -315,23 +516,37 @@ sbuf_t *sbufAppendMerge(buffer_pool_t *pool, sbuf_t *restrict b1, sbuf_t *restri
 sbuf_t *sbufDuplicateByPool(buffer_pool_t *pool, sbuf_t *b)
 {
     sbuf_t *bnew;
-    if (sbufGetTotalCapacityNoPadding(b) == pool->large_buffers_size)
+    if (sbufGetTotalCapacityNoPadding(b) <= pool->large_buffers_size)
     {
-        bnew = bufferpoolGetLargeBuffer(pool);
-    }
-    else if (sbufGetTotalCapacityNoPadding(b) == pool->small_buffers_size)
-    {
-        bnew = bufferpoolGetSmallBuffer(pool);
+        // same class as the original, the copy has the same room to grow
+        bnew = bufferpoolGetBufferForCapacity(pool, sbufGetTotalCapacityNoPadding(b));
     }
     else
     {
         return sbufDuplicate(b);
     }
-    sbufSetLength(bnew, sbufGetLength(b));
     sbufWriteBuf(bnew, b, sbufGetLength(b));
+    sbufSetLength(bnew, sbufGetLength(b));
     return bnew;
 }
 
+sbuf_t *sbufCopyOnWriteByPool(buffer_pool_t *pool, sbuf_t *b)
+{
+    if (LIKELY(! sbufIsShared(b) && ! sbufIsMapped(b)))
+    {
+        return b;
+    }
+    // NOTE: copy before dropping our reference, the last owner may recycle it right after
+    sbuf_t *copy = sbufDuplicateByPool(pool, b);
+    bufferpoolReuseBuffer(pool, b);
+    return copy;
+}
+
+sbuf_t *sbufSplitByPool(buffer_pool_t *pool, sbuf_t *b, uint32_t bytes)
+{
+    return sbufMoveTo(bufferpoolGetBufferForCapacity(pool, bytes), b, bytes);
+}
+
 void bufferpoolUpdateAllocationPaddings(buffer_pool_t *pool, uint16_t large_buffer_left_padding,
                                         uint16_t small_buffer_left_padding)
 {
@@ -344,10 +559,19 @@ void bufferpoolUpdateAllocationPaddings(buffer_pool_t *pool, uint16_t large_buff
     {
         return; // no change
     }
-    assert(pool->small_buffers_container_len == 0 && pool->large_buffers_container_len == 0);
+    assert(pool->small_buffers_container_len == 0 && pool->large_buffers_container_len == 0 &&
+           pool->medium_buffers_container_len == 0);
+
+    if (pool->large_arena != NULL && l_new_max != pool->large_buffer_left_padding)
+    {
+        // slots are laid out for the old padding, buffers already out go back to it when destroyed
+        sbufarenaRelease(pool->large_arena);
+        pool->large_arena = NULL;
+    }
 
-    pool->large_buffer_left_padding = l_new_max;
-    pool->small_buffer_left_padding = s_new_max;
+    pool->large_buffer_left_padding  = l_new_max;
+    pool->small_buffer_left_padding  = s_new_max;
+    pool->medium_buffer_left_padding = max(l_new_max, s_new_max);
 }
 
 buffer_pool_t *bufferpoolCreate(master_pool_t *mp_large, master_pool_t *mp_small, uint32_t bufcount,
@@ -358,12 +582,19 @@ buffer_pool_t *bufferpoolCreate(master_pool_t *mp_large, master_pool_t *mp_small
 
     bufcount = 2 * bufcount;
 
-    const unsigned long container_len = bufcount * sizeof(sbuf_t *);
+    const uint32_t      cap_max       = min(bufcount * kBufferPoolGrowFactor, (uint32_t) UINT16_MAX - 1);
+    const unsigned long container_len = cap_max * sizeof(sbuf_t *);
 
     buffer_pool_t *ptr_pool = memoryAllocate(sizeof(buffer_pool_t));
 
     *ptr_pool = (buffer_pool_t) {
         .cap                = (uint16_t) bufcount,
+        .cap_min            = (uint16_t) bufcount,
+        .cap_max            = (uint16_t) cap_max,
+        .demand             = 0,
+        .demand_ewma        = 0,
+        .large_arena        = NULL,
+        .large_arena_bytes  = 0,
         .large_buffers_size = large_buffer_size,
         .small_buffers_size = small_buffer_size,
         .free_threshold     = (uint16_t) max(bufcount / 2, (bufcount * 2) / 3),
@@ -379,6 +610,8 @@ buffer_pool_t *bufferpoolCreate(master_pool_t *mp_large, master_pool_t *mp_small
         .large_buffers    = (sbuf_t **) memoryAllocate(container_len),
         .small_buffers_mp = mp_small,
         .small_buffers    = (sbuf_t **) memoryAllocate(container_len),
+        .medium_buffers_mp = NULL,
+        .medium_buffers    = NULL,
     };
 
     masterpoolInstallCallBacks(ptr_pool->large_buffers_mp, createLargeBufHandle, destroyLargeBufHandle);
@@ -393,6 +626,86 @@ buffer_pool_t *bufferpoolCreate(master_pool_t *mp_large, master_pool_t *mp_small
     return ptr_pool;
 }
 
+/**
+ * Returns buffers above keep from a local container to the master pool.
+ */
+static void trimBuffers(buffer_pool_t *pool, master_pool_t *mp, sbuf_t **container, uint32_t *container_len,
+                        uint32_t keep)
+{
+    if (*container_len <= keep)
+    {
+        return;
+    }
+    masterpoolReuseItems(mp, (void **) &(container[keep]), *container_len - keep, pool);
+    *container_len = keep;
+}
+
+void bufferpoolEnableMediumBuffers(buffer_pool_t *pool, master_pool_t *mp_medium, uint32_t medium_buffer_size)
+{
+    assert(pool->medium_buffers_mp == NULL);
+    assert(medium_buffer_size > pool->small_buffers_size && medium_buffer_size < pool->large_buffers_size);
+
+    pool->medium_buffers_mp          = mp_medium;
+    pool->medium_buffers_size        = medium_buffer_size;
+    pool->medium_buffer_left_padding = max(pool->large_buffer_left_padding, pool->small_buffer_left_padding);
+    pool->medium_buffers             = (sbuf_t **) memoryAllocate(pool->cap_max * sizeof(sbuf_t *));
+
+    masterpoolInstallCallBacks(pool->medium_buffers_mp, createMediumBufHandle, destroyMediumBufHandle);
+}
+
+void bufferpoolEnableSlabArena(buffer_pool_t *pool, size_t max_bytes)
+{
+    assert(pool->large_arena == NULL);
+    pool->large_arena_bytes = max_bytes;
+}
+
+bool bufferpoolGetSlabArenaStats(buffer_pool_t *pool, sbuf_arena_stats_t *stats)
+{
+    if (pool->large_arena == NULL)
+    {
+        return false;
+    }
+    sbufarenaGetStats(pool->large_arena, stats);
+    return true;
+}
+
+void bufferpoolAdaptToDemand(buffer_pool_t *pool)
+{
+    bufferpoolDebugCheckThreadAccess(pool);
+
+    const uint32_t sample = pool->demand;
+    pool->demand          = 0;
+    pool->demand_ewma     = pool->demand_ewma - (pool->demand_ewma >> kDemandEwmaShift) + (sample >> kDemandEwmaShift);
+
+    uint32_t target = max(pool->demand_ewma, sample) / kDemandCacheDivisor;
+    target          = min(max(target, (uint32_t) pool->cap_min), (uint32_t) pool->cap_max) & ~1U;
+
+    if (target != pool->cap)
+    {
+#if BUFFER_POOL_DEBUG == 1
+        LOGD("BufferPool: cap %u -> %u, demand ewma %u", pool->cap, target, pool->demand_ewma);
+#endif
+        pool->cap            = (uint16_t) target;
+        pool->free_threshold = (uint16_t) max(target / 2, (target * 2) / 3);
+    }
+
+    // NOTE: a quiet interval hands almost everything back, the master pool decides when memory goes to the os
+    const uint32_t keep = sample == 0 ? pool->cap_min / 4 : pool->cap / 2;
+
+    if (pool->large_buffers_container_len > pool->free_threshold || sample == 0)
+    {
+        trimBuffers(pool, pool->large_buffers_mp, pool->large_buffers, &pool->large_buffers_container_len, keep);
+    }
+    if (pool->small_buffers_container_len > pool->free_threshold || sample == 0)
+    {
+        trimBuffers(pool, pool->small_buffers_mp, pool->small_buffers, &pool->small_buffers_container_len, keep);
+    }
+    if (pool->medium_buffers_container_len > pool->free_threshold || sample == 0)
+    {
+        trimBuffers(pool, pool->medium_buffers_mp, pool->medium_buffers, &pool->medium_buffers_container_len, keep);
+    }
+}
+
 void bufferpoolDestroy(buffer_pool_t *pool)
 {
     for (uint32_t s_i = 0; s_i < pool->small_buffers_container_len; s_i++)
@@ -403,8 +716,21 @@ void bufferpoolDestroy(buffer_pool_t *pool)
     {
         sbufDestroy(pool->large_buffers[l_i]);
     }
+    for (uint32_t m_i = 0; m_i < pool->medium_buffers_container_len; m_i++)
+    {
+        sbufDestroy(pool->medium_buffers[m_i]);
+    }
     masterpoolMakeEmpty(pool->large_buffers_mp, pool);
     masterpoolMakeEmpty(pool->small_buffers_mp, pool);
+    if (pool->medium_buffers_mp != NULL)
+    {
+        masterpoolMakeEmpty(pool->medium_buffers_mp, pool);
+        memoryFree((void *) pool->medium_buffers);
+    }
+    if (pool->large_arena != NULL)
+    {
+        sbufarenaRelease(pool->large_arena);
+    }
     memoryFree((void *) pool->large_buffers);
     memoryFree((void *) pool->small_buffers);
     memoryFree(pool);
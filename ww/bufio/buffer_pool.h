@@ -1,6 +1,7 @@
 #pragma once
 #include "master_pool.h"
 #include "generic_pool.h"
+#include "sbuf_arena.h"
 #include "shiftbuffer.h"
 #include "wlibc.h"
 
@@ -22,6 +23,10 @@
     for performance reasons, this pool dose not inherit from generic_pool, so 80% of the code is the same
     but also it has its own differences ofcourse
 
+    buffers come in three size classes: small (a packet), medium (a page) and large (a tcp read), each with its
+    own local cache and master pool; the medium class is optional (bufferpoolEnableMediumBuffers), without it
+    medium requests are served by large buffers. bufferpoolGetBufferForCapacity picks the smallest class that fits
+
 */
 
 typedef struct buffer_pool_s buffer_pool_t;
@@ -57,6 +62,21 @@ sbuf_t *bufferpoolGetLargeBuffer(buffer_pool_t *pool);
  */
 sbuf_t *bufferpoolGetSmallBuffer(buffer_pool_t *pool);
 
+/**
+ * Retrieves a medium buffer from the buffer pool, a large one if the pool has no medium class.
+ * @param pool The buffer pool.
+ * @return A pointer to the retrieved medium buffer.
+ */
+sbuf_t *bufferpoolGetMediumBuffer(buffer_pool_t *pool);
+
+/**
+ * Retrieves a buffer of the smallest class that can hold the given number of bytes after its left padding.
+ * @param pool The buffer pool.
+ * @param capacity The number of bytes the caller is going to write.
+ * @return A pointer to the retrieved buffer, a heap buffer if no class is big enough.
+ */
+sbuf_t *bufferpoolGetBufferForCapacity(buffer_pool_t *pool, uint32_t capacity);
+
 /**
  * Reuses a buffer by returning it to the buffer pool.
  * @param pool The buffer pool.
@@ -64,6 +84,38 @@ sbuf_t *bufferpoolGetSmallBuffer(buffer_pool_t *pool);
  */
 void bufferpoolReuseBuffer(buffer_pool_t *pool, sbuf_t *b);
 
+/**
+ * Adds the medium size class to the pool, call it right after bufferpoolCreate.
+ * @param pool The buffer pool.
+ * @param mp_medium The master pool for medium buffers.
+ * @param medium_buffer_size The size of each medium buffer, between the small and the large size.
+ */
+void bufferpoolEnableMediumBuffers(buffer_pool_t *pool, master_pool_t *mp_medium, uint32_t medium_buffer_size);
+
+/**
+ * Makes the pool carve its large buffers out of a hugepage backed slab arena (see sbuf_arena.h).
+ * Call it before the pool hands out its first buffer, the arena is mapped lazily by the owner thread.
+ * @param pool The buffer pool.
+ * @param max_bytes Upper limit of the arena, buffers beyond it come from the heap.
+ */
+void bufferpoolEnableSlabArena(buffer_pool_t *pool, size_t max_bytes);
+
+/**
+ * Reads the occupancy of the slab arena of the pool.
+ * @param pool The buffer pool.
+ * @param stats Receives the numbers.
+ * @return false if the pool has no arena (yet).
+ */
+bool bufferpoolGetSlabArenaStats(buffer_pool_t *pool, sbuf_arena_stats_t *stats);
+
+/**
+ * Resizes the local cache after the demand of the last interval, call it periodically from the owner thread.
+ * Busy pools grow up to 4 times their initial width (fewer master pool trips), quiet pools
+ * hand their surplus back to the master pool.
+ * @param pool The buffer pool.
+ */
+void bufferpoolAdaptToDemand(buffer_pool_t *pool);
+
 /**
  * Updates the allocation paddings for the buffer pool.
  * @param pool The buffer pool.
@@ -90,6 +142,13 @@ uint16_t bufferpoolGetLargeBufferPadding(buffer_pool_t *pool);
 uint32_t bufferpoolGetSmallBufferSize(buffer_pool_t *pool);
 uint16_t bufferpoolGetSmallBufferPadding(buffer_pool_t *pool);
 
+/**
+ * Gets the size of medium buffers in the buffer pool.
+ * @param pool The buffer pool.
+ * @return The size of medium buffers, the large size if the pool has no medium class.
+ */
+uint32_t bufferpoolGetMediumBufferSize(buffer_pool_t *pool);
+
 /**
  * Checks if a buffer is a large buffer.
  * @param buf The buffer to check.
@@ -113,3 +172,21 @@ sbuf_t *sbufAppendMerge(buffer_pool_t *pool, sbuf_t *restrict b1, sbuf_t *restri
  * @return A pointer to the duplicated buffer.
  */
 sbuf_t *sbufDuplicateByPool(buffer_pool_t *pool, sbuf_t *b);
+
+/**
+ * Makes a buffer safe to modify, see "Shared buffers" and "Mapped views" in shiftbuffer.h.
+ * @param pool The buffer pool.
+ * @param b A buffer the caller owns, shared or not.
+ * @return b itself if nobody else owns it and it is not a mapped view, otherwise a private copy (the caller's
+ * reference to b is dropped).
+ */
+sbuf_t *sbufCopyOnWriteByPool(buffer_pool_t *pool, sbuf_t *b);
+
+/**
+ * Moves the first bytes of a buffer into a new buffer taken from the pool (the smallest class that fits).
+ * @param pool The buffer pool.
+ * @param b The source buffer, it is consumed by the given number of bytes.
+ * @param bytes The number of bytes to move.
+ * @return A pointer to the new buffer.
+ */
+sbuf_t *sbufSplitByPool(buffer_pool_t *pool, sbuf_t *b, uint32_t bytes);
@@ -9,6 +9,32 @@ enum
     kConcatMaxThreshould = 4096
 };
 
+// takes the front buffer back after a chain read shared it, the stream's part is copied out only if the chain side
+// still holds the buffer (its header and the bytes in front of ours belong to that side)
+static void reclaimSharedFront(buffer_stream_t *self)
+{
+    sbuf_t *b = self->shared_front;
+    if (LIKELY(b == NULL))
+    {
+        return;
+    }
+    self->shared_front = NULL;
+
+    if (! sbufIsShared(b))
+    {
+        b->curpos = self->shared_curpos;
+        sbufSetLength(b, self->shared_len);
+        return;
+    }
+
+    sbuf_t *own = bufferpoolGetBufferForCapacity(self->pool, self->shared_len);
+    own         = sbufReserveSpace(own, self->shared_len);
+    sbufSetLength(own, self->shared_len);
+    memoryCopyLarge(sbufGetMutablePtr(own), &b->buf[self->shared_curpos], self->shared_len);
+    bufferpoolReuseBuffer(self->pool, bs_doublequeue_t_pull_front(&self->q));
+    bs_doublequeue_t_push_front(&self->q, own);
+}
+
 buffer_stream_t *bufferstreamCreate(buffer_pool_t *pool, uint16_t use_left_padding)
 {
     assert(pool != NULL);
@@ -24,6 +50,8 @@ void bufferstreamEmpty(buffer_stream_t *self)
 {
     assert(self != NULL);
 
+    // NOTE: the shared front is in the queue, dropping it only drops our reference
+    self->shared_front = NULL;
     c_foreach(i, bs_doublequeue_t, self->q)
     {
         bufferpoolReuseBuffer(self->pool, *i.ref);
@@ -36,6 +64,8 @@ void bufferstreamDestroy(buffer_stream_t *self)
 {
     assert(self != NULL);
 
+    // NOTE: the shared front is in the queue, dropping it only drops our reference
+    self->shared_front = NULL;
     c_foreach(i, bs_doublequeue_t, self->q)
     {
         bufferpoolReuseBuffer(self->pool, *i.ref);
@@ -87,6 +117,8 @@ sbuf_t *bufferstreamReadExact(buffer_stream_t *self, size_t bytes)
     assert(self && self->size >= bytes && bytes > 0);
     assert(bs_doublequeue_t_size(&self->q) > 0); // Ensure queue is not empty
 
+    reclaimSharedFront(self);
+
     self->size -= bytes;
 
     sbuf_t *container = bs_doublequeue_t_pull_front(&self->q);
@@ -121,6 +153,44 @@ sbuf_t *bufferstreamReadExact(buffer_stream_t *self, size_t bytes)
     }
 }
 
+void bufferstreamReadExactChain(buffer_stream_t *self, size_t bytes, sbuf_chain_t *out)
+{
+    assert(self && self->size >= bytes && bytes > 0);
+    assert(bytes <= UINT32_MAX);
+
+    reclaimSharedFront(self);
+
+    self->size -= bytes;
+
+    while (bytes > 0)
+    {
+        sbuf_t *b         = bs_doublequeue_t_pull_front(&self->q);
+        size_t  available = sbufGetLength(b);
+
+        if (available > bytes)
+        {
+            if (bytes <= available - bytes)
+            {
+                // NOTE: a short head is cheaper to copy than holding the rest of the buffer on the chain side
+                sbufchainAppend(self->pool, out, sbufSplitByPool(self->pool, b, (uint32_t) bytes));
+                bs_doublequeue_t_push_front(&self->q, b);
+                return;
+            }
+            // NOTE: the header goes to the chain with the head, the stream keeps its part behind a second reference
+            self->shared_front  = b;
+            self->shared_curpos = b->curpos + (uint32_t) bytes;
+            self->shared_len    = (uint32_t) (available - bytes);
+            bs_doublequeue_t_push_front(&self->q, sbufShare(b));
+            sbufSetLength(b, (uint32_t) bytes);
+            sbufchainAppend(self->pool, out, b);
+            return;
+        }
+
+        sbufchainAppend(self->pool, out, b);
+        bytes -= available;
+    }
+}
+
 /**
  * Reads at least a specified number of bytes from the buffer stream.
  * @param self The buffer stream.
@@ -132,6 +202,8 @@ sbuf_t *bufferstreamReadAtLeast(buffer_stream_t *self, size_t bytes)
     assert(self && self->size >= bytes && bytes > 0);
     assert(bs_doublequeue_t_size(&self->q) > 0); // Ensure queue is not empty
 
+    reclaimSharedFront(self);
+
     sbuf_t *container = bs_doublequeue_t_pull_front(&self->q);
     size_t  consumed  = sbufGetLength(container);
 
@@ -158,6 +230,8 @@ sbuf_t *bufferstreamIdealRead(buffer_stream_t *self)
     assert(self && self->size > 0);
     assert(bs_doublequeue_t_size(&self->q) > 0); // Ensure queue is not empty
 
+    reclaimSharedFront(self);
+
     sbuf_t *container = bs_doublequeue_t_pull_front(&self->q);
     self->size -= sbufGetLength(container);
     return container;
@@ -167,6 +241,8 @@ uint8_t bufferstreamViewByteAt(buffer_stream_t *self, size_t at)
 {
     assert(self && self->size > at && self->size != 0);
 
+    reclaimSharedFront(self);
+
     size_t offset = at;
     c_foreach(i, bs_doublequeue_t, self->q)
     {
@@ -188,6 +264,8 @@ void bufferstreamViewBytesAt(buffer_stream_t *self, size_t at, uint8_t *buf, siz
 
     assert(self && buf && len > 0 && self->size >= (at + len) && self->size != 0);
 
+    reclaimSharedFront(self);
+
     size_t remaining_offset = at;
     size_t buf_i            = 0;
 
@@ -217,3 +295,100 @@ void bufferstreamViewBytesAt(buffer_stream_t *self, size_t at, uint8_t *buf, siz
         }
     }
 }
+
+static inline sbuf_t *segmentAt(buffer_stream_t *self, size_t index)
+{
+    return *bs_doublequeue_t_at(&self->q, (ptrdiff_t) index);
+}
+
+const uint8_t *bufferstreamPeek(buffer_stream_t *self, size_t at, size_t len, uint8_t *scratch)
+{
+    assert(self && len > 0 && self->size >= (at + len));
+
+    buffer_stream_cursor_t cursor;
+    bufferstreamCursorInit(&cursor, self);
+    bufferstreamCursorSkip(&cursor, at);
+    return bufferstreamCursorRead(&cursor, len, scratch);
+}
+
+void bufferstreamConsume(buffer_stream_t *self, size_t bytes)
+{
+    assert(self && self->size >= bytes);
+
+    reclaimSharedFront(self);
+
+    self->size -= bytes;
+    while (bytes > 0)
+    {
+        sbuf_t *b    = *bs_doublequeue_t_front(&self->q);
+        size_t  blen = sbufGetLength(b);
+        if (bytes < blen)
+        {
+            sbufShiftRight(b, (uint32_t) bytes);
+            return;
+        }
+        bufferpoolReuseBuffer(self->pool, bs_doublequeue_t_pull_front(&self->q));
+        bytes -= blen;
+    }
+}
+
+void bufferstreamCursorInit(buffer_stream_cursor_t *cursor, buffer_stream_t *self)
+{
+    assert(self != NULL);
+
+    reclaimSharedFront(self);
+
+    *cursor = (buffer_stream_cursor_t) {.stream = self, .segment = 0, .offset = 0, .position = 0};
+}
+
+bool bufferstreamCursorSkip(buffer_stream_cursor_t *cursor, size_t len)
+{
+    if (bufferstreamCursorRemaining(cursor) < len)
+    {
+        return false;
+    }
+    cursor->position += len;
+
+    while (len > 0)
+    {
+        size_t left = sbufGetLength(segmentAt(cursor->stream, cursor->segment)) - cursor->offset;
+        if (len < left)
+        {
+            cursor->offset += (uint32_t) len;
+            return true;
+        }
+        len -= left;
+        cursor->segment++;
+        cursor->offset = 0;
+    }
+    return true;
+}
+
+const uint8_t *bufferstreamCursorRead(buffer_stream_cursor_t *cursor, size_t len, uint8_t *scratch)
+{
+    if (len == 0 || bufferstreamCursorRemaining(cursor) < len)
+    {
+        return NULL;
+    }
+
+    sbuf_t        *b    = segmentAt(cursor->stream, cursor->segment);
+    const uint8_t *here = ((const uint8_t *) sbufGetRawPtr(b)) + cursor->offset;
+
+    if (len <= sbufGetLength(b) - cursor->offset)
+    {
+        bufferstreamCursorSkip(cursor, len);
+        return here;
+    }
+
+    // NOTE: the bytes cross a buffer boundary, this is the only case that copies
+    size_t copied = 0;
+    while (copied < len)
+    {
+        b                = segmentAt(cursor->stream, cursor->segment);
+        size_t copy_len  = min(len - copied, (size_t) (sbufGetLength(b) - cursor->offset));
+        memoryCopy(scratch + copied, ((const uint8_t *) sbufGetRawPtr(b)) + cursor->offset, copy_len);
+        copied += copy_len;
+        bufferstreamCursorSkip(cursor, copy_len);
+    }
+    return scratch;
+}
@@ -2,6 +2,7 @@
 #include "wlibc.h"
 
 #include "buffer_pool.h"
+#include "sbuf_chain.h"
 #include "shiftbuffer.h"
 
 /*
@@ -23,11 +24,30 @@ struct buffer_stream_s
     buffer_pool_t   *pool;
     bs_doublequeue_t q;
     size_t           size;
+    sbuf_t          *shared_front;     // front buffer whose header went out with a chain read, see ReadExactChain
+    uint32_t         shared_curpos;    // where the stream's part of shared_front starts
+    uint32_t         shared_len;       // and its length
     uint16_t         use_left_padding; // Whether to use left padding for buffers
 };
 
 typedef struct buffer_stream_s buffer_stream_t;
 
+/*
+    a cursor walks the stream for parsing without taking anything out of it, every read gives a pointer straight
+    into the queued buffer when the bytes are contiguous there and copies into the caller's scratch only when they
+    cross a buffer boundary
+
+    a cursor is only valid until the stream is modified (push, read, consume)
+*/
+typedef struct buffer_stream_cursor_s
+{
+    buffer_stream_t *stream;
+    size_t           segment;  // index of the queued buffer the cursor is in
+    uint32_t         offset;   // offset inside that buffer
+    size_t           position; // bytes from the start of the stream
+
+} buffer_stream_cursor_t;
+
 /**
  * Creates a new buffer stream.
  * @param pool The buffer pool.
@@ -63,6 +83,17 @@ void bufferstreamPush(buffer_stream_t *self, sbuf_t *buf);
  */
 sbuf_t *bufferstreamReadExact(buffer_stream_t *self, size_t bytes);
 
+/**
+ * Reads an exact number of bytes from the buffer stream without concating the buffers.
+ * Whole buffers are moved into the chain, only the buffer on the boundary is split: a short head is copied, otherwise
+ * the chain and the stream share the buffer and the stream copies its part only if the chain side still holds it
+ * the next time the stream is read.
+ * @param self The buffer stream.
+ * @param bytes The number of bytes to read.
+ * @param out An initialized (usually empty) chain that receives the buffers.
+ */
+void bufferstreamReadExactChain(buffer_stream_t *self, size_t bytes, sbuf_chain_t *out);
+
 /**
  * Reads at least a specified number of bytes from the buffer stream.
  * @param self The buffer stream.
@@ -95,6 +126,57 @@ uint8_t bufferstreamViewByteAt(buffer_stream_t *self, size_t at);
  */
 void bufferstreamViewBytesAt(buffer_stream_t *self, size_t at, uint8_t *buf, size_t len);
 
+/**
+ * Gives access to a sequence of bytes at a specific position in the buffer stream.
+ * @param self The buffer stream.
+ * @param at The position of the first byte.
+ * @param len The number of bytes.
+ * @param scratch At least len bytes, used only when the bytes cross a buffer boundary.
+ * @return A pointer to the bytes, into the queued buffer when possible, scratch otherwise.
+ */
+const uint8_t *bufferstreamPeek(buffer_stream_t *self, size_t at, size_t len, uint8_t *scratch);
+
+/**
+ * Drops bytes from the front of the buffer stream, buffers that are fully consumed go back to the pool.
+ * @param self The buffer stream.
+ * @param bytes The number of bytes to drop.
+ */
+void bufferstreamConsume(buffer_stream_t *self, size_t bytes);
+
+/**
+ * Places a cursor at the start of the buffer stream.
+ * @param cursor The cursor.
+ * @param self The buffer stream.
+ */
+void bufferstreamCursorInit(buffer_stream_cursor_t *cursor, buffer_stream_t *self);
+
+/**
+ * Reads the next bytes at the cursor and moves it forward.
+ * @param cursor The cursor.
+ * @param len The number of bytes.
+ * @param scratch At least len bytes, used only when the bytes cross a buffer boundary.
+ * @return A pointer to the bytes, or NULL if the stream has less than len bytes after the cursor.
+ */
+const uint8_t *bufferstreamCursorRead(buffer_stream_cursor_t *cursor, size_t len, uint8_t *scratch);
+
+/**
+ * Moves the cursor forward without reading.
+ * @param cursor The cursor.
+ * @param len The number of bytes.
+ * @return false if the stream has less than len bytes after the cursor (the cursor does not move).
+ */
+bool bufferstreamCursorSkip(buffer_stream_cursor_t *cursor, size_t len);
+
+/**
+ * Gets the number of bytes between the cursor and the end of the stream.
+ * @param cursor The cursor.
+ * @return The number of bytes.
+ */
+static inline size_t bufferstreamCursorRemaining(const buffer_stream_cursor_t *cursor)
+{
+    return cursor->stream->size - cursor->position;
+}
+
 /**
  * Gets the length of the buffer stream.
  * @param self The buffer stream.
@@ -29,19 +29,15 @@ static void defaultDestroyHandle(master_pool_t *pool, master_pool_item_t *item,
     terminateProgram(1);
 }
 
-/**
- * Creates a master pool with a specified capacity.
- * @param pool_width The width of the pool.
- * @return A pointer to the created master pool.
- */
-master_pool_t *masterpoolCreateWithCapacity(uint32_t pool_width)
+static master_pool_t *createMasterPool(uint32_t pool_width, bool lock_free)
 {
 
     pool_width = max((uint32_t) 1, pool_width);
     // half of the pool is used, other half is free at startup
     pool_width = 2 * pool_width;
 
-    const unsigned long container_len = pool_width * sizeof(master_pool_item_t *);
+    // the lock-free pool keeps its items in the ring, it does not need the trailing array
+    const unsigned long container_len = lock_free ? 0 : pool_width * sizeof(master_pool_item_t *);
 
     size_t memsize = (sizeof(master_pool_t) + container_len);
     // ensure we have enough space to offset the allocation by line cache (for alignment)
@@ -68,16 +64,45 @@ master_pool_t *masterpoolCreateWithCapacity(uint32_t pool_width)
     master_pool_t pool = {.memptr              = (void *) ptr,
                           .cap                 = pool_width,
                           .len                 = 0,
+                          .lock_free           = lock_free,
+                          .purge_activity      = 0,
+                          .purge_idle_since    = 0,
                           .create_item_handle  = defaultCreateHandle,
                           .destroy_item_handle = defaultDestroyHandle};
 
     memoryCopy(pool_ptr, &pool, sizeof(master_pool_t));
     mutexInit(&(pool_ptr->mutex));
     atomicStoreExplicit(&(pool_ptr->len), 0, memory_order_relaxed);
+    atomicStoreExplicit(&(pool_ptr->activity), 0, memory_order_relaxed);
+
+    if (lock_free)
+    {
+        masterpoolringInit(&(pool_ptr->ring), pool_width);
+    }
 
     return pool_ptr;
 }
 
+/**
+ * Creates a master pool with a specified capacity.
+ * @param pool_width The width of the pool.
+ * @return A pointer to the created master pool.
+ */
+master_pool_t *masterpoolCreateWithCapacity(uint32_t pool_width)
+{
+    return createMasterPool(pool_width, false);
+}
+
+/**
+ * Creates a master pool with a specified capacity that keeps its items in a lock-free ring.
+ * @param pool_width The width of the pool.
+ * @return A pointer to the created master pool.
+ */
+master_pool_t *masterpoolCreateWithCapacityLockFree(uint32_t pool_width)
+{
+    return createMasterPool(pool_width, true);
+}
+
 /**
  * Installs create and destroy callbacks for the master pool.
  * @param pool The master pool.
@@ -100,6 +125,16 @@ void masterpoolInstallCallBacks(master_pool_t *pool, MasterPoolItemCreateHandle
  */
 void masterpoolMakeEmpty(master_pool_t *pool, void *userdata)
 {
+    if (pool->lock_free)
+    {
+        master_pool_item_t *item;
+        while ((item = masterpoolringPop(&(pool->ring))) != NULL)
+        {
+            pool->destroy_item_handle(pool, item, userdata);
+        }
+        return;
+    }
+
     mutexLock(&(pool->mutex));
     const uint32_t current_len = (uint32_t) atomicLoadExplicit(&(pool->len), memory_order_relaxed);
     for (uint32_t i = 0; i < current_len; i++)
@@ -110,12 +145,72 @@ void masterpoolMakeEmpty(master_pool_t *pool, void *userdata)
     mutexUnlock(&(pool->mutex));
 }
 
+static uint32_t masterpoolGetActivity(master_pool_t *pool)
+{
+    if (pool->lock_free)
+    {
+        // every push and pop moves one of the ring positions
+        return (uint32_t) (atomicLoadExplicit(&(pool->ring.enqueue_pos), memory_order_relaxed) +
+                           atomicLoadExplicit(&(pool->ring.dequeue_pos), memory_order_relaxed));
+    }
+    return (uint32_t) atomicLoadExplicit(&(pool->activity), memory_order_relaxed);
+}
+
+/**
+ * Destroys every pooled item once the pool has seen no traffic for idle_ms.
+ * @param pool The master pool.
+ * @param now_ms The current time in milliseconds.
+ * @param idle_ms How long the pool must stay idle before it is emptied.
+ * @param userdata User data passed to the destroy handler.
+ * @return true if the pool was emptied.
+ */
+bool masterpoolPurgeIfIdle(master_pool_t *pool, uint64_t now_ms, uint32_t idle_ms, void *userdata)
+{
+    const uint32_t activity = masterpoolGetActivity(pool);
+
+    if (activity != pool->purge_activity || pool->purge_idle_since == 0)
+    {
+        pool->purge_activity   = activity;
+        pool->purge_idle_since = now_ms;
+        return false;
+    }
+    if (now_ms - pool->purge_idle_since < idle_ms)
+    {
+        return false;
+    }
+
+    const bool empty = pool->lock_free ? atomicLoadExplicit(&(pool->ring.enqueue_pos), memory_order_relaxed) ==
+                                             atomicLoadExplicit(&(pool->ring.dequeue_pos), memory_order_relaxed)
+                                       : atomicLoadExplicit(&(pool->len), memory_order_relaxed) == 0;
+    if (empty)
+    {
+        return false;
+    }
+
+    masterpoolMakeEmpty(pool, userdata);
+
+    // NOTE: emptying moved the ring positions, it is not traffic
+    pool->purge_activity   = masterpoolGetActivity(pool);
+    pool->purge_idle_since = now_ms;
+    return true;
+}
+
 /**
  * Destroys the master pool and frees its resources.
  * @param pool The master pool to destroy.
  */
 void masterpoolDestroy(master_pool_t *pool)
 {
+    if (pool->lock_free)
+    {
+        if (masterpoolringPop(&(pool->ring)) != NULL)
+        {
+            printError("MasterPool: Destroying pool with items in it, this is a bug");
+            terminateProgram(1);
+        }
+        masterpoolringDeInit(&(pool->ring));
+    }
+
     mutexLock(&(pool->mutex));
     if (pool->len != 0)
     {
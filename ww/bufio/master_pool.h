@@ -1,5 +1,6 @@
 #pragma once
 
+#include "master_pool_lockfree.h"
 #include "wlibc.h"
 #include "wmutex.h"
 
@@ -47,6 +48,10 @@
                                 |-----------|
 
 
+    the storage of a pool is either an array behind a mutex (masterpoolCreateWithCapacity) or a lock-free
+    ring (masterpoolCreateWithCapacityLockFree), the pools that workers migrate items through all the time
+    (buffers, messages) use the ring, the api is the same for both
+
 */
 
 struct master_pool_s;
@@ -68,6 +73,11 @@ typedef MSVC_ATTR_ALIGNED_LINE_CACHE struct master_pool_s
     MasterPoolItemDestroyHandle destroy_item_handle;
     atomic_uint                 len;
     const uint32_t              cap;
+    bool                        lock_free;
+    atomic_uint                 activity;       // get/reuse calls of the mutex mode, the ring counts its own
+    uint32_t                    purge_activity; // only touched by the thread that calls masterpoolPurgeIfIdle
+    uint64_t                    purge_idle_since;
+    master_pool_ring_t          ring; // only used when lock_free is set
     void                       *available[];
 } GNU_ATTR_ALIGNED_LINE_CACHE master_pool_t;
 
@@ -88,9 +98,28 @@ static inline void masterpoolGetItems(master_pool_t *const pool, master_pool_ite
     // return;
     uint32_t i = 0;
 
+    if (pool->lock_free)
+    {
+        for (; i < count; i++)
+        {
+            master_pool_item_t *item = masterpoolringPop(&(pool->ring));
+            if (item == NULL)
+            {
+                break;
+            }
+            iptr[i] = item;
+        }
+        for (; i < count; i++)
+        {
+            iptr[i] = pool->create_item_handle(pool, userdata);
+        }
+        return;
+    }
+
     if (atomicLoadExplicit(&(pool->len), memory_order_acquire) > 0)
     {
         mutexLock(&(pool->mutex));
+        atomicAddExplicit(&(pool->activity), 1, memory_order_relaxed);
         const uint32_t tmp_len  = (uint32_t) atomicLoadExplicit(&(pool->len), memory_order_relaxed);
         const uint32_t consumed = min(tmp_len, count);
 
@@ -128,6 +157,23 @@ static inline void masterpoolReuseItems(master_pool_t *const pool, master_pool_i
     // }
     // return;
 
+    if (pool->lock_free)
+    {
+        uint32_t i = 0;
+        for (; i < count; i++)
+        {
+            if (! masterpoolringPush(&(pool->ring), iptr[i]))
+            {
+                break;
+            }
+        }
+        for (; i < count; i++)
+        {
+            pool->destroy_item_handle(pool, iptr[i], userdata);
+        }
+        return;
+    }
+
     if (pool->cap == (uint32_t) atomicLoadExplicit(&(pool->len), memory_order_acquire))
     {
         for (uint32_t i = 0; i < count; i++)
@@ -140,6 +186,7 @@ static inline void masterpoolReuseItems(master_pool_t *const pool, master_pool_i
     uint32_t i = 0;
 
     mutexLock(&(pool->mutex));
+    atomicAddExplicit(&(pool->activity), 1, memory_order_relaxed);
 
     const uint32_t tmp_len  = (uint32_t) atomicLoadExplicit(&(pool->len), memory_order_relaxed);
     const uint32_t consumed = min(pool->cap - tmp_len, count);
@@ -175,11 +222,29 @@ void masterpoolInstallCallBacks(master_pool_t *pool, MasterPoolItemCreateHandle
  */
 master_pool_t *masterpoolCreateWithCapacity(uint32_t pool_width);
 
+/**
+ * Creates a master pool with a specified capacity that keeps its items in a lock-free ring.
+ * @param pool_width The width of the pool.
+ * @return A pointer to the created master pool.
+ */
+master_pool_t *masterpoolCreateWithCapacityLockFree(uint32_t pool_width);
+
 /*
 * remove everything from the pool, but does not destroy it
 */
 void masterpoolMakeEmpty(master_pool_t *pool,void *userdata);
 
+/**
+ * Destroys every pooled item once the pool has seen no traffic for idle_ms, so the allocator can give the memory
+ * back to the os. Call it periodically, always from the same thread.
+ * @param pool The master pool.
+ * @param now_ms The current time in milliseconds.
+ * @param idle_ms How long the pool must stay idle before it is emptied.
+ * @param userdata User data passed to the destroy handler.
+ * @return true if the pool was emptied.
+ */
+bool masterpoolPurgeIfIdle(master_pool_t *pool, uint64_t now_ms, uint32_t idle_ms, void *userdata);
+
 /**
  * Destroys the master pool and frees its resources.
  * @param pool The master pool to destroy.
@@ -0,0 +1,265 @@
+#include "sbuf_arena.h"
+#include "loggers/internal_logger.h"
+#include "master_pool_lockfree.h"
+#include "wmutex.h"
+
+#if defined(OS_LINUX)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum
+{
+    kArenaChunkSize = 2 * 1024 * 1024,
+    kMpolPreferred  = 1 // numaif.h is not always installed, the value is part of the kernel abi
+};
+
+struct sbuf_arena_s
+{
+    wmutex_t           grow_mutex;
+    master_pool_ring_t free_slots;
+    void             **chunks;
+    atomic_uint        chunks_count;
+    uint32_t           chunks_max;
+    uint32_t           slot_size;
+    uint32_t           slots_per_chunk;
+    uint32_t           real_cap;
+    uint16_t           pad_left;
+    int                numa_node;
+    atomic_bool        hugepages;
+    atomic_uint        slots_used;
+    atomic_uint        refs; // owner + one per buffer out of the arena
+};
+
+sbuf_arena_t *sbufarenaCreate(uint32_t minimum_capacity, uint16_t pad_left, size_t max_bytes)
+{
+    sbuf_arena_t *arena = memoryAllocate(sizeof(sbuf_arena_t));
+
+    uint32_t real_cap = sbufCalcRealCapacity(minimum_capacity, &pad_left);
+    uint32_t slot     = (uint32_t) ALIGN2(sizeof(sbuf_t) + real_cap, kCpuLineCacheSize);
+
+    // NOTE: a buffer bigger than a chunk gains nothing from the arena, it gets one slot per chunk anyway
+    uint32_t slots_per_chunk = max((uint32_t) 1, (uint32_t) (kArenaChunkSize / slot));
+    uint32_t chunks_max      = (uint32_t) max((size_t) 1, max_bytes / kArenaChunkSize);
+
+    *arena = (sbuf_arena_t) {.chunks          = memoryAllocate(sizeof(void *) * chunks_max),
+                             .chunks_max      = chunks_max,
+                             .slot_size       = slot,
+                             .slots_per_chunk = slots_per_chunk,
+                             .real_cap        = real_cap,
+                             .pad_left        = pad_left,
+                             .numa_node       = -1};
+
+    mutexInit(&arena->grow_mutex);
+    masterpoolringInit(&arena->free_slots, slots_per_chunk * chunks_max);
+    atomicStoreExplicit(&arena->chunks_count, 0, memory_order_relaxed);
+    atomicStoreExplicit(&arena->hugepages, true, memory_order_relaxed);
+    atomicStoreExplicit(&arena->slots_used, 0, memory_order_relaxed);
+    atomicStoreExplicit(&arena->refs, 1, memory_order_release);
+    return arena;
+}
+
+static void destroyArena(sbuf_arena_t *arena)
+{
+    const uint32_t chunks_count = atomicLoadExplicit(&arena->chunks_count, memory_order_acquire);
+    for (uint32_t i = 0; i < chunks_count; i++)
+    {
+#if defined(OS_LINUX)
+        munmap(arena->chunks[i], kArenaChunkSize);
+#endif
+    }
+    masterpoolringDeInit(&arena->free_slots);
+    mutexDestroy(&arena->grow_mutex);
+    memoryFree((void *) arena->chunks);
+    memoryFree(arena);
+}
+
+static void arenaUnRef(sbuf_arena_t *arena)
+{
+    if (atomicSubExplicit(&arena->refs, 1, memory_order_acq_rel) == 1)
+    {
+        destroyArena(arena);
+    }
+}
+
+void sbufarenaRelease(sbuf_arena_t *arena)
+{
+    arenaUnRef(arena);
+}
+
+#if defined(OS_LINUX)
+
+static int currentNumaNode(void)
+{
+    unsigned int cpu  = 0;
+    unsigned int node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+    {
+        return -1;
+    }
+    return (int) node;
+}
+
+static void bindToNumaNode(void *chunk, int node)
+{
+    if (node < 0 || node >= (int) (sizeof(unsigned long) * 8))
+    {
+        return;
+    }
+    unsigned long nodemask = 1UL << node;
+    // preferred, not strict: a full node should not turn into allocation failures
+    discard syscall(SYS_mbind, chunk, (unsigned long) kArenaChunkSize, kMpolPreferred, &nodemask,
+                    sizeof(nodemask) * 8, 0);
+}
+
+static void *mapChunk(sbuf_arena_t *arena, bool *hugepages)
+{
+    void *chunk = mmap(NULL, kArenaChunkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1,
+                       0);
+    if (chunk != MAP_FAILED)
+    {
+        *hugepages = true;
+        bindToNumaNode(chunk, arena->numa_node);
+        return chunk;
+    }
+
+    // no reserved hugepages, map twice the size to get a 2MB aligned chunk that transparent hugepages can back
+    uint8_t *raw = mmap(NULL, 2 * kArenaChunkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return NULL;
+    }
+    uint8_t *aligned = (uint8_t *) ALIGN2((uintptr_t) raw, kArenaChunkSize);
+    if (aligned > raw)
+    {
+        munmap(raw, (size_t) (aligned - raw));
+    }
+    munmap(aligned + kArenaChunkSize, (size_t) ((raw + 2 * kArenaChunkSize) - (aligned + kArenaChunkSize)));
+
+#if defined(MADV_HUGEPAGE)
+    madvise(aligned, kArenaChunkSize, MADV_HUGEPAGE);
+#endif
+    *hugepages = false;
+    bindToNumaNode(aligned, arena->numa_node);
+    return aligned;
+}
+
+#else
+
+static int currentNumaNode(void)
+{
+    return -1;
+}
+
+static void *mapChunk(sbuf_arena_t *arena, bool *hugepages)
+{
+    // NOTE: only linux has a chunk source for now, buffers come from the heap elsewhere
+    discard arena;
+    *hugepages = false;
+    return NULL;
+}
+
+#endif
+
+static uint8_t *growArena(sbuf_arena_t *arena)
+{
+    mutexLock(&arena->grow_mutex);
+
+    // another thread may have grown the arena, or buffers came back while we waited
+    uint8_t *slot = masterpoolringPop(&arena->free_slots);
+    if (slot != NULL)
+    {
+        mutexUnlock(&arena->grow_mutex);
+        return slot;
+    }
+
+    const uint32_t chunks_count = atomicLoadExplicit(&arena->chunks_count, memory_order_relaxed);
+    if (chunks_count == arena->chunks_max)
+    {
+        mutexUnlock(&arena->grow_mutex);
+        return NULL;
+    }
+    if (arena->numa_node < 0)
+    {
+        arena->numa_node = currentNumaNode();
+    }
+
+    bool     hugepages = false;
+    uint8_t *chunk     = mapChunk(arena, &hugepages);
+    if (chunk == NULL)
+    {
+        mutexUnlock(&arena->grow_mutex);
+        return NULL;
+    }
+    if (! hugepages && atomicLoadExplicit(&arena->hugepages, memory_order_relaxed))
+    {
+        atomicStoreExplicit(&arena->hugepages, false, memory_order_relaxed);
+        LOGD("SbufArena: no reserved hugepages, chunks rely on transparent hugepages");
+    }
+
+    arena->chunks[chunks_count] = chunk;
+    atomicStoreExplicit(&arena->chunks_count, chunks_count + 1, memory_order_release);
+
+    for (uint32_t i = 1; i < arena->slots_per_chunk; i++)
+    {
+        masterpoolringPush(&arena->free_slots, chunk + ((size_t) i * arena->slot_size));
+    }
+
+    mutexUnlock(&arena->grow_mutex);
+    return chunk;
+}
+
+sbuf_t *sbufarenaAllocate(sbuf_arena_t *arena)
+{
+    uint8_t *slot = masterpoolringPop(&arena->free_slots);
+    if (slot == NULL)
+    {
+        slot = growArena(arena);
+        if (slot == NULL)
+        {
+            return NULL;
+        }
+    }
+    atomicAddExplicit(&arena->slots_used, 1, memory_order_relaxed);
+    atomicAddExplicit(&arena->refs, 1, memory_order_relaxed);
+
+    sbuf_t *b = (sbuf_t *) slot;
+
+#ifdef DEBUG
+    memorySet(b->buf, 0x55, arena->real_cap);
+#endif
+
+    b->alloc_offset = 0;
+    b->arena        = arena;
+    b->map_len      = 0;
+    atomicStoreExplicit(&b->refs, 0, memory_order_relaxed);
+    b->is_temporary = false;
+    b->len          = 0;
+    b->curpos       = arena->pad_left;
+    b->capacity     = arena->real_cap;
+    b->l_pad        = arena->pad_left;
+
+    return b;
+}
+
+void sbufarenaFree(sbuf_arena_t *arena, sbuf_t *b)
+{
+    // NOTE: the ring holds every slot of every chunk, a push can not fail
+    masterpoolringPush(&arena->free_slots, b);
+    atomicSubExplicit(&arena->slots_used, 1, memory_order_relaxed);
+    arenaUnRef(arena);
+}
+
+void sbufarenaGetStats(sbuf_arena_t *arena, sbuf_arena_stats_t *stats)
+{
+    const uint32_t chunks = atomicLoadExplicit(&arena->chunks_count, memory_order_acquire);
+
+    *stats = (sbuf_arena_stats_t) {.slots_used  = atomicLoadExplicit(&arena->slots_used, memory_order_relaxed),
+                                   .slots_total = chunks * arena->slots_per_chunk,
+                                   .chunks      = chunks,
+                                   .chunks_max  = arena->chunks_max,
+                                   .numa_node   = arena->numa_node,
+                                   .hugepages   = chunks > 0 && atomicLoadExplicit(&arena->hugepages,
+                                                                                   memory_order_relaxed)};
+}
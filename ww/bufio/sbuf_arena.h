@@ -0,0 +1,70 @@
+#pragma once
+
+#include "shiftbuffer.h"
+#include "wlibc.h"
+
+/*
+    Slab arena for shift buffers
+
+    carves fixed size, cache line aligned sbufs out of 2MB chunks instead of allocating every buffer from the
+    heap, a worker moving lots of data touches a handful of hugepages instead of thousands of scattered 4k pages
+
+    chunks are mapped with MAP_HUGETLB when the system has reserved hugepages, otherwise a 2MB aligned region is
+    mapped and transparent hugepages are asked for (madvise), the chunk is bound to the numa node of the thread
+    that grows the arena (the worker that owns it)
+
+    when a chunk can not be mapped or the arena reached its limit, sbufarenaAllocate returns NULL and the caller
+    falls back to sbufCreateWithPadding, buffers from both sources look the same to everyone else
+
+    buffers may be destroyed on any thread, the free slots live in a lock-free ring; the arena stays alive until
+    its owner released it and the last of its buffers was destroyed
+*/
+
+typedef struct sbuf_arena_s sbuf_arena_t;
+
+typedef struct sbuf_arena_stats_s
+{
+    uint32_t slots_used;
+    uint32_t slots_total; // slots of the chunks mapped so far
+    uint32_t chunks;
+    uint32_t chunks_max;
+    int      numa_node; // -1 if unknown
+    bool     hugepages; // every chunk is backed by reserved hugepages
+
+} sbuf_arena_stats_t;
+
+/**
+ * Creates an arena for buffers of one layout, nothing is mapped until the first allocation.
+ * @param minimum_capacity The capacity of each buffer, as passed to sbufCreateWithPadding.
+ * @param pad_left The left padding of each buffer.
+ * @param max_bytes Upper limit of the memory the arena may map.
+ * @return The arena.
+ */
+sbuf_arena_t *sbufarenaCreate(uint32_t minimum_capacity, uint16_t pad_left, size_t max_bytes);
+
+/**
+ * Drops the owner reference, the memory is unmapped once every buffer of the arena is destroyed.
+ * @param arena The arena.
+ */
+void sbufarenaRelease(sbuf_arena_t *arena);
+
+/**
+ * Takes a buffer from the arena, maps a new chunk when needed.
+ * @param arena The arena.
+ * @return The buffer, or NULL if the arena is full or no memory could be mapped.
+ */
+sbuf_t *sbufarenaAllocate(sbuf_arena_t *arena);
+
+/**
+ * Gives a buffer back to its arena, sbufDestroy calls this for arena buffers. Thread safe.
+ * @param arena The arena the buffer came from.
+ * @param b The buffer.
+ */
+void sbufarenaFree(sbuf_arena_t *arena, sbuf_t *b);
+
+/**
+ * Reads the occupancy of the arena.
+ * @param arena The arena.
+ * @param stats Receives the numbers.
+ */
+void sbufarenaGetStats(sbuf_arena_t *arena, sbuf_arena_stats_t *stats);
@@ -0,0 +1,79 @@
+#include "sbuf_chain.h"
+
+void sbufchainAppend(buffer_pool_t *pool, sbuf_chain_t *c, sbuf_t *b)
+{
+    uint32_t blen = sbufGetLength(b);
+    assert(c->length <= UINT32_MAX - blen);
+
+    if (c->first + c->count == SBUF_CHAIN_MAX_SEGMENTS)
+    {
+        if (c->first > 0)
+        {
+            memoryMove(&c->segments[0], &c->segments[c->first], sizeof(sbuf_t *) * c->count);
+            c->first = 0;
+        }
+        else
+        {
+            // NOTE: out of slots, pay for one copy rather than growing the chain
+            sbuf_t **last = &c->segments[c->count - 1];
+            *last         = sbufAppendMerge(pool, *last, b);
+            c->length += blen;
+            return;
+        }
+    }
+
+    c->segments[c->first + c->count] = b;
+    c->count++;
+    c->length += blen;
+}
+
+sbuf_t *sbufchainPopFront(sbuf_chain_t *c)
+{
+    if (c->count == 0)
+    {
+        return NULL;
+    }
+    sbuf_t *b = c->segments[c->first];
+    c->first++;
+    c->count--;
+    c->length -= sbufGetLength(b);
+    if (c->count == 0)
+    {
+        c->first = 0;
+    }
+    return b;
+}
+
+void sbufchainShiftRight(buffer_pool_t *pool, sbuf_chain_t *c, uint32_t bytes)
+{
+    assert(bytes <= c->length);
+
+    while (bytes > 0)
+    {
+        sbuf_t  *b    = c->segments[c->first];
+        uint32_t blen = sbufGetLength(b);
+
+        if (bytes < blen)
+        {
+            sbufShiftRight(b, bytes);
+            c->length -= bytes;
+            return;
+        }
+        bufferpoolReuseBuffer(pool, sbufchainPopFront(c));
+        bytes -= blen;
+    }
+    // NOTE: do not leave an empty segment at the front, users forward the segments as payloads
+    while (c->count > 0 && sbufGetLength(c->segments[c->first]) == 0)
+    {
+        bufferpoolReuseBuffer(pool, sbufchainPopFront(c));
+    }
+}
+
+void sbufchainRelease(buffer_pool_t *pool, sbuf_chain_t *c)
+{
+    sbuf_t *b;
+    while ((b = sbufchainPopFront(c)) != NULL)
+    {
+        bufferpoolReuseBuffer(pool, b);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "buffer_pool.h"
+#include "shiftbuffer.h"
+#include "wlibc.h"
+
+/*
+    sbuf_chain_t holds one piece of data (a frame, a record, ...) as the buffers it arrived in
+
+    protocols that only need contiguity for a few header bytes read them before cutting the frame (see
+    bufferstreamReadExactChain), then drop the header and forward the segments one by one
+
+    the chain is a value type (lives on the stack), it owns its segments until they are popped or released
+*/
+
+#define SBUF_CHAIN_MAX_SEGMENTS 16
+
+typedef struct sbuf_chain_s
+{
+    sbuf_t  *segments[SBUF_CHAIN_MAX_SEGMENTS];
+    uint32_t first; // index of the first segment
+    uint32_t count;
+    uint32_t length; // total bytes in all segments
+
+} sbuf_chain_t;
+
+static inline void sbufchainInit(sbuf_chain_t *c)
+{
+    c->first  = 0;
+    c->count  = 0;
+    c->length = 0;
+}
+
+static inline uint32_t sbufchainGetLength(const sbuf_chain_t *c)
+{
+    return c->length;
+}
+
+static inline uint32_t sbufchainGetSegmentsCount(const sbuf_chain_t *c)
+{
+    return c->count;
+}
+
+static inline sbuf_t *sbufchainGetSegment(const sbuf_chain_t *c, uint32_t index)
+{
+    assert(index < c->count);
+    return c->segments[c->first + index];
+}
+
+/**
+ * Appends a buffer to the end of the chain, the chain takes its ownership.
+ * When the chain has no free slot the buffer is merged into the last segment (a copy).
+ */
+void sbufchainAppend(buffer_pool_t *pool, sbuf_chain_t *c, sbuf_t *b);
+
+/**
+ * Takes the first segment out of the chain, the caller owns it afterwards.
+ * @return the segment or NULL if the chain is empty.
+ */
+sbuf_t *sbufchainPopFront(sbuf_chain_t *c);
+
+/**
+ * Drops bytes from the front of the chain, segments that become empty are returned to the pool.
+ */
+void sbufchainShiftRight(buffer_pool_t *pool, sbuf_chain_t *c, uint32_t bytes);
+
+/**
+ * Returns every segment to the pool and empties the chain.
+ */
+void sbufchainRelease(buffer_pool_t *pool, sbuf_chain_t *c);
@@ -1,6 +1,11 @@
 #include "shiftbuffer.h"
+#include "sbuf_arena.h"
 #include "wlibc.h"
 
+#if defined(OS_LINUX)
+#include <sys/mman.h>
+#endif
+
 // #define LEFTPADDING  ((RAM_PROFILE >= kRamProfileS2Memory ? (1U << 10) : (1U << 8)) - (sizeof(uint32_t) * 3))
 // #define RIGHTPADDING ((RAM_PROFILE >= kRamProfileS2Memory ? (1U << 9) : (1U << 7)))
 
@@ -15,32 +20,53 @@ void sbufDestroy(sbuf_t *b)
     {
         return;
     }
-    
-    memoryFree(b->original_ptr);
+    if (! sbufShareDrop(b))
+    {
+        return;
+    }
+    if (b->arena != NULL)
+    {
+        sbufarenaFree(b->arena, b);
+        return;
+    }
+    if (UNLIKELY(sbufIsMapped(b)))
+    {
+        sbufMappingRelease(sbufGetMapping(b));
+        return;
+    }
+
+    memoryFree(((uint8_t *) b) - b->alloc_offset);
 }
 
 /**
- * Creates a new shift buffer with specified capacity and left padding.
+ * Drops one reference to the window behind mapped views, the last one unmaps it.
  */
-sbuf_t *sbufCreateWithPadding(uint32_t minimum_capacity, uint16_t pad_left)
+void sbufMappingRelease(sbuf_mapping_t *m)
 {
-    // Ensure pad_left is always a multiple of 32 for optimal alignment
-    pad_left = (pad_left + 31) & ~31;
-
-    if (minimum_capacity != 0 && minimum_capacity % kCpuLineCacheSize != 0)
+    if (atomicSubExplicit(&m->refs, 1, memory_order_acq_rel) == 1)
     {
-        minimum_capacity =
-            (max(kCpuLineCacheSize, minimum_capacity) + kCpuLineCacheSizeMin1) & (~kCpuLineCacheSizeMin1);
+#if defined(OS_LINUX)
+        munmap(m->base, m->len);
+#endif
     }
+}
 
-    uint32_t real_cap = minimum_capacity + pad_left;
+/**
+ * Creates a new shift buffer with specified capacity and left padding.
+ */
+sbuf_t *sbufCreateWithPadding(uint32_t minimum_capacity, uint16_t pad_left)
+{
+    uint32_t real_cap = sbufCalcRealCapacity(minimum_capacity, &pad_left);
     
     size_t total_size = real_cap + sizeof(sbuf_t) + 31;
     void *raw_ptr = memoryAllocate(total_size);
     
     sbuf_t *b = (sbuf_t *)ALIGN2(raw_ptr, 32);
     
-    b->original_ptr = raw_ptr;
+    b->alloc_offset = (uint8_t) ((uint8_t *) b - (uint8_t *) raw_ptr);
+    b->arena        = NULL;
+    b->map_len      = 0;
+    atomicStoreExplicit(&b->refs, 0, memory_order_relaxed);
     
 #ifdef DEBUG
     memorySet(b->buf, 0x55, real_cap);
@@ -13,6 +13,33 @@
     it will be aligned to 32 bytes boundary which will help memoryCopyAVX2 to use Aligned memory copy
 */
 
+/*
+    Shared buffers
+
+    sbufShare hands the same buffer to one more owner without copying the payload (fan-out, keeping a packet for
+    retransmission, ...), a shared buffer is immutable: its header and payload belong to all owners
+
+    an owner that wants to change it (shift headers, write) calls sbufCopyOnWriteByPool first, which gives back
+    the same buffer if everyone else already let go, or a private copy otherwise
+
+    dropping a shared buffer (bufferpoolReuseBuffer, sbufDestroy) only drops one reference, the storage goes back
+    to the pool of whoever drops the last one
+*/
+
+/*
+    Mapped views
+
+    a tcp io with zero-copy receive hands out buffers whose payload is socket memory mapped by the kernel
+    (TCP_ZEROCOPY_RECEIVE) into a window the io keeps for the whole connection; the window starts with a private
+    page that ends with its sbuf_mapping_t and the header of the view, the payload is read only and there is no
+    padding or room to grow
+
+    everything that only reads or forwards the bytes treats a view like any other buffer, writers must go through
+    sbufCopyOnWriteByPool like for shared buffers (sbufReserveSpace and sbufAppendMerge already do); the io and
+    its current view each hold a reference to the window, the io maps into it again only once the view is gone
+    and the last reference unmaps it
+*/
+
 struct sbuf_s
 {
     uint32_t curpos;
@@ -20,9 +47,10 @@ struct sbuf_s
     uint32_t capacity;
     uint16_t l_pad;
     bool     is_temporary; // if true, this buffer will not be freed or reused in pools (like stack buffer)
-    uint8_t  _padding1;    // padding to align to 8 bytes
-    void    *original_ptr; // store original malloc pointer for proper freeing
-    uint64_t _padding2;    // padding to make struct exactly 32 bytes
+    uint8_t  alloc_offset; // distance from the start of the allocation (alignment), for proper freeing
+    atomic_uint          refs;      // owners besides the first one, 0 = not shared
+    uint32_t             map_len;   // bytes of the window behind a receive view (header page included), else 0
+    struct sbuf_arena_s *arena;     // slab arena the buffer was carved from, NULL for heap buffers
     MSVC_ATTR_ALIGNED_16 uint8_t buf[] GNU_ATTR_ALIGNED_16;
 };
 
@@ -32,6 +60,19 @@ typedef struct sbuf_s sbuf_t;
 
 static_assert(SIZEOF_STRUCT_SBUF == 32, "sbuf_s size should be 32 bytes, buf array is flexible");
 
+// sits right before the header of a mapped view, see Mapped views
+typedef struct sbuf_mapping_s
+{
+    uint8_t    *base; // start of the window (header page)
+    size_t      len;  // bytes of the window
+    atomic_uint refs; // the io and its current view
+} sbuf_mapping_t;
+
+/**
+ * Drops one reference to the window behind mapped views, the last one unmaps it.
+ */
+void sbufMappingRelease(sbuf_mapping_t *m);
+
 /**
  * Destroys the shift buffer and frees its memory.
  */
@@ -43,10 +84,82 @@ void sbufDestroy(sbuf_t *b);
 static inline void sbufReset(sbuf_t *b)
 {
     assert(! b->is_temporary);
+    assert(atomicLoadExplicit(&b->refs, memory_order_relaxed) == 0);
     b->len    = 0;
     b->curpos = b->l_pad;
 }
 
+/**
+ * Adds an owner to the buffer, both owners must treat it as read only from now on.
+ * @return The same buffer, for the new owner.
+ */
+static inline sbuf_t *sbufShare(sbuf_t *b)
+{
+    assert(! b->is_temporary);
+    atomicAddExplicit(&b->refs, 1, memory_order_relaxed);
+    return b;
+}
+
+/**
+ * Checks whether other owners may be reading the buffer.
+ */
+static inline bool sbufIsShared(sbuf_t *b)
+{
+    return atomicLoadExplicit(&b->refs, memory_order_acquire) != 0;
+}
+
+/**
+ * Checks whether the payload is read only socket memory, see Mapped views.
+ */
+static inline bool sbufIsMapped(const sbuf_t *b)
+{
+    return b->map_len != 0;
+}
+
+/**
+ * Gets the window a mapped view was received into.
+ */
+static inline sbuf_mapping_t *sbufGetMapping(sbuf_t *b)
+{
+    assert(sbufIsMapped(b));
+    return ((sbuf_mapping_t *) (void *) b) - 1;
+}
+
+/**
+ * Gives up one ownership of the buffer.
+ * @return true if the caller was the last owner and may reuse or free the storage.
+ */
+static inline bool sbufShareDrop(sbuf_t *b)
+{
+    unsigned int refs = atomicLoadExplicit(&b->refs, memory_order_acquire);
+    while (refs != 0)
+    {
+        if (atomic_compare_exchange_weak_explicit(&b->refs, &refs, refs - 1, memory_order_acq_rel,
+                                                  memory_order_acquire))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Rounds the requested sizes to the layout of every sbuf (padding to 32 bytes, capacity to cache lines).
+ * @return The capacity of the buffer including the left padding.
+ */
+static inline uint32_t sbufCalcRealCapacity(uint32_t minimum_capacity, uint16_t *pad_left)
+{
+    // Ensure pad_left is always a multiple of 32 for optimal alignment
+    *pad_left = (uint16_t) ((*pad_left + 31) & ~31);
+
+    if (minimum_capacity != 0 && minimum_capacity % kCpuLineCacheSize != 0)
+    {
+        minimum_capacity =
+            (max(kCpuLineCacheSize, minimum_capacity) + kCpuLineCacheSizeMin1) & (~kCpuLineCacheSizeMin1);
+    }
+    return minimum_capacity + *pad_left;
+}
+
 /**
  * Creates a new shift buffer with specified capacity and left padding.
  */
@@ -234,12 +347,14 @@ static inline void sbufWriteBuf(sbuf_t *restrict const to, sbuf_t *restrict cons
  */
 static inline sbuf_t *sbufReserveSpace(sbuf_t *const b, const uint32_t bytes)
 {
-    if (sbufGetRightCapacity(b) < bytes)
+    // NOTE: a mapped view is read only and the room behind a shared buffer may be another owner's bytes (a chain
+    // read splits a buffer that way), both move to a private buffer even if they have the room
+    if (sbufGetRightCapacity(b) < bytes || UNLIKELY(sbufIsMapped(b) || sbufIsShared(b)))
     {
         uint32_t needed_capacity = sbufGetLength(b) + bytes;
         sbuf_t  *bigger_buf      = sbufCreateWithPadding(needed_capacity, b->l_pad);
-        sbufSetLength(bigger_buf, sbufGetLength(b));
         sbufWriteBuf(bigger_buf, b, sbufGetLength(b));
+        sbufSetLength(bigger_buf, sbufGetLength(b));
         sbufDestroy(b);
         return bigger_buf;
     }
@@ -0,0 +1,738 @@
+#include "iowatcher.h"
+
+#ifdef EVENT_IO_URING
+#include "wplatform.h"
+#include "wdef.h"
+#include "wevent.h"
+#include "loggers/internal_logger.h"
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/*
+    io_uring iowatcher
+
+    Readiness is watched with one-shot IORING_OP_POLL_ADD requests. Every change of interest (add/del/re-arm) is
+    only queued into the submission ring and all of them are flushed together with the wait itself, so one
+    io_uring_enter() per loop iteration replaces the epoll_ctl() storm plus epoll_wait() of the epoll backend.
+
+    One-shot polls are used on purpose: nio handlers read/write once per readiness event and rely on level
+    triggered semantics, a multishot poll only reports new wakeups (edge triggered) and could strand data.
+
+    Reads of connected tcp streams are completion based instead (linux 6.0+): one multishot IORING_OP_RECV per
+    io picks buffers from a provided buffer ring that is filled with large buffers of the loop's pool, every
+    completion is queued on the io (uring_rx_queue) and nio_read hands the queue out without a recv() call.
+    Pausing the io cancels the recv, whatever completed meanwhile waits in the queue. Listeners, connecting
+    sockets, udp and zero-copy receive stay readiness based: multishot accept can not give the peer address
+    and the accept budget of nio_accept; writes stay readiness based too, nio_write already gathers the queue.
+    Fixed files are not registered, a multishot recv takes its file reference once for its whole lifetime.
+
+    per io state (the event_index[] slots are free for this backend):
+        event_index[0] -> mask of the poll request currently in flight, -1 when nothing is armed
+        event_index[1] -> sequence number of that request, used to drop stale completions
+        uring_rx_*     -> recv state, see wevent.h
+
+    user_data of the requests (low half / high half):
+        poll        fd                                  / sequence number
+        recv        IO_URING_RECV_FLAG | generation | fd / io id
+        timeout     IO_URING_TIMEOUT_FD                 / sequence number, IO_URING_IGNORE_DATA for the rest
+*/
+
+#define IO_URING_ENTRIES        1024
+#define IO_URING_TIMEOUT_FD     UINT32_MAX
+#define IO_URING_IGNORE_DATA    UINT64_MAX  // removes and cancels, their own completions mean nothing
+#define IO_URING_RECV_FLAG      0x80000000U
+#define IO_URING_RECV_GEN_SHIFT 24
+#define IO_URING_RECV_GEN_MASK  0x7FU
+#define IO_URING_FD_MASK        0x00FFFFFFU // recv requests only go to fds that fit
+#define IO_URING_RECV_BUFFERS   128         // large buffers of the pool sitting in the provided buffer ring
+#define IO_URING_RECV_BGID      0
+#define REARMS_INIT_SIZE        64
+
+#include "array.h"
+ARRAY_DECL(int, rearms)
+ARRAY_DECL(struct io_uring_cqe, later_cqes)
+
+typedef struct io_uring_ctx_s {
+    int                     ring_fd;
+    unsigned                features;
+    // submission ring
+    unsigned*               sq_head;
+    unsigned*               sq_tail;
+    unsigned*               sq_mask;
+    unsigned*               sq_array;
+    struct io_uring_sqe*    sqes;
+    unsigned                sq_entries;
+    unsigned                to_submit;
+    // completion ring
+    unsigned*               cq_head;
+    unsigned*               cq_tail;
+    unsigned*               cq_mask;
+    struct io_uring_cqe*    cqes;
+    // mappings
+    void*                   sq_ring_ptr;
+    size_t                  sq_ring_size;
+    void*                   cq_ring_ptr;
+    size_t                  cq_ring_size;
+    size_t                  sqes_size;
+    // provided buffer ring of the multishot recv, NULL when the kernel has none
+    struct io_uring_buf_ring* br;
+    size_t                  br_size;
+    sbuf_t**                br_bufs;    // buffer behind each bid
+    uint16_t                br_tail;
+    bool                    recv_multishot; // cleared if the kernel turns the first multishot recv down
+    // bookkeeping
+    uint32_t                seq;
+    int                     nfds;
+    struct rearms           rearms;
+    struct later_cqes       later_cqes;   // read while an io was detached, handled by the next poll
+    struct __kernel_timespec timeout_ts;
+    uint32_t                timeout_seq;
+    bool                    timeout_armed; // a wait timeout request is still in the kernel (no IORING_FEAT_EXT_ARG)
+} io_uring_ctx_t;
+
+static int ioUringSetup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int ioUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int ioUringRegister(int ring_fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static int ioUringMapRings(io_uring_ctx_t* ctx, struct io_uring_params* p) {
+    ctx->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    ctx->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        ctx->sq_ring_size = max(ctx->sq_ring_size, ctx->cq_ring_size);
+        ctx->cq_ring_size = ctx->sq_ring_size;
+    }
+    ctx->sq_ring_ptr = mmap(NULL, ctx->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ctx->ring_fd, IORING_OFF_SQ_RING);
+    if (ctx->sq_ring_ptr == MAP_FAILED) {
+        return -1;
+    }
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        ctx->cq_ring_ptr = ctx->sq_ring_ptr;
+    }
+    else {
+        ctx->cq_ring_ptr = mmap(NULL, ctx->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                ctx->ring_fd, IORING_OFF_CQ_RING);
+        if (ctx->cq_ring_ptr == MAP_FAILED) {
+            munmap(ctx->sq_ring_ptr, ctx->sq_ring_size);
+            return -1;
+        }
+    }
+    ctx->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    ctx->sqes = mmap(NULL, ctx->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ctx->ring_fd, IORING_OFF_SQES);
+    if (ctx->sqes == MAP_FAILED) {
+        if (ctx->cq_ring_ptr != ctx->sq_ring_ptr) {
+            munmap(ctx->cq_ring_ptr, ctx->cq_ring_size);
+        }
+        munmap(ctx->sq_ring_ptr, ctx->sq_ring_size);
+        return -1;
+    }
+
+    char* sq = (char*)ctx->sq_ring_ptr;
+    char* cq = (char*)ctx->cq_ring_ptr;
+    ctx->sq_head    = (unsigned*)(sq + p->sq_off.head);
+    ctx->sq_tail    = (unsigned*)(sq + p->sq_off.tail);
+    ctx->sq_mask    = (unsigned*)(sq + p->sq_off.ring_mask);
+    ctx->sq_array   = (unsigned*)(sq + p->sq_off.array);
+    ctx->sq_entries = p->sq_entries;
+    ctx->cq_head    = (unsigned*)(cq + p->cq_off.head);
+    ctx->cq_tail    = (unsigned*)(cq + p->cq_off.tail);
+    ctx->cq_mask    = (unsigned*)(cq + p->cq_off.ring_mask);
+    ctx->cqes       = (struct io_uring_cqe*)(cq + p->cq_off.cqes);
+    return 0;
+}
+
+// push every queued sqe to the kernel without waiting
+static void ioUringFlush(io_uring_ctx_t* ctx) {
+    while (ctx->to_submit > 0) {
+        int ret = ioUringEnter(ctx->ring_fd, ctx->to_submit, 0, 0, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            printError("io_uring_enter");
+            return;
+        }
+        ctx->to_submit -= (unsigned)ret;
+        if (ret == 0) break;
+    }
+}
+
+static struct io_uring_sqe* ioUringGetSqe(io_uring_ctx_t* ctx) {
+    unsigned head = __atomic_load_n(ctx->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ctx->sq_tail;
+    if (tail - head >= ctx->sq_entries) {
+        // ring is full, hand what we have to the kernel first
+        ioUringFlush(ctx);
+        head = __atomic_load_n(ctx->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= ctx->sq_entries) {
+            return NULL;
+        }
+    }
+    unsigned idx = tail & *ctx->sq_mask;
+    struct io_uring_sqe* sqe = ctx->sqes + idx;
+    memorySet(sqe, 0, sizeof(*sqe));
+    ctx->sq_array[idx] = idx;
+    __atomic_store_n(ctx->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ctx->to_submit++;
+    return sqe;
+}
+
+static inline uint64_t ioUringUserData(int fd, int seq) {
+    return ((uint64_t)(uint32_t)seq << 32) | (uint32_t)fd;
+}
+
+static void ioUringArm(io_uring_ctx_t* ctx, wio_t* io, int events) {
+    struct io_uring_sqe* sqe = ioUringGetSqe(ctx);
+    if (sqe == NULL) {
+        printError("io_uring submission queue overflow");
+        return;
+    }
+    uint32_t poll_mask = 0;
+    if (events & WW_READ) {
+        poll_mask |= POLLIN;
+    }
+    if (events & WW_WRITE) {
+        poll_mask |= POLLOUT;
+    }
+    int seq = (int)(ctx->seq++ & 0x7FFFFFFF);
+    sqe->opcode        = IORING_OP_POLL_ADD;
+    sqe->fd            = io->fd;
+    sqe->poll32_events = poll_mask;
+    sqe->user_data     = ioUringUserData(io->fd, seq);
+    io->event_index[0] = events;
+    io->event_index[1] = seq;
+}
+
+static void ioUringDisarm(io_uring_ctx_t* ctx, wio_t* io) {
+    if (io->event_index[0] < 0) return;
+    struct io_uring_sqe* sqe = ioUringGetSqe(ctx);
+    if (sqe == NULL) {
+        printError("io_uring submission queue overflow");
+        return;
+    }
+    sqe->opcode    = IORING_OP_POLL_REMOVE;
+    sqe->fd        = -1;
+    sqe->addr      = ioUringUserData(io->fd, io->event_index[1]);
+    // the completion of the remove request itself carries this, it is ignored as stale
+    sqe->user_data = ioUringUserData(io->fd, -1);
+    io->event_index[0] = -1;
+}
+
+static void ioUringRearmLater(io_uring_ctx_t* ctx, int fd) {
+    if (ctx->rearms.size == ctx->rearms.maxsize) {
+        rearms_double_resize(&ctx->rearms);
+    }
+    ctx->rearms.ptr[ctx->rearms.size++] = fd;
+}
+
+static inline uint64_t ioUringTimeoutUserData(uint32_t seq) {
+    return ((uint64_t)seq << 32) | IO_URING_TIMEOUT_FD;
+}
+
+static void ioUringArmTimeout(io_uring_ctx_t* ctx, int timeout) {
+    struct io_uring_sqe* sqe = ioUringGetSqe(ctx);
+    if (sqe == NULL) return;
+    ctx->timeout_ts.tv_sec  = timeout / 1000;
+    ctx->timeout_ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+    ctx->timeout_seq        = (ctx->timeout_seq + 1) & 0x7FFFFFFF;
+    sqe->opcode    = IORING_OP_TIMEOUT;
+    sqe->fd        = -1;
+    sqe->addr      = (uint64_t)(uintptr_t)&ctx->timeout_ts;
+    sqe->len       = 1;
+    sqe->user_data = ioUringTimeoutUserData(ctx->timeout_seq);
+    ctx->timeout_armed = true;
+}
+
+// a wait that ended early leaves its timeout request behind, it would cut a later wait short
+static void ioUringRemoveTimeout(io_uring_ctx_t* ctx) {
+    struct io_uring_sqe* sqe = ioUringGetSqe(ctx);
+    if (sqe == NULL) return;
+    sqe->opcode    = IORING_OP_TIMEOUT_REMOVE;
+    sqe->fd        = -1;
+    sqe->addr      = ioUringTimeoutUserData(ctx->timeout_seq);
+    sqe->user_data = IO_URING_IGNORE_DATA;
+    ctx->timeout_armed = false;
+}
+
+// drops the completions of timeouts and removes at the head of the queue, false if anything else is waiting
+static bool ioUringDropTimeoutCompletions(io_uring_ctx_t* ctx) {
+    unsigned head = *ctx->cq_head;
+    unsigned tail = __atomic_load_n(ctx->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        struct io_uring_cqe* cqe = ctx->cqes + (head & *ctx->cq_mask);
+        if ((uint32_t)cqe->user_data != IO_URING_TIMEOUT_FD) break;
+    }
+    __atomic_store_n(ctx->cq_head, head, __ATOMIC_RELEASE);
+    return head == tail;
+}
+
+#ifdef IORING_RECV_MULTISHOT
+// puts a fresh large buffer of the pool into the ring under bid, visible to the kernel once the tail is published
+static void ioUringProvideBuffer(wloop_t* loop, io_uring_ctx_t* ctx, uint16_t bid) {
+    sbuf_t* b = bufferpoolGetLargeBuffer(loop->bufpool);
+    ctx->br_bufs[bid] = b;
+    // NOTE: the tail of the ring overlays the reserved field of the first slot, never write the slot as a whole
+    struct io_uring_buf* slot = &ctx->br->bufs[ctx->br_tail & (IO_URING_RECV_BUFFERS - 1)];
+    slot->addr = (uint64_t)(uintptr_t)sbufGetMutablePtr(b);
+    slot->len  = sbufGetRightCapacity(b);
+    slot->bid  = bid;
+    ctx->br_tail++;
+}
+
+static void ioUringPublishBuffers(io_uring_ctx_t* ctx) {
+    __atomic_store_n(&ctx->br->tail, ctx->br_tail, __ATOMIC_RELEASE);
+}
+
+static void ioUringSetupBufferRing(wloop_t* loop, io_uring_ctx_t* ctx) {
+    size_t size = IO_URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+    void*  br   = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (br == MAP_FAILED) return;
+
+    struct io_uring_buf_reg reg;
+    memorySet(&reg, 0, sizeof(reg));
+    reg.ring_addr    = (uint64_t)(uintptr_t)br;
+    reg.ring_entries = IO_URING_RECV_BUFFERS;
+    reg.bgid         = IO_URING_RECV_BGID;
+    if (ioUringRegister(ctx->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        // NOTE: before linux 5.19, every read stays readiness based
+        munmap(br, size);
+        return;
+    }
+    ctx->br             = (struct io_uring_buf_ring*)br;
+    ctx->br_size        = size;
+    ctx->br_tail        = 0;
+    ctx->recv_multishot = true;
+    EVENTLOOP_ALLOC(ctx->br_bufs, sizeof(sbuf_t*) * IO_URING_RECV_BUFFERS);
+    for (uint16_t bid = 0; bid < IO_URING_RECV_BUFFERS; ++bid) {
+        ioUringProvideBuffer(loop, ctx, bid);
+    }
+    ioUringPublishBuffers(ctx);
+}
+
+static inline uint64_t ioUringRecvUserData(wio_t* io) {
+    uint32_t low = IO_URING_RECV_FLAG | ((uint32_t)io->uring_rx_gen << IO_URING_RECV_GEN_SHIFT) | (uint32_t)io->fd;
+    return ((uint64_t)io->id << 32) | low;
+}
+
+static bool ioUringRecvWanted(io_uring_ctx_t* ctx, wio_t* io) {
+    if (io->uring_rx_state != IO_URING_RX_OFF) return true;
+    // NOTE: the switch happens before the first read of the stream, nothing was read with recv() yet
+    return ctx->recv_multishot && io->io_type == WIO_TYPE_TCP && ! io->accept && ! io->connect && ! io->zerocopy_rx &&
+           (uint32_t)io->fd <= IO_URING_FD_MASK;
+}
+
+static void ioUringArmRecv(io_uring_ctx_t* ctx, wio_t* io) {
+    if (io->uring_rx_state == IO_URING_RX_ARMED || io->uring_rx_state == IO_URING_RX_ENDED) return;
+    struct io_uring_sqe* sqe = ioUringGetSqe(ctx);
+    if (sqe == NULL) {
+        printError("io_uring submission queue overflow");
+        return;
+    }
+    io->uring_rx_gen   = (uint8_t)((io->uring_rx_gen + 1) & IO_URING_RECV_GEN_MASK);
+    io->uring_rx_state = IO_URING_RX_ARMED;
+    io->uring_rx_inflight++;
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = io->fd;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = IO_URING_RECV_BGID;
+    sqe->user_data = ioUringRecvUserData(io);
+}
+
+static void ioUringCancelRecv(io_uring_ctx_t* ctx, wio_t* io) {
+    struct io_uring_sqe* sqe = ioUringGetSqe(ctx);
+    if (sqe == NULL) {
+        printError("io_uring submission queue overflow");
+        return;
+    }
+    sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+    sqe->fd        = -1;
+    sqe->addr      = ioUringRecvUserData(io);
+    sqe->user_data = IO_URING_IGNORE_DATA;
+    // NOTE: completions that were already on their way still queue their data, the generation keeps the
+    // cancelled request from ending a newer one
+    io->uring_rx_state = IO_URING_RX_IDLE;
+}
+
+static void ioUringQueueRead(wio_t* io, sbuf_t* buf) {
+    if (io->uring_rx_queue.maxsize == 0) {
+        read_queue_init(&io->uring_rx_queue, 4);
+    }
+    read_queue_push_back(&io->uring_rx_queue, &buf);
+}
+
+// one completion of a multishot recv, returns 1 if it made the io pending
+static int ioUringRecvCompleted(wloop_t* loop, io_uring_ctx_t* ctx, struct io_uring_cqe* cqe) {
+    uint32_t low = (uint32_t)cqe->user_data;
+    uint32_t id  = (uint32_t)(cqe->user_data >> 32);
+    int      fd  = (int)(low & IO_URING_FD_MASK);
+    uint8_t  gen = (uint8_t)((low >> IO_URING_RECV_GEN_SHIFT) & IO_URING_RECV_GEN_MASK);
+    wio_t*   io  = fd < (int)loop->ios.maxsize ? loop->ios.ptr[fd] : NULL;
+    // closed, or a previous owner of this fd: the data goes nowhere
+    if (io != NULL && (io->id != id || io->closed || io->uring_rx_state == IO_URING_RX_OFF)) {
+        io = NULL;
+    }
+
+    bool queued = false;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        sbuf_t*  buf = ctx->br_bufs[bid];
+        ioUringProvideBuffer(loop, ctx, bid);
+        if (io == NULL || cqe->res <= 0) {
+            bufferpoolReuseBuffer(loop->bufpool, buf);
+        }
+        else {
+            sbufSetLength(buf, (uint32_t)cqe->res);
+            ioUringQueueRead(io, buf);
+            queued = true;
+        }
+    }
+    if (io == NULL) return 0;
+    if (! (cqe->flags & IORING_CQE_F_MORE) && io->uring_rx_inflight > 0) {
+        io->uring_rx_inflight--;
+    }
+
+    if (! (cqe->flags & IORING_CQE_F_MORE) && gen == io->uring_rx_gen && io->uring_rx_state == IO_URING_RX_ARMED) {
+        io->uring_rx_state = IO_URING_RX_IDLE;
+        if (cqe->res == -EINVAL && read_queue_empty(&io->uring_rx_queue)) {
+            // NOTE: no multishot recv before linux 6.0, nothing was read yet so readiness takes over
+            wlogw("io_uring multishot recv is not supported, reads stay readiness based");
+            ctx->recv_multishot = false;
+            io->uring_rx_state  = IO_URING_RX_OFF;
+            ioUringDisarm(ctx, io);
+            ioUringRearmLater(ctx, fd);
+            return 0;
+        }
+        if (cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS)) {
+            // eof or an error, delivered once the data before it is
+            io->uring_rx_error = cqe->res < 0 ? -cqe->res : 0;
+            io->uring_rx_state = IO_URING_RX_ENDED;
+            ioUringQueueRead(io, NULL);
+            queued = true;
+        }
+        else {
+            // the ring ran dry (or the kernel ended the request after data), start another one next round
+            ioUringRearmLater(ctx, fd);
+        }
+    }
+
+    if (queued && (io->events & WW_READ)) {
+        io->revents |= WW_READ;
+        EVENT_PENDING(io);
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+// one completion of any request, returns 1 if it made an io pending
+static int ioUringCompleted(wloop_t* loop, io_uring_ctx_t* ctx, struct io_uring_cqe* cqe) {
+    uint32_t low = (uint32_t)cqe->user_data;
+    if (low == IO_URING_TIMEOUT_FD) {
+        if ((uint32_t)(cqe->user_data >> 32) == ctx->timeout_seq) {
+            ctx->timeout_armed = false;
+        }
+        return 0;
+    }
+#ifdef IORING_RECV_MULTISHOT
+    if (low & IO_URING_RECV_FLAG) {
+        return ioUringRecvCompleted(loop, ctx, cqe);
+    }
+#endif
+    int fd  = (int)low;
+    int seq = (int)(cqe->user_data >> 32);
+    if (fd < 0 || fd >= (int)loop->ios.maxsize) return 0;
+    wio_t* io = loop->ios.ptr[fd];
+    // removed, re-armed, or belongs to a previous owner of this fd
+    if (io == NULL || io->event_index[0] < 0 || io->event_index[1] != seq) return 0;
+    if (cqe->res == -ECANCELED) return 0;
+
+    io->event_index[0] = -1;
+    ioUringRearmLater(ctx, fd);
+
+    uint32_t revents = cqe->res < 0 ? (POLLERR) : (uint32_t)cqe->res;
+    if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        io->revents |= WW_READ;
+    }
+    if (revents & (POLLOUT | POLLHUP | POLLERR)) {
+        io->revents |= WW_WRITE;
+    }
+    EVENT_PENDING(io);
+    return 1;
+}
+
+int iowatcherInit(wloop_t* loop) {
+    if (loop->iowatcher) return 0;
+    io_uring_ctx_t* io_uring_ctx;
+    EVENTLOOP_ALLOC_SIZEOF(io_uring_ctx);
+
+    struct io_uring_params params;
+    memorySet(&params, 0, sizeof(params));
+#if defined(IORING_SETUP_SINGLE_ISSUER) && defined(IORING_SETUP_COOP_TASKRUN)
+    // every ring is owned by exactly one worker thread
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+#endif
+    io_uring_ctx->ring_fd = ioUringSetup(IO_URING_ENTRIES, &params);
+    if (io_uring_ctx->ring_fd < 0 && errno == EINVAL && params.flags != 0) {
+        // older kernel, retry without the optional flags
+        memorySet(&params, 0, sizeof(params));
+        io_uring_ctx->ring_fd = ioUringSetup(IO_URING_ENTRIES, &params);
+    }
+    if (io_uring_ctx->ring_fd < 0) {
+        printError("io_uring_setup");
+        EVENTLOOP_FREE(io_uring_ctx);
+        return -1;
+    }
+    if (ioUringMapRings(io_uring_ctx, &params) != 0) {
+        printError("io_uring mmap");
+        close(io_uring_ctx->ring_fd);
+        EVENTLOOP_FREE(io_uring_ctx);
+        return -1;
+    }
+    io_uring_ctx->features = params.features;
+    rearms_init(&io_uring_ctx->rearms, REARMS_INIT_SIZE);
+#ifdef IORING_RECV_MULTISHOT
+    ioUringSetupBufferRing(loop, io_uring_ctx);
+#endif
+    loop->iowatcher = io_uring_ctx;
+    return 0;
+}
+
+int iowatcherCleanUp(wloop_t* loop) {
+    if (loop->iowatcher == NULL) return 0;
+    io_uring_ctx_t* io_uring_ctx = (io_uring_ctx_t*)loop->iowatcher;
+    munmap(io_uring_ctx->sqes, io_uring_ctx->sqes_size);
+    if (io_uring_ctx->cq_ring_ptr != io_uring_ctx->sq_ring_ptr) {
+        munmap(io_uring_ctx->cq_ring_ptr, io_uring_ctx->cq_ring_size);
+    }
+    munmap(io_uring_ctx->sq_ring_ptr, io_uring_ctx->sq_ring_size);
+    close(io_uring_ctx->ring_fd);
+    if (io_uring_ctx->br != NULL) {
+        // NOTE: after the ring is closed, nothing lands in these anymore
+        for (int bid = 0; bid < IO_URING_RECV_BUFFERS; ++bid) {
+            bufferpoolReuseBuffer(loop->bufpool, io_uring_ctx->br_bufs[bid]);
+        }
+        EVENTLOOP_FREE(io_uring_ctx->br_bufs);
+        munmap(io_uring_ctx->br, io_uring_ctx->br_size);
+    }
+    rearms_cleanup(&io_uring_ctx->rearms);
+    later_cqes_cleanup(&io_uring_ctx->later_cqes);
+    EVENTLOOP_FREE(loop->iowatcher);
+    return 0;
+}
+
+// the part of the interest that is watched with poll requests, reads of a completion based io are not
+static inline int ioUringPollMask(wio_t* io, int events) {
+    return io->uring_rx_state != IO_URING_RX_OFF ? (events & ~WW_READ) : events;
+}
+
+// (re)arms the poll request if its mask has to change
+static void ioUringUpdatePoll(io_uring_ctx_t* ctx, wio_t* io, int events) {
+    int poll_events = ioUringPollMask(io, events);
+    if (io->event_index[0] == poll_events || (io->event_index[0] < 0 && poll_events == 0)) return;
+    ioUringDisarm(ctx, io);
+    if (poll_events) {
+        ioUringArm(ctx, io, poll_events);
+    }
+}
+
+int iowatcherAddEvent(wloop_t* loop, int fd, int selected_events) {
+    if (loop->iowatcher == NULL) {
+        if (iowatcherInit(loop) != 0) return -1;
+    }
+    io_uring_ctx_t* io_uring_ctx = (io_uring_ctx_t*)loop->iowatcher;
+    wio_t* io = loop->ios.ptr[fd];
+
+    int events = io->events | selected_events;
+    if (io->events == 0) {
+        io_uring_ctx->nfds++;
+    }
+#ifdef IORING_RECV_MULTISHOT
+    if ((selected_events & WW_READ) && ioUringRecvWanted(io_uring_ctx, io)) {
+        if (io->uring_rx_state == IO_URING_RX_OFF) {
+            io->uring_rx_state = IO_URING_RX_IDLE;
+        }
+        ioUringArmRecv(io_uring_ctx, io);
+        if (! read_queue_empty(&io->uring_rx_queue)) {
+            // NOTE: completed while the io was paused, handed out on the next poll
+            ioUringRearmLater(io_uring_ctx, fd);
+        }
+    }
+#endif
+    ioUringUpdatePoll(io_uring_ctx, io, events);
+    return 0;
+}
+
+int iowatcherDelEvent(wloop_t* loop, int fd, int selected_events) {
+    io_uring_ctx_t* io_uring_ctx = (io_uring_ctx_t*)loop->iowatcher;
+    if (io_uring_ctx == NULL) return 0;
+    wio_t* io = loop->ios.ptr[fd];
+
+    int events = io->events & ~selected_events;
+#ifdef IORING_RECV_MULTISHOT
+    if ((selected_events & WW_READ) && io->uring_rx_state == IO_URING_RX_ARMED) {
+        ioUringCancelRecv(io_uring_ctx, io);
+    }
+#endif
+    ioUringUpdatePoll(io_uring_ctx, io, events);
+    if (events == 0) {
+        io_uring_ctx->nfds--;
+    }
+    return 0;
+}
+
+int iowatcherPollEvents(wloop_t* loop, int timeout) {
+    io_uring_ctx_t* io_uring_ctx = (io_uring_ctx_t*)loop->iowatcher;
+    if (io_uring_ctx == NULL)  return 0;
+
+    // re-arm the one-shot polls that fired last round and are still wanted, and the recvs that ended early
+    int nevents = 0;
+    for (size_t i = 0; i < io_uring_ctx->rearms.size; ++i) {
+        int fd = io_uring_ctx->rearms.ptr[i];
+        wio_t* io = fd < (int)loop->ios.maxsize ? loop->ios.ptr[fd] : NULL;
+        if (io == NULL || io->events == 0) continue;
+        int poll_events = ioUringPollMask(io, io->events);
+        if (poll_events && io->event_index[0] < 0) {
+            ioUringArm(io_uring_ctx, io, poll_events);
+        }
+#ifdef IORING_RECV_MULTISHOT
+        if (io->uring_rx_state != IO_URING_RX_OFF && (io->events & WW_READ)) {
+            ioUringArmRecv(io_uring_ctx, io);
+            if (! read_queue_empty(&io->uring_rx_queue) && ! io->pending) {
+                io->revents |= WW_READ;
+                EVENT_PENDING(io);
+                ++nevents;
+            }
+        }
+#endif
+    }
+    io_uring_ctx->rearms.size = 0;
+    // set aside by iowatcherDetachIo, older than anything in the completion queue
+    for (size_t i = 0; i < io_uring_ctx->later_cqes.size; ++i) {
+        nevents += ioUringCompleted(loop, io_uring_ctx, &io_uring_ctx->later_cqes.ptr[i]);
+    }
+    io_uring_ctx->later_cqes.size = 0;
+
+    if (io_uring_ctx->nfds == 0) {
+        ioUringFlush(io_uring_ctx);
+        return nevents;
+    }
+    if (nevents > 0) {
+        // the queued reads are ready now, only look for what else completed
+        timeout = 0;
+    }
+
+    if (io_uring_ctx->timeout_armed) {
+        ioUringRemoveTimeout(io_uring_ctx);
+        if (timeout != 0) {
+            // NOTE: the remove and the cancelled timeout complete right away, a wait would return on them
+            ioUringFlush(io_uring_ctx);
+            if (! ioUringDropTimeoutCompletions(io_uring_ctx)) {
+                timeout = 0;
+            }
+        }
+    }
+
+    unsigned flags = 0;
+    unsigned min_complete = 0;
+    void*  arg = NULL;
+    size_t argsz = 0;
+    struct io_uring_getevents_arg getevents_arg;
+    if (timeout != 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        min_complete = 1;
+        if (timeout > 0) {
+            if (io_uring_ctx->features & IORING_FEAT_EXT_ARG) {
+                io_uring_ctx->timeout_ts.tv_sec  = timeout / 1000;
+                io_uring_ctx->timeout_ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+                memorySet(&getevents_arg, 0, sizeof(getevents_arg));
+                getevents_arg.ts = (uint64_t)(uintptr_t)&io_uring_ctx->timeout_ts;
+                flags |= IORING_ENTER_EXT_ARG;
+                arg = &getevents_arg;
+                argsz = sizeof(getevents_arg);
+            }
+            else {
+                ioUringArmTimeout(io_uring_ctx, timeout);
+            }
+        }
+    }
+
+    int ret = ioUringEnter(io_uring_ctx->ring_fd, io_uring_ctx->to_submit, min_complete, flags, arg, argsz);
+    if (ret < 0) {
+        if (errno == EINTR || errno == ETIME || errno == EBUSY) {
+            ret = 0;
+        }
+        else {
+            printError("io_uring_enter");
+            return ret;
+        }
+    }
+    io_uring_ctx->to_submit -= min((unsigned)ret, io_uring_ctx->to_submit);
+
+    unsigned head = *io_uring_ctx->cq_head;
+    unsigned tail = __atomic_load_n(io_uring_ctx->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        nevents += ioUringCompleted(loop, io_uring_ctx, io_uring_ctx->cqes + (head & *io_uring_ctx->cq_mask));
+    }
+    __atomic_store_n(io_uring_ctx->cq_head, head, __ATOMIC_RELEASE);
+#ifdef IORING_RECV_MULTISHOT
+    if (io_uring_ctx->br != NULL) {
+        ioUringPublishBuffers(io_uring_ctx);
+    }
+#endif
+    return nevents;
+}
+
+void iowatcherDetachIo(wloop_t* loop, wio_t* io) {
+    io_uring_ctx_t* io_uring_ctx = (io_uring_ctx_t*)loop->iowatcher;
+    if (io_uring_ctx == NULL) return;
+#ifdef IORING_RECV_MULTISHOT
+    if (io->uring_rx_state == IO_URING_RX_ARMED) {
+        ioUringCancelRecv(io_uring_ctx, io);
+    }
+    // NOTE: the caller may be in the middle of the pending callbacks, completions of other ios can not make them
+    // pending now, they are set aside for the next poll
+    while (io->uring_rx_inflight > 0) {
+        int ret = ioUringEnter(io_uring_ctx->ring_fd, io_uring_ctx->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            printError("io_uring_enter");
+            break;
+        }
+        io_uring_ctx->to_submit -= min((unsigned)ret, io_uring_ctx->to_submit);
+
+        unsigned head = *io_uring_ctx->cq_head;
+        unsigned tail = __atomic_load_n(io_uring_ctx->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            struct io_uring_cqe* cqe = io_uring_ctx->cqes + (head & *io_uring_ctx->cq_mask);
+            uint32_t low = (uint32_t)cqe->user_data;
+            if ((low & IO_URING_RECV_FLAG) && low != IO_URING_TIMEOUT_FD && (int)(low & IO_URING_FD_MASK) == io->fd &&
+                (uint32_t)(cqe->user_data >> 32) == io->id) {
+                ioUringRecvCompleted(loop, io_uring_ctx, cqe);
+            }
+            else {
+                later_cqes_push_back(&io_uring_ctx->later_cqes, cqe);
+            }
+        }
+        __atomic_store_n(io_uring_ctx->cq_head, head, __ATOMIC_RELEASE);
+    }
+    if (io_uring_ctx->br != NULL) {
+        ioUringPublishBuffers(io_uring_ctx);
+    }
+    // whatever arrived stays queued on the io, the next loop arms its own recv and hands it out first
+    if (io->uring_rx_state == IO_URING_RX_IDLE && read_queue_empty(&io->uring_rx_queue)) {
+        io->uring_rx_state = IO_URING_RX_OFF;
+    }
+#endif
+}
+#endif
@@ -7,6 +7,7 @@
 #if !defined(EVENT_SELECT) &&   \
     !defined(EVENT_POLL) &&     \
     !defined(EVENT_EPOLL) &&    \
+    !defined(EVENT_IO_URING) && \
     !defined(EVENT_KQUEUE) &&   \
     !defined(EVENT_IOCP) &&     \
     !defined(EVENT_PORT) &&     \
@@ -35,5 +36,9 @@ int iowatcherCleanUp(wloop_t* loop);
 int iowatcherAddEvent(wloop_t* loop, int fd, int events);
 int iowatcherDelEvent(wloop_t* loop, int fd, int events);
 int iowatcherPollEvents(wloop_t* loop, int timeout);
+#ifdef EVENT_IO_URING
+// ends the completion based reads of io on this loop, so it can be attached to another one
+void iowatcherDetachIo(wloop_t* loop, wio_t* io);
+#endif
 
 #endif
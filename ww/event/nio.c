@@ -7,6 +7,25 @@
 #include "wsocket.h"
 #include "wthread.h"
 
+#ifdef WIO_TCP_ZEROCOPY
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#endif
+
+#ifdef WIO_TCP_ZEROCOPY_RECEIVE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef OS_UNIX
+#include <limits.h>
+#include <sys/uio.h>
+#define NIO_HAVE_WRITEV 1
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+#endif
+
 static void __connect_timeout_cb(wtimer_t *timer)
 {
     wio_t *io = (wio_t *) timer->privdata;
@@ -89,16 +108,64 @@ static void __close_cb(wio_t *io)
     wioCloseCallBack(io);
 }
 
+// how many more connections the current event may accept, 0 unless the listen backlog is filling up
+static uint32_t nio_accept_backlog_extra(wio_t *io, uint32_t accepted)
+{
+#if defined(OS_LINUX) && defined(TCP_INFO)
+    struct tcp_info info;
+    socklen_t       len = sizeof(info);
+    if (getsockopt(io->fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+    {
+        return 0;
+    }
+    // NOTE: for a listener the kernel reports the accept queue length in tcpi_unacked and its limit in tcpi_sacked
+    if (info.tcpi_unacked == 0 || (uint64_t) info.tcpi_unacked * 4 < info.tcpi_sacked)
+    {
+        // other ios first, the listener stays readable and gets the next event
+        return 0;
+    }
+    return min(info.tcpi_unacked, (uint32_t) WIO_ACCEPT_BUDGET_MAX - accepted);
+#else
+    discard io;
+    discard accepted;
+    return 0;
+#endif
+}
+
+static int nio_accept_fd(wio_t *io, socklen_t *addrlen)
+{
+#if defined(OS_LINUX) && defined(SOCK_NONBLOCK) && defined(SOCK_CLOEXEC)
+    return accept4(io->fd, io->peeraddr, addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int connfd = accept(io->fd, io->peeraddr, addrlen);
+    if (connfd >= 0)
+    {
+        nonBlocking(connfd);
+    }
+    return connfd;
+#endif
+}
+
 static void nio_accept(wio_t *io)
 {
     // printd("nio_accept listenfd=%d\n", io->fd);
-    int       connfd = 0, err = 0, accept_cnt = 0;
+    int       connfd = 0, err = 0;
     socklen_t addrlen;
-    wio_t    *connio = NULL;
-    while (accept_cnt++ < 3)
+    wio_t    *connio   = NULL;
+    uint32_t  budget   = io->loop->accept_budget;
+    uint32_t  accepted = 0;
+    while (true)
     {
+        if (accepted == budget)
+        {
+            budget += nio_accept_backlog_extra(io, accepted);
+            if (accepted == budget)
+            {
+                return;
+            }
+        }
         addrlen = sizeof(sockaddr_u);
-        connfd  = accept(io->fd, io->peeraddr, &addrlen);
+        connfd  = nio_accept_fd(io, &addrlen);
         if (connfd < 0)
         {
             err = socketERRNO();
@@ -113,16 +180,18 @@ static void nio_accept(wio_t *io)
                 goto accept_error;
             }
         }
-        addrlen = sizeof(sockaddr_u);
-        getsockname(connfd, io->localaddr, &addrlen);
-        connio = wioGet(io->loop, connfd);
+        accepted++;
+        connio = wioGetAccepted(io->loop, connfd, io->peeraddr_u);
         // NOTE: inherit from listenio
         connio->accept_cb = io->accept_cb;
         connio->userdata  = io->userdata;
 
         __accept_cb(connio);
+        if (io->closed)
+        {
+            return;
+        }
     }
-    return;
 
 accept_error:
     wloge("listenfd=%d accept error: %s:%d", io->fd, socketStrError(io->error), io->error);
@@ -140,99 +209,1040 @@ static void nio_connect(wio_t *io)
         io->error = socketERRNO();
         goto connect_error;
     }
-    else
+    else
+    {
+        addrlen = sizeof(sockaddr_u);
+        getsockname(io->fd, io->localaddr, &addrlen);
+
+        __connect_cb(io);
+
+        return;
+    }
+
+connect_error:
+    wlogw("connfd=%d connect error: %s:%d", io->fd, socketStrError(io->error), io->error);
+    wioClose(io);
+}
+
+static void nio_connect_event_cb(wevent_t *ev)
+{
+    wio_t   *io = (wio_t *) ev->userdata;
+    uint32_t id = (uint32_t) (uintptr_t) ev->privdata;
+    if (io->id != id)
+        return;
+    nio_connect(io);
+}
+
+static int nio_connect_async(wio_t *io)
+{
+    wevent_t ev;
+    memorySet(&ev, 0, sizeof(ev));
+    ev.cb       = nio_connect_event_cb;
+    ev.userdata = io;
+    ev.privdata = (void *) (uintptr_t) io->id;
+    wloopPostEvent(io->loop, &ev);
+    return 0;
+}
+
+static int __nio_read(wio_t *io, void *buf, unsigned int len)
+{
+    int nread = 0;
+    switch (io->io_type)
+    {
+
+    case WIO_TYPE_TCP:
+
+        // #if defined(OS_LINUX) && defined(HAVE_PIPE)
+        //         if(io->pfd_w){
+        //             nread = splice(io->fd, NULL,io->pfd_w,0, len, SPLICE_F_NONBLOCK);
+        //         }else
+        // #endif
+        nread = recv(io->fd, buf, (size_t) len, 0);
+        break;
+    case WIO_TYPE_UDP: // udp can also be more than 1472 bytes
+    case WIO_TYPE_IP: {
+        socklen_t addrlen = sizeof(sockaddr_u);
+        nread             = recvfrom(io->fd, buf, (size_t) len, 0, io->peeraddr, &addrlen);
+    }
+    break;
+    default:
+        nread = read(io->fd, buf, len);
+        break;
+    }
+    // wlogd("read retval=%d", nread);
+    return nread;
+}
+
+static int __nio_write(wio_t *io, const void *buf, int len)
+{
+    int nwrite = 0;
+    switch (io->io_type)
+    {
+    case WIO_TYPE_TCP: {
+        // #if defined(OS_LINUX) && defined(HAVE_PIPE)
+        //     if(io->pfd_r){
+        //         nwrite = splice(io->pfd_r, NULL,io->fd,0, len, SPLICE_F_NONBLOCK);
+        //         break;
+        //     }
+        // #endif
+        int flag = 0;
+#ifdef MSG_NOSIGNAL
+        flag |= MSG_NOSIGNAL;
+#endif
+        nwrite = send(io->fd, buf, (size_t) len, flag);
+    }
+    break;
+    case WIO_TYPE_UDP:
+    case WIO_TYPE_IP:
+        nwrite = sendto(io->fd, buf, (size_t) len, 0, io->peeraddr, SOCKADDR_LEN(io->peeraddr));
+        break;
+    default:
+        nwrite = write(io->fd, buf, (size_t) len);
+        break;
+    }
+    // wlogd("write retval=%d", nwrite);
+    return nwrite;
+}
+
+#ifdef NIO_HAVE_WRITEV
+// writes count buffers of a stream io with one syscall, *total is the number of bytes they hold
+// more: other buffers follow right after, tcp keeps the last partial segment for them (MSG_MORE)
+static int __nio_writev_bufs(wio_t *io, sbuf_t *const *bufs, int count, int *total, bool more)
+{
+    struct iovec iov[IOV_MAX];
+
+    more   = more || count > IOV_MAX;
+    count  = min(count, IOV_MAX);
+    *total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        iov[i].iov_base = sbufGetMutablePtr(bufs[i]);
+        iov[i].iov_len  = sbufGetLength(bufs[i]);
+        *total += (int) iov[i].iov_len;
+    }
+
+    if (io->io_type == WIO_TYPE_TCP)
+    {
+        struct msghdr msg;
+        memorySet(&msg, 0, sizeof(msg));
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = (size_t) count;
+        int flag       = 0;
+#ifdef MSG_NOSIGNAL
+        flag |= MSG_NOSIGNAL;
+#endif
+#ifdef MSG_MORE
+        if (more)
+        {
+            flag |= MSG_MORE;
+        }
+#endif
+        return (int) sendmsg(io->fd, &msg, flag);
+    }
+    return (int) writev(io->fd, iov, count);
+}
+
+// gathers the queued buffers of a stream io into one syscall, returns the iov count through *nbufs
+static int __nio_writev(wio_t *io, int *nbufs, int *total)
+{
+    *nbufs = (int) write_queue_size(&io->write_queue);
+    int nwrite = __nio_writev_bufs(io, write_queue_data(&io->write_queue), *nbufs, total, false);
+    *nbufs     = min(*nbufs, IOV_MAX);
+    return nwrite;
+}
+#endif
+
+#ifdef WIO_TCP_ZEROCOPY
+static bool __nio_zerocopy_wanted(wio_t *io, sbuf_t *buf)
+{
+    // NOTE: another owner of a shared buffer may recycle it while the kernel still reads its pages
+    return io->zerocopy != NULL && sbufGetLength(buf) >= io->zerocopy->threshold && ! sbufIsShared(buf);
+}
+
+// sends the buffer that is (or is about to become) the front of the write queue with MSG_ZEROCOPY
+static int __nio_write_zerocopy(wio_t *io, sbuf_t *buf)
+{
+    int flag = MSG_ZEROCOPY;
+#ifdef MSG_NOSIGNAL
+    flag |= MSG_NOSIGNAL;
+#endif
+    int nwrite = (int) send(io->fd, sbufGetMutablePtr(buf), sbufGetLength(buf), flag);
+    if (nwrite < 0 && socketERRNO() == ENOBUFS)
+    {
+        // too many notifications outstanding (optmem), this one goes out as a plain send
+        return __nio_write(io, sbufGetMutablePtr(buf), (int) sbufGetLength(buf));
+    }
+    if (nwrite > 0)
+    {
+        wio_zerocopy_t *zc = io->zerocopy;
+        zc->front_seq      = zc->next_seq++;
+        zc->front_pinned   = true;
+        zc->sends++;
+    }
+    return nwrite;
+}
+
+// takes over a buffer that left the front of the write queue if the kernel may still read it
+static bool __nio_zerocopy_hold(wio_t *io, sbuf_t *buf)
+{
+    wio_zerocopy_t *zc = io->zerocopy;
+    if (zc == NULL || ! zc->front_pinned)
+    {
+        return false;
+    }
+    zerocopy_pending_t item = {.buf = buf, .seq = zc->front_seq};
+    zerocopy_queue_push_back(&zc->pending, &item);
+    zc->front_pinned = false;
+    return true;
+}
+
+// reads the completions on the error queue of fd and recycles the buffers whose sends have all completed
+static void __nio_zerocopy_reap(wloop_t *loop, wio_zerocopy_t *zc, int fd)
+{
+    char          control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+    struct msghdr msg;
+
+    while (true)
+    {
+        memorySet(&msg, 0, sizeof(msg));
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;
+        }
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (! ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                   (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            struct sock_extended_err *ee = (struct sock_extended_err *) CMSG_DATA(cm);
+            if (ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY || ee->ee_errno != 0)
+            {
+                continue;
+            }
+            // NOTE: one notification covers the sends ee_info..ee_data, tcp reports them in order
+            uint32_t count = ee->ee_data - ee->ee_info + 1;
+            zc->completions += count;
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                zc->copied += count;
+            }
+            if ((int32_t) (ee->ee_data + 1 - zc->done_seq) > 0)
+            {
+                zc->done_seq = ee->ee_data + 1;
+            }
+        }
+    }
+
+    while (! zerocopy_queue_empty(&zc->pending))
+    {
+        zerocopy_pending_t *item = zerocopy_queue_front(&zc->pending);
+        if ((int32_t) (item->seq - zc->done_seq) >= 0)
+        {
+            break;
+        }
+        bufferpoolReuseBuffer(loop->bufpool, item->buf);
+        zerocopy_queue_pop_front(&zc->pending);
+    }
+
+    if (zc->threshold != UINT32_MAX && zc->completions >= ZEROCOPY_PROBE_SENDS && zc->copied * 2 > zc->completions)
+    {
+        wlogd("zerocopy: kernel copied %llu of %llu sends on fd=%d, back to plain sends",
+              (unsigned long long) zc->copied, (unsigned long long) zc->completions, fd);
+        zc->threshold = UINT32_MAX;
+    }
+}
+
+static void __nio_zerocopy_free(wloop_t *loop, wio_zerocopy_t *zc, bool recycle)
+{
+    if (! zerocopy_queue_empty(&zc->pending) && ! recycle)
+    {
+        // NOTE: not even the reset released them, so a driver still holds the pages. handing them to another
+        // connection could send its data to this peer, leaking them is the safe choice and should never happen
+        wlogw("zerocopy: leaking %d buffers the kernel never released", zerocopy_queue_size(&zc->pending));
+    }
+    while (! zerocopy_queue_empty(&zc->pending))
+    {
+        if (recycle)
+        {
+            bufferpoolReuseBuffer(loop->bufpool, zerocopy_queue_front(&zc->pending)->buf);
+        }
+        zerocopy_queue_pop_front(&zc->pending);
+    }
+    if (zc->fd >= 0)
+    {
+        close(zc->fd);
+    }
+    zerocopy_queue_cleanup(&zc->pending);
+    EVENTLOOP_FREE(zc);
+}
+
+// resets the parked connection, the kernel drops the data the peer never took and releases its pages
+static void __nio_zerocopy_abort(wio_zerocopy_t *zc, uint64_t now_ms)
+{
+    // NOTE: connect with AF_UNSPEC disconnects without closing, the error queue stays readable for the completions
+    struct sockaddr unspec;
+    memorySet(&unspec, 0, sizeof(unspec));
+    unspec.sa_family = AF_UNSPEC;
+    connect(zc->fd, &unspec, sizeof(unspec));
+    zc->aborted   = true;
+    zc->parked_ms = now_ms;
+}
+
+static void __nio_zerocopy_reaper_cb(wtimer_t *timer)
+{
+    wloop_t         *loop   = weventGetLoop(timer);
+    uint64_t         now_ms = loop->cur_hrtime / 1000;
+    wio_zerocopy_t **link   = &loop->zerocopy_parked;
+
+    while (*link != NULL)
+    {
+        wio_zerocopy_t *zc = *link;
+        __nio_zerocopy_reap(loop, zc, zc->fd);
+
+        bool done    = zerocopy_queue_empty(&zc->pending);
+        bool expired = now_ms - zc->parked_ms > (zc->aborted ? ZEROCOPY_ABORT_GRACE_MS : ZEROCOPY_LINGER_MS);
+        if (! done && expired && ! zc->aborted)
+        {
+            __nio_zerocopy_abort(zc, now_ms);
+            link = &zc->next;
+            continue;
+        }
+        if (done || expired)
+        {
+            *link = zc->next;
+            __nio_zerocopy_free(loop, zc, done);
+            continue;
+        }
+        link = &zc->next;
+    }
+
+    if (loop->zerocopy_parked == NULL)
+    {
+        wtimerDelete(timer);
+        loop->zerocopy_reaper = NULL;
+    }
+}
+
+// detaches the zerocopy state of a closing io, buffers the kernel may still read are parked on the loop until their
+// completions arrive on a dup of the socket
+static void __nio_zerocopy_close(wio_t *io)
+{
+    wio_zerocopy_t *zc   = io->zerocopy;
+    wloop_t        *loop = io->loop;
+    io->zerocopy         = NULL;
+
+    if (zc->front_pinned)
+    {
+        // NOTE: wioDone recycles the write queue, the pinned front must not go with it
+        assert(! write_queue_empty(&io->write_queue));
+        zerocopy_pending_t item = {.buf = *write_queue_front(&io->write_queue), .seq = zc->front_seq};
+        write_queue_pop_front(&io->write_queue);
+        zerocopy_queue_push_back(&zc->pending, &item);
+        zc->front_pinned = false;
+    }
+
+    __nio_zerocopy_reap(loop, zc, io->fd);
+    if (zerocopy_queue_empty(&zc->pending) || (zc->fd = dup(io->fd)) < 0)
+    {
+        __nio_zerocopy_free(loop, zc, zerocopy_queue_empty(&zc->pending));
+        return;
+    }
+
+    // the socket lives on through the dup, shut it down so the peer still sees the close
+    shutdown(io->fd, SHUT_RDWR);
+    zc->parked_ms         = loop->cur_hrtime / 1000;
+    zc->next              = loop->zerocopy_parked;
+    loop->zerocopy_parked = zc;
+    if (loop->zerocopy_reaper == NULL)
+    {
+        loop->zerocopy_reaper = wtimerAdd(loop, __nio_zerocopy_reaper_cb, ZEROCOPY_REAP_MS, INFINITE);
+    }
+}
+
+void wloopDropZeroCopyParked(wloop_t *loop)
+{
+    // NOTE: the loop is going away with its timers, whatever is still parked is recycled as is
+    while (loop->zerocopy_parked != NULL)
+    {
+        wio_zerocopy_t *zc    = loop->zerocopy_parked;
+        loop->zerocopy_parked = zc->next;
+        __nio_zerocopy_free(loop, zc, true);
+    }
+    loop->zerocopy_reaper = NULL;
+}
+#endif
+
+#ifdef WIO_UDP_MMSG
+// pulls a batch of datagrams with one recvmmsg and hands them to the read callback back to back
+static void nio_read_udp_batch(wio_t *io)
+{
+    struct mmsghdr msgs[UDP_RECV_BATCH];
+    struct iovec   iovs[UDP_RECV_BATCH];
+    sockaddr_u     addrs[UDP_RECV_BATCH];
+    sbuf_t        *bufs[UDP_RECV_BATCH];
+
+    // NOTE: read once must not drain datagrams that nobody is going to read
+    int count = (io->read_flags & WIO_READ_ONCE) ? 1 : (int) io->udp_recv_batch;
+
+    memorySet(msgs, 0, sizeof(struct mmsghdr) * (size_t) count);
+    for (int i = 0; i < count; ++i)
+    {
+        bufs[i] = bufferpoolGetSmallBuffer(io->loop->bufpool);
+        assert(sbufGetRightCapacity(bufs[i]) >= 1024);
+
+        iovs[i].iov_base             = sbufGetMutablePtr(bufs[i]);
+        iovs[i].iov_len              = sbufGetRightCapacity(bufs[i]);
+        msgs[i].msg_hdr.msg_name     = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen  = sizeof(sockaddr_u);
+        msgs[i].msg_hdr.msg_iov      = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen   = 1;
+    }
+
+    // NOTE: udp sockets are blocking, the readiness only promises the first datagram
+    int nread = recvmmsg(io->fd, msgs, (unsigned int) count, MSG_DONTWAIT, NULL);
+    if (nread < 0)
+    {
+        int err = socketERRNO();
+        if (err != EAGAIN && err != EINTR && err != EMSGSIZE)
+        {
+            io->error = err;
+        }
+        nread = 0;
+    }
+
+    // NOTE: a full batch doubles the next one, otherwise it keeps one buffer of headroom over what arrived,
+    // so a quiet socket does not take UDP_RECV_BATCH pool buffers on every event
+    io->udp_recv_batch = (uint8_t) ((nread == count) ? min(count * 2, UDP_RECV_BATCH) : nread + 1);
+
+    int i = 0;
+    for (; i < nread && ! io->closed; ++i)
+    {
+        memoryCopy(io->peeraddr, &addrs[i], sizeof(sockaddr_u));
+        sbufSetLength(bufs[i], msgs[i].msg_len);
+        __read_cb(io, bufs[i]);
+    }
+    for (; i < count; ++i)
+    {
+        bufferpoolReuseBuffer(io->loop->bufpool, bufs[i]);
+    }
+}
+
+#ifdef WIO_UDP_OFFLOAD
+// the burst did not fit the large buffer, hands it over in large buffers cut at datagram boundaries
+static void nio_read_udp_gro_spilled(wio_t *io, sbuf_t *buf, uint32_t cap, uint32_t nread, uint32_t segment)
+{
+    buffer_pool_t *pool    = io->loop->bufpool;
+    const uint8_t *spill   = io->loop->udp_gro_spill;
+    uint32_t       spilled = nread - cap;
+    uint32_t       step    = (segment != 0) ? (cap / segment) * segment : 0;
+
+    if (step == 0)
+    {
+        // NOTE: a single datagram or a segment bigger than a large buffer, rare enough for one exact sized buffer
+        sbuf_t *whole = bufferpoolGetBufferForCapacity(pool, nread);
+        memoryCopy(sbufGetMutablePtr(whole), sbufGetRawPtr(buf), cap);
+        memoryCopy(sbufGetMutablePtr(whole) + cap, spill, spilled);
+        sbufSetLength(whole, nread);
+        bufferpoolReuseBuffer(pool, buf);
+        __read_cb(io, whole);
+        return;
+    }
+
+    // the bytes of buf after its last whole datagram are shorter than a segment, they open the next piece
+    uint32_t tail   = cap - step;
+    uint32_t offset = min(step - tail, spilled);
+    sbuf_t  *next   = bufferpoolGetLargeBuffer(pool);
+    assert(sbufGetRightCapacity(next) >= step);
+    memoryCopy(sbufGetMutablePtr(next), sbufGetMutablePtr(buf) + step, tail);
+    memoryCopy(sbufGetMutablePtr(next) + tail, spill, offset);
+    sbufSetLength(next, tail + offset);
+    sbufSetLength(buf, step);
+    __read_cb(io, buf);
+
+    while (! io->closed)
+    {
+        __read_cb(io, next);
+        if (offset == spilled || io->closed)
+        {
+            return;
+        }
+        uint32_t len = min(step, spilled - offset);
+        next         = bufferpoolGetLargeBuffer(pool);
+        memoryCopy(sbufGetMutablePtr(next), spill + offset, len);
+        sbufSetLength(next, len);
+        offset += len;
+    }
+    bufferpoolReuseBuffer(pool, next);
+}
+
+static void nio_read_udp_gro(wio_t *io)
+{
+    wloop_t       *loop = io->loop;
+    buffer_pool_t *pool = loop->bufpool;
+    if (loop->udp_gro_spill == NULL)
+    {
+        EVENTLOOP_ALLOC(loop->udp_gro_spill, UDP_GRO_BUFFER_SIZE);
+    }
+
+    // NOTE: a coalesced read can be up to 64KB and the kernel truncates it into anything smaller, a large buffer
+    // takes the usual burst and the spill area of the loop the rest
+    sbuf_t  *buf = bufferpoolGetLargeBuffer(pool);
+    uint32_t cap = min(sbufGetRightCapacity(buf), (uint32_t) UDP_GRO_BUFFER_SIZE);
+
+    union {
+        char           buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    sockaddr_u    addr;
+    struct iovec  iov[2] = {{.iov_base = sbufGetMutablePtr(buf), .iov_len = cap},
+                            {.iov_base = loop->udp_gro_spill, .iov_len = UDP_GRO_BUFFER_SIZE - cap}};
+    struct msghdr msg;
+    memorySet(&msg, 0, sizeof(msg));
+    msg.msg_name       = &addr;
+    msg.msg_namelen    = sizeof(sockaddr_u);
+    msg.msg_iov        = iov;
+    msg.msg_iovlen     = (iov[1].iov_len > 0) ? 2 : 1;
+    msg.msg_control    = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    int nread = (int) recvmsg(io->fd, &msg, MSG_DONTWAIT);
+    if (nread <= 0)
+    {
+        if (nread < 0)
+        {
+            int err = socketERRNO();
+            if (err != EAGAIN && err != EINTR)
+            {
+                io->error = err;
+            }
+        }
+        bufferpoolReuseBuffer(pool, buf);
+        return;
+    }
+
+    // NOTE: no UDP_GRO cmsg means a single datagram, which the callbacks see as segment size 0
+    int segment = 0;
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+    {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+        {
+            memoryCopy(&segment, CMSG_DATA(cm), sizeof(int));
+            break;
+        }
+    }
+
+    memoryCopy(io->peeraddr, &addr, sizeof(sockaddr_u));
+    io->gro_segment_size = (uint16_t) min(segment, nread);
+    if ((uint32_t) nread <= cap)
+    {
+        sbufSetLength(buf, (uint32_t) nread);
+        __read_cb(io, buf);
+        return;
+    }
+    nio_read_udp_gro_spilled(io, buf, cap, (uint32_t) nread, io->gro_segment_size);
+}
+#endif
+
+static int nio_queue_udp_write(wio_t *io, sbuf_t *buf)
+{
+    wloop_t *loop = io->loop;
+    if (loop->udp_sendq == NULL)
+    {
+        EVENTLOOP_ALLOC(loop->udp_sendq, sizeof(udp_sendq_item_t) * UDP_SENDQ_SIZE);
+    }
+    if (loop->udp_sendq_len == UDP_SENDQ_SIZE)
+    {
+        wloopFlushUdpWrites(loop);
+    }
+    int len = (int) sbufGetLength(buf);
+    udp_sendq_item_t *item = &loop->udp_sendq[loop->udp_sendq_len++];
+    item->io    = io;
+    item->io_id = io->id;
+    item->buf   = buf;
+    // NOTE: peeraddr may change before the flush, every datagram keeps its own destination
+    memoryCopy(&item->peeraddr, io->peeraddr, sizeof(sockaddr_u));
+    return len;
+}
+
+#ifdef WIO_UDP_OFFLOAD
+// number of items starting at items[0] that can leave as one UDP_SEGMENT send
+static int nio_udp_gso_run(udp_sendq_item_t *items, int count)
+{
+    uint32_t size = sbufGetLength(items[0].buf);
+    if (size == 0)
+    {
+        return 1;
+    }
+    socklen_t alen  = (socklen_t) SOCKADDR_LEN(&items[0].peeraddr);
+    uint32_t  total = size;
+    int       n     = 1;
+    while (n < count && n < UDP_GSO_MAX_SEGMENTS)
+    {
+        uint32_t len = sbufGetLength(items[n].buf);
+        if (len == 0 || len > size || total + len > UDP_GSO_MAX_BYTES ||
+            memcmp(&items[n].peeraddr, &items[0].peeraddr, alen) != 0)
+        {
+            break;
+        }
+        total += len;
+        n++;
+        // NOTE: only the last segment may be shorter
+        if (len < size)
+        {
+            break;
+        }
+    }
+    return n;
+}
+#endif
+
+static void nio_send_udp_batch(wio_t *io, udp_sendq_item_t *items, int count, bool gso)
+{
+    struct mmsghdr msgs[UDP_SENDQ_SIZE];
+    struct iovec   iovs[UDP_SENDQ_SIZE];
+#ifdef WIO_UDP_OFFLOAD
+    union {
+        char           buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } gso_cmsgs[UDP_SENDQ_SIZE];
+    int firsts[UDP_SENDQ_SIZE]; // first item of each message
+#else
+    discard gso;
+#endif
+
+    memorySet(msgs, 0, sizeof(struct mmsghdr) * (size_t) count);
+    int nmsgs = 0;
+    for (int i = 0; i < count;)
+    {
+        int n = 1;
+#ifdef WIO_UDP_OFFLOAD
+        if (gso)
+        {
+            n = nio_udp_gso_run(items + i, count - i);
+        }
+        firsts[nmsgs] = i;
+#endif
+        for (int k = i; k < i + n; ++k)
+        {
+            iovs[k].iov_base = sbufGetMutablePtr(items[k].buf);
+            iovs[k].iov_len  = sbufGetLength(items[k].buf);
+        }
+        struct msghdr *hdr = &msgs[nmsgs].msg_hdr;
+        hdr->msg_name      = &items[i].peeraddr;
+        hdr->msg_namelen   = (socklen_t) SOCKADDR_LEN(&items[i].peeraddr);
+        hdr->msg_iov       = &iovs[i];
+        hdr->msg_iovlen    = (size_t) n;
+#ifdef WIO_UDP_OFFLOAD
+        if (n > 1)
+        {
+            uint16_t segment    = (uint16_t) sbufGetLength(items[i].buf);
+            hdr->msg_control    = gso_cmsgs[nmsgs].buf;
+            hdr->msg_controllen = sizeof(gso_cmsgs[nmsgs].buf);
+            struct cmsghdr *cm  = CMSG_FIRSTHDR(hdr);
+            cm->cmsg_level      = SOL_UDP;
+            cm->cmsg_type       = UDP_SEGMENT;
+            cm->cmsg_len        = CMSG_LEN(sizeof(uint16_t));
+            memoryCopy(CMSG_DATA(cm), &segment, sizeof(uint16_t));
+        }
+#endif
+        nmsgs++;
+        i += n;
+    }
+
+    int sent = 0, dropped = 0, err = 0;
+    while (sent < nmsgs)
+    {
+        int nsent = sendmmsg(io->fd, msgs + sent, (unsigned int) (nmsgs - sent), 0);
+        if (nsent < 0)
+        {
+            err = socketERRNO();
+            if (err == EINTR)
+            {
+                continue;
+            }
+#ifdef WIO_UDP_OFFLOAD
+            if (msgs[sent].msg_hdr.msg_iovlen > 1 && (err == EIO || err == EINVAL))
+            {
+                // NOTE: EIO means the route has no checksum offload, so gso is off for good on this io,
+                // EINVAL is usually a segment bigger than the path mtu, the rest of this batch goes unsegmented
+                if (err == EIO)
+                {
+                    io->udp_gso = 0;
+                }
+                wlogd("udp gso fd=%d fallback: %s:%d", io->fd, socketStrError(err), err);
+                nio_send_udp_batch(io, items + firsts[sent], count - firsts[sent], false);
+                break;
+            }
+#endif
+            // NOTE: the errors are about one destination or one datagram (a listener replies to many peers
+            // from one socket), so like a failed wioWrite the datagram is dropped and the rest still go out
+            io->error = err;
+            dropped += (int) msgs[sent].msg_hdr.msg_iovlen;
+            sent++;
+            continue;
+        }
+        io->write_syscalls++;
+        for (int k = sent; k < sent + nsent; ++k)
+        {
+            io->write_syscall_buffers += (uint64_t) msgs[k].msg_hdr.msg_iovlen;
+        }
+        sent += nsent;
+    }
+    if (dropped > 0)
+    {
+        // the writes were already reported as done, the log is the only trace left of them
+        wlogw("sendmmsg fd=%d dropped %d of %d datagrams, last error: %s:%d", io->fd, dropped, count,
+              socketStrError(err), err);
+    }
+}
+
+static bool nio_udp_sendq_item_alive(udp_sendq_item_t *item)
+{
+    return item->io != NULL && item->io->id == item->io_id && item->io->ready && ! item->io->closed;
+}
+
+// number of items starting at items[0] that belong to the same io
+static uint32_t nio_udp_sendq_run(udp_sendq_item_t *items, uint32_t count)
+{
+    uint32_t n = 1;
+    while (n < count && items[n].io == items[0].io && items[n].io_id == items[0].io_id)
+    {
+        n++;
+    }
+    return n;
+}
+
+void wloopFlushUdpWrites(wloop_t *loop)
+{
+    // NOTE: a write callback may queue new datagrams, they go to the spare array
+    udp_sendq_item_t *items = loop->udp_sendq;
+    uint32_t          count = loop->udp_sendq_len;
+    loop->udp_sendq         = loop->udp_sendq_spare;
+    loop->udp_sendq_spare   = NULL;
+    loop->udp_sendq_len     = 0;
+    loop->udp_flushing      = items;
+    loop->udp_flushing_len  = count;
+
+    // NOTE: everything is sent before the first write callback, a callback that closes an io cannot strand the
+    // datagrams of that io which are later in this array
+    for (uint32_t i = 0, n; i < count; i += n)
+    {
+        n = nio_udp_sendq_run(items + i, count - i);
+        if (nio_udp_sendq_item_alive(&items[i]))
+        {
+            nio_send_udp_batch(items[i].io, items + i, (int) n, items[i].io->udp_gso);
+        }
+        else
+        {
+            wlogd("udp io closed before its %u queued datagrams were sent", n);
+        }
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bufferpoolReuseBuffer(loop->bufpool, items[i].buf);
+    }
+    for (uint32_t i = 0, n; i < count; i += n)
+    {
+        n = nio_udp_sendq_run(items + i, count - i);
+        if (nio_udp_sendq_item_alive(&items[i]))
+        {
+            __write_cb(items[i].io);
+        }
+    }
+    loop->udp_flushing     = NULL;
+    loop->udp_flushing_len = 0;
+
+    if (loop->udp_sendq_spare == NULL)
+    {
+        loop->udp_sendq_spare = items;
+    }
+    else
+    {
+        EVENTLOOP_FREE(items);
+    }
+}
+// sends the datagrams of a closing io that are still waiting for the end of the iteration, wioWrite already
+// reported them as written
+static void nio_flush_udp_writes_of(wio_t *io)
+{
+    wloop_t          *loop = io->loop;
+    udp_sendq_item_t  mine[UDP_SENDQ_SIZE];
+    uint32_t          nmine = 0;
+    uint32_t          kept  = 0;
+
+    for (uint32_t i = 0; i < loop->udp_sendq_len; ++i)
+    {
+        if (loop->udp_sendq[i].io == io && loop->udp_sendq[i].io_id == io->id)
+        {
+            mine[nmine++] = loop->udp_sendq[i];
+        }
+        else
+        {
+            loop->udp_sendq[kept++] = loop->udp_sendq[i];
+        }
+    }
+    loop->udp_sendq_len = kept;
+    // NOTE: a write callback of a running flush closed this io, its datagrams there are already sent
+    for (uint32_t i = 0; i < loop->udp_flushing_len; ++i)
+    {
+        if (loop->udp_flushing[i].io == io)
+        {
+            loop->udp_flushing[i].io = NULL;
+        }
+    }
+    if (nmine == 0)
+    {
+        return;
+    }
+
+    nio_send_udp_batch(io, mine, (int) nmine, io->udp_gso);
+    for (uint32_t i = 0; i < nmine; ++i)
+    {
+        bufferpoolReuseBuffer(loop->bufpool, mine[i].buf);
+    }
+}
+#endif
+
+static sbuf_t *nio_tcp_read_buffer(wio_t *io)
+{
+    buffer_pool_t *pool = io->loop->bufpool;
+    if (io->read_size_hint >= bufferpoolGetMediumBufferSize(pool))
+    {
+        return bufferpoolGetLargeBuffer(pool);
+    }
+    return bufferpoolGetBufferForCapacity(pool, io->read_size_hint);
+}
+
+static void nio_tcp_update_read_hint(wio_t *io, uint32_t nread, uint32_t available)
+{
+    if (nread == available)
+    {
+        // NOTE: a full buffer means more is waiting, bulk flows go straight to large buffers
+        io->read_size_hint = max(io->read_size_hint, bufferpoolGetLargeBufferSize(io->loop->bufpool));
+        return;
+    }
+    io->read_size_hint = io->read_size_hint - (io->read_size_hint >> TCP_READ_EWMA_SHIFT) + (nread >> TCP_READ_EWMA_SHIFT);
+}
+
+#ifdef WIO_TCP_ZEROCOPY_RECEIVE
+// maps the window the views of this io are received into: a private page for the headers, then the socket pages
+static sbuf_mapping_t *__nio_zerocopy_receive_window(wio_t *io)
+{
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t len  = page + ZEROCOPY_RECEIVE_WINDOW;
+
+    uint8_t *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    if (mmap(base + page, ZEROCOPY_RECEIVE_WINDOW, PROT_READ, MAP_SHARED | MAP_FIXED, io->fd, 0) == MAP_FAILED)
+    {
+        wlogw("zero-copy receive can not map fd=%d: %s", io->fd, socketStrError(socketERRNO()));
+        io->zerocopy_rx = 0;
+        munmap(base, len);
+        return NULL;
+    }
+
+    sbuf_mapping_t *m = (sbuf_mapping_t *) (base + page - sizeof(sbuf_t) - sizeof(sbuf_mapping_t));
+    m->base           = base;
+    m->len            = len;
+    atomicStoreExplicit(&m->refs, 1, memory_order_relaxed);
+    return m;
+}
+
+static void __nio_zerocopy_receive_close(wio_t *io)
+{
+    // NOTE: a view still queued somewhere keeps the window (and the socket behind it) until it is destroyed
+    sbufMappingRelease(io->zerocopy_rx_window);
+    io->zerocopy_rx_window = NULL;
+}
+
+// maps the next whole pages of payload as a read only view, NULL if the kernel could not map anything
+// (no data, or the next bytes are not page aligned: io->zerocopy_rx_skip of them have to be copied first)
+static sbuf_t *__nio_zerocopy_receive(wio_t *io)
+{
+    sbuf_mapping_t *m = io->zerocopy_rx_window;
+    if (m == NULL)
+    {
+        m = __nio_zerocopy_receive_window(io);
+        if (m == NULL)
+        {
+            return NULL;
+        }
+        io->zerocopy_rx_window = m;
+    }
+    else if (atomicLoadExplicit(&m->refs, memory_order_acquire) != 1)
     {
-        addrlen = sizeof(sockaddr_u);
-        getsockname(io->fd, io->localaddr, &addrlen);
+        // NOTE: the last view is still queued, mapping again would replace its pages; this read copies
+        return NULL;
+    }
 
-        __connect_cb(io);
+    sbuf_t *b = (sbuf_t *) (m + 1);
 
-        return;
+    struct tcp_zerocopy_receive zc;
+    memorySet(&zc, 0, sizeof(zc));
+    zc.address        = (uint64_t) (uintptr_t) b->buf;
+    zc.length         = ZEROCOPY_RECEIVE_WINDOW;
+    socklen_t zc_size = sizeof(zc);
+    if (getsockopt(io->fd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zc, &zc_size) != 0 || zc.length == 0)
+    {
+        // NOTE: errors and eof are left to the copying read that follows
+        io->zerocopy_rx_skip = zc.recv_skip_hint;
+        return NULL;
     }
+    io->zerocopy_rx_skip = zc.recv_skip_hint;
 
-connect_error:
-    wlogw("connfd=%d connect error: %s:%d", io->fd, socketStrError(io->error), io->error);
-    wioClose(io);
-}
+    // NOTE: pages past zc.length are left from an earlier view, the next mapping read replaces them
+    b->alloc_offset = 0;
+    b->arena        = NULL;
+    b->map_len      = (uint32_t) m->len;
+    atomicStoreExplicit(&b->refs, 0, memory_order_relaxed);
+    b->is_temporary = false;
+    b->curpos       = 0;
+    b->l_pad        = 0;
+    b->len          = zc.length;
+    b->capacity     = zc.length;
+    atomicAddExplicit(&m->refs, 1, memory_order_relaxed);
 
-static void nio_connect_event_cb(wevent_t *ev)
-{
-    wio_t   *io = (wio_t *) ev->userdata;
-    uint32_t id = (uint32_t) (uintptr_t) ev->privdata;
-    if (io->id != id)
-        return;
-    nio_connect(io);
+    io->zerocopy_rx_mapped += zc.length;
+    return b;
 }
 
-static int nio_connect_async(wio_t *io)
+static void __nio_zerocopy_receive_copied(wio_t *io, uint32_t nread)
 {
-    wevent_t ev;
-    memorySet(&ev, 0, sizeof(ev));
-    ev.cb       = nio_connect_event_cb;
-    ev.userdata = io;
-    ev.privdata = (void *) (uintptr_t) io->id;
-    wloopPostEvent(io->loop, &ev);
-    return 0;
+    io->zerocopy_rx_skip -= min(io->zerocopy_rx_skip, nread);
+    io->zerocopy_rx_copied += nread;
+
+    if (io->zerocopy_rx_mapped + io->zerocopy_rx_copied >= ZEROCOPY_RECEIVE_PROBE_BYTES &&
+        io->zerocopy_rx_copied > io->zerocopy_rx_mapped)
+    {
+        // NOTE: loopback and nics without header split never give page aligned payload
+        wlogd("zero-copy receive maps too little on fd=%d, copying from now on", io->fd);
+        io->zerocopy_rx = 0;
+        if (io->zerocopy_rx_window != NULL)
+        {
+            __nio_zerocopy_receive_close(io);
+        }
+    }
 }
+#endif
 
-static int __nio_read(wio_t *io, void *buf, unsigned int len)
+#ifdef EVENT_IO_URING
+// hands out what the multishot recv of the io_uring backend already read, a recv() here would reorder the stream
+static void nio_read_tcp_completed(wio_t *io)
 {
-    int nread = 0;
-    switch (io->io_type)
+    while (! read_queue_empty(&io->uring_rx_queue))
     {
+        sbuf_t *buf = *read_queue_front(&io->uring_rx_queue);
+        read_queue_pop_front(&io->uring_rx_queue);
+        if (buf == NULL)
+        {
+            io->error = io->uring_rx_error;
+            wioClose(io);
+            return;
+        }
+        __read_cb(io, buf);
 
-    case WIO_TYPE_TCP:
-
-        // #if defined(OS_LINUX) && defined(HAVE_PIPE)
-        //         if(io->pfd_w){
-        //             nread = splice(io->fd, NULL,io->pfd_w,0, len, SPLICE_F_NONBLOCK);
-        //         }else
-        // #endif
-        nread = recv(io->fd, buf, (size_t) len, 0);
-        break;
-    case WIO_TYPE_UDP: // udp can also be more than 1472 bytes
-    case WIO_TYPE_IP: {
-        socklen_t addrlen = sizeof(sockaddr_u);
-        nread             = recvfrom(io->fd, buf, (size_t) len, 0, io->peeraddr, &addrlen);
-    }
-    break;
-    default:
-        nread = read(io->fd, buf, len);
-        break;
+        // the rest waits in the queue if the callback paused or closed the io
+        if (io->closed || io->close || ! (io->events & WW_READ))
+        {
+            return;
+        }
     }
-    // wlogd("read retval=%d", nread);
-    return nread;
 }
+#endif
 
-static int __nio_write(wio_t *io, const void *buf, int len)
+static void nio_read_tcp(wio_t *io)
 {
-    int nwrite = 0;
-    switch (io->io_type)
+    uint32_t budget = TCP_READ_BUDGET;
+
+#ifdef EVENT_IO_URING
+    if (io->uring_rx_state != IO_URING_RX_OFF)
     {
-    case WIO_TYPE_TCP: {
-        // #if defined(OS_LINUX) && defined(HAVE_PIPE)
-        //     if(io->pfd_r){
-        //         nwrite = splice(io->pfd_r, NULL,io->fd,0, len, SPLICE_F_NONBLOCK);
-        //         break;
-        //     }
-        // #endif
-        int flag = 0;
-#ifdef MSG_NOSIGNAL
-        flag |= MSG_NOSIGNAL;
-#endif
-        nwrite = send(io->fd, buf, (size_t) len, flag);
+        nio_read_tcp_completed(io);
+        return;
     }
-    break;
-    case WIO_TYPE_UDP:
-    case WIO_TYPE_IP:
-        nwrite = sendto(io->fd, buf, (size_t) len, 0, io->peeraddr, SOCKADDR_LEN(io->peeraddr));
-        break;
-    default:
-        nwrite = write(io->fd, buf, (size_t) len);
-        break;
+#endif
+
+    while (true)
+    {
+#ifdef WIO_TCP_ZEROCOPY_RECEIVE
+        // only bulk flows are worth the mapping syscalls
+        if (io->zerocopy_rx && io->zerocopy_rx_skip == 0 &&
+            io->read_size_hint >= bufferpoolGetLargeBufferSize(io->loop->bufpool))
+        {
+            sbuf_t *view = __nio_zerocopy_receive(io);
+            if (view != NULL)
+            {
+                uint32_t mapped = sbufGetLength(view);
+                __read_cb(io, view);
+
+                if ((mapped < ZEROCOPY_RECEIVE_WINDOW && io->zerocopy_rx_skip == 0) || budget <= mapped ||
+                    io->closed || io->close || ! (io->events & WW_READ))
+                {
+                    return;
+                }
+                budget -= mapped;
+                continue;
+            }
+        }
+#endif
+        sbuf_t  *buf       = nio_tcp_read_buffer(io);
+        uint32_t available = sbufGetRightCapacity(buf);
+        assert(available >= 1024);
+
+#ifdef WIO_TCP_ZEROCOPY_RECEIVE
+        if (io->zerocopy_rx && io->zerocopy_rx_skip != 0)
+        {
+            // stop at the next page aligned byte, mapping takes over from there
+            available = min(available, io->zerocopy_rx_skip);
+        }
+#endif
+
+        int nread = __nio_read(io, sbufGetMutablePtr(buf), available);
+
+        if (nread < 0)
+        {
+            int err = socketERRNO();
+            bufferpoolReuseBuffer(io->loop->bufpool, buf);
+            if (err == EAGAIN || err == EINTR || err == EMSGSIZE)
+            {
+                return;
+            }
+            io->error = err;
+            wioClose(io);
+            return;
+        }
+        if (nread == 0)
+        {
+            bufferpoolReuseBuffer(io->loop->bufpool, buf);
+            wioClose(io);
+            return;
+        }
+
+        nio_tcp_update_read_hint(io, (uint32_t) nread, available);
+#ifdef WIO_TCP_ZEROCOPY_RECEIVE
+        if (io->zerocopy_rx)
+        {
+            __nio_zerocopy_receive_copied(io, (uint32_t) nread);
+        }
+#endif
+        sbufSetLength(buf, (uint32_t) nread);
+        __read_cb(io, buf);
+
+        // a short read drained the socket; the callback may also have paused or closed the io
+        if ((uint32_t) nread < available || budget <= (uint32_t) nread || io->closed || io->close ||
+            ! (io->events & WW_READ))
+        {
+            return;
+        }
+        budget -= (uint32_t) nread;
     }
-    // wlogd("write retval=%d", nwrite);
-    return nwrite;
 }
 
 static void nio_read(wio_t *io)
@@ -249,10 +1259,30 @@ static void nio_read(wio_t *io)
     // #endif
     sbuf_t *buf;
 
+#ifdef WIO_UDP_MMSG
+    if (io->io_type == WIO_TYPE_UDP)
+    {
+#ifdef WIO_UDP_OFFLOAD
+        if (io->udp_gro)
+        {
+            nio_read_udp_gro(io);
+            return;
+        }
+#endif
+        nio_read_udp_batch(io);
+        return;
+    }
+#endif
+
+    if (io->io_type == WIO_TYPE_TCP)
+    {
+        nio_read_tcp(io);
+        return;
+    }
+
     switch (io->io_type)
     {
     default:
-    case WIO_TYPE_TCP:
         buf = bufferpoolGetLargeBuffer(io->loop->bufpool);
         break;
     case WIO_TYPE_UDP:
@@ -324,7 +1354,7 @@ disconnect:
 static void nio_write(wio_t *io)
 {
     // printd("nio_write fd=%d\n", io->fd);
-    int nwrite = 0, err = 0;
+    int nwrite = 0, err = 0, nbufs = 1, len = 0;
     //
 write:
     if (write_queue_empty(&io->write_queue))
@@ -337,10 +1367,29 @@ write:
         }
         return;
     }
-    sbuf_t *buf = *write_queue_front(&io->write_queue);
-    int     len = (int) sbufGetLength(buf);
-    // char* base = pbuf->base;
-    nwrite = __nio_write(io, sbufGetMutablePtr(buf), len);
+#ifdef NIO_HAVE_WRITEV
+    // datagrams keep their boundaries, only streams are gathered
+    if (write_queue_size(&io->write_queue) > 1 && (io->io_type & WIO_TYPE_SOCK_STREAM))
+    {
+        nwrite = __nio_writev(io, &nbufs, &len);
+    }
+    else
+#endif
+    {
+        sbuf_t *buf = *write_queue_front(&io->write_queue);
+        len         = (int) sbufGetLength(buf);
+        nbufs       = 1;
+#ifdef WIO_TCP_ZEROCOPY
+        if (__nio_zerocopy_wanted(io, buf))
+        {
+            nwrite = __nio_write_zerocopy(io, buf);
+        }
+        else
+#endif
+        {
+            nwrite = __nio_write(io, sbufGetMutablePtr(buf), len);
+        }
+    }
     // printd("write retval=%d\n", nwrite);
     if (nwrite < 0)
     {
@@ -361,30 +1410,40 @@ write:
     {
         goto disconnect;
     }
-    sbufShiftRight(buf, (uint32_t) nwrite);
+    io->write_syscalls++;
+    io->write_syscall_buffers += (uint64_t) nbufs;
     io->write_bufsize -= (uint32_t) nwrite;
-    if (nwrite == len)
-    {
-        // NOTE: after write_cb, pbuf maybe invalid.
-        // EVENTLOOP_FREE(pbuf->base);
-        // #if defined(OS_LINUX) && defined(HAVE_PIPE)
-        //     if(io->pfd_w == 0)
-        //         EVENTLOOP_FREE(base);
-        // #else
-        bufferpoolReuseBuffer(io->loop->bufpool, buf);
-        // #endif
-        write_queue_pop_front(&io->write_queue);
-        __write_cb(io);
 
-        if (! io->closed)
+    // NOTE: a gathered write may end in the middle of any of the buffers
+    uint32_t consumed = (uint32_t) nwrite;
+    while (consumed > 0)
+    {
+        sbuf_t  *buf  = *write_queue_front(&io->write_queue);
+        uint32_t blen = sbufGetLength(buf);
+        if (consumed < blen)
+        {
+            // NOTE: shared buffers are read only, shifting needs a private one
+            buf                                  = sbufCopyOnWriteByPool(io->loop->bufpool, buf);
+            *write_queue_front(&io->write_queue) = buf;
+            sbufShiftRight(buf, consumed);
+            break;
+        }
+        consumed -= blen;
+#ifdef WIO_TCP_ZEROCOPY
+        if (! __nio_zerocopy_hold(io, buf))
+#endif
         {
-            // write continue
-            goto write;
+            bufferpoolReuseBuffer(io->loop->bufpool, buf);
         }
+        write_queue_pop_front(&io->write_queue);
     }
-    else
+
+    // NOTE: after write_cb, io maybe closed.
+    __write_cb(io);
+    if (nwrite == len && ! io->closed)
     {
-        __write_cb(io);
+        // write continue
+        goto write;
     }
 
     return;
@@ -399,6 +1458,13 @@ disconnect:
 
 static void wio_handle_events(wio_t *io)
 {
+#ifdef WIO_TCP_ZEROCOPY
+    // NOTE: epoll keeps reporting EPOLLERR until the completions are read from the error queue
+    if (io->zerocopy != NULL && io->zerocopy->completions < io->zerocopy->sends)
+    {
+        __nio_zerocopy_reap(io->loop, io->zerocopy, io->fd);
+    }
+#endif
     if ((io->events & WW_READ) && (io->revents & WW_READ))
     {
         if (io->accept)
@@ -465,7 +1531,7 @@ int wioConnect(wio_t *io)
         return 0;
     }
     int timeout                 = io->connect_timeout ? io->connect_timeout : WIO_DEFAULT_CONNECT_TIMEOUT;
-    io->connect_timer           = wtimerAdd(io->loop, __connect_timeout_cb, (uint32_t) timeout, 1);
+    io->connect_timer           = wtimerAddCoarse(io->loop, __connect_timeout_cb, (uint32_t) timeout, 1);
     io->connect_timer->privdata = io;
     io->connect                 = 1;
     return wioAdd(io, wio_handle_events, WW_WRITE);
@@ -483,6 +1549,106 @@ int wioRead(wio_t *io)
     return 0;
 }
 
+#ifdef WIO_TCP_COALESCE
+static bool nio_tcp_coalesce_wanted(wio_t *io, sbuf_t *buf)
+{
+#ifdef WIO_TCP_ZEROCOPY
+    // NOTE: a gathered send never goes zerocopy, big buffers of such ios leave on their own
+    if (__nio_zerocopy_wanted(io, buf))
+    {
+        return false;
+    }
+#endif
+    // NOTE: with the queue full the write goes out right away, a flush from here could close ios under the caller
+    if (! io->write_coalesced && io->loop->tcp_flushq_len == TCP_FLUSHQ_SIZE)
+    {
+        return false;
+    }
+    return io->write_bufsize + sbufGetLength(buf) < TCP_COALESCE_MAX_BYTES;
+}
+
+static int nio_coalesce_tcp_write(wio_t *io, sbuf_t *buf)
+{
+    wloop_t *loop = io->loop;
+    if (! io->write_coalesced)
+    {
+        if (loop->tcp_flushq == NULL)
+        {
+            EVENTLOOP_ALLOC(loop->tcp_flushq, sizeof(wio_t *) * TCP_FLUSHQ_SIZE);
+        }
+        loop->tcp_flushq[loop->tcp_flushq_len++] = io;
+        io->write_coalesced                       = 1;
+    }
+    int len = (int) sbufGetLength(buf);
+    if (io->write_queue.maxsize == 0)
+    {
+        write_queue_init(&io->write_queue, 4);
+    }
+    write_queue_push_back(&io->write_queue, &buf);
+    io->write_bufsize += (uint32_t) len;
+    return len;
+}
+
+// sends what the io coalesced so far, waits for writability if the socket did not take all of it
+static void nio_flush_coalesced(wio_t *io)
+{
+    io->write_coalesced = 0;
+    nio_write(io);
+    if (! io->closed && ! write_queue_empty(&io->write_queue))
+    {
+        wioAdd(io, wio_handle_events, WW_WRITE);
+    }
+}
+
+void wloopFlushTcpWrites(wloop_t *loop)
+{
+    // NOTE: write callbacks of the flush may coalesce new writes, they wait for the next flush
+    wio_t   *items[TCP_FLUSHQ_SIZE];
+    uint32_t count = loop->tcp_flushq_len;
+    memoryCopy(items, loop->tcp_flushq, sizeof(wio_t *) * count);
+    loop->tcp_flushq_len   = 0;
+    loop->tcp_flushing     = items;
+    loop->tcp_flushing_len = count;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        wio_t *io = items[i];
+        // closed ios took themselves out (nio_forget_tcp_flush), the io may also have been flushed early
+        if (io == NULL || ! io->write_coalesced)
+        {
+            continue;
+        }
+        nio_flush_coalesced(io);
+    }
+    loop->tcp_flushing     = NULL;
+    loop->tcp_flushing_len = 0;
+}
+
+// takes a closing io out of the pending and the running flush, it may be freed before either gets to it
+static void nio_forget_tcp_flush(wio_t *io)
+{
+    wloop_t *loop = io->loop;
+    uint32_t kept = 0;
+    // NOTE: an io flushed early and coalesced again is in there twice
+    for (uint32_t i = 0; i < loop->tcp_flushq_len; ++i)
+    {
+        if (loop->tcp_flushq[i] != io)
+        {
+            loop->tcp_flushq[kept++] = loop->tcp_flushq[i];
+        }
+    }
+    loop->tcp_flushq_len = kept;
+    for (uint32_t i = 0; i < loop->tcp_flushing_len; ++i)
+    {
+        if (loop->tcp_flushing[i] == io)
+        {
+            loop->tcp_flushing[i] = NULL;
+        }
+    }
+    io->write_coalesced = 0;
+}
+#endif
+
 int wioWrite(wio_t *io, sbuf_t *buf)
 {
     if (io->closed)
@@ -491,13 +1657,52 @@ int wioWrite(wio_t *io, sbuf_t *buf)
         bufferpoolReuseBuffer(io->loop->bufpool, buf);
         return -1;
     }
+#ifdef WIO_UDP_MMSG
+    if (io->io_type == WIO_TYPE_UDP)
+    {
+        return nio_queue_udp_write(io, buf);
+    }
+#endif
+#ifdef WIO_TCP_COALESCE
+    if (io->io_type == WIO_TYPE_TCP && ! io->connect &&
+        (io->write_coalesced || write_queue_empty(&io->write_queue)))
+    {
+        if (nio_tcp_coalesce_wanted(io, buf))
+        {
+            return nio_coalesce_tcp_write(io, buf);
+        }
+        if (io->write_coalesced)
+        {
+            // NOTE: a big write takes the small ones queued before it along, in the same gathered send
+            int len = (int) sbufGetLength(buf);
+            write_queue_push_back(&io->write_queue, &buf);
+            io->write_bufsize += (uint32_t) len;
+            nio_flush_coalesced(io);
+            if (io->closed)
+            {
+                return -1;
+            }
+            // buf is the last one in the queue, whatever is still queued is its unsent tail first
+            return len - (int) min((uint32_t) len, io->write_bufsize);
+        }
+    }
+#endif
     int nwrite = 0, err = 0;
     //
     int len = (int) sbufGetLength(buf);
     if (write_queue_empty(&io->write_queue))
     {
         //    try_write:
-        nwrite = __nio_write(io, sbufGetMutablePtr(buf), len);
+#ifdef WIO_TCP_ZEROCOPY
+        if (__nio_zerocopy_wanted(io, buf))
+        {
+            nwrite = __nio_write_zerocopy(io, buf);
+        }
+        else
+#endif
+        {
+            nwrite = __nio_write(io, sbufGetMutablePtr(buf), len);
+        }
         // printd("write retval=%d\n", nwrite);
         if (nwrite < 0)
         {
@@ -519,6 +1724,8 @@ int wioWrite(wio_t *io, sbuf_t *buf)
         {
             goto disconnect;
         }
+        io->write_syscalls++;
+        io->write_syscall_buffers++;
         if (nwrite == len)
         {
             goto write_done;
@@ -535,6 +1742,7 @@ int wioWrite(wio_t *io, sbuf_t *buf)
             io->error = WERR_OVER_LIMIT;
             goto write_error;
         }
+        buf = sbufCopyOnWriteByPool(io->loop->bufpool, buf);
         sbufShiftRight(buf, (uint32_t) nwrite);
         // #if defined(OS_LINUX) && defined(HAVE_PIPE)
         //         if(io->pfd_w != 0){
@@ -571,7 +1779,11 @@ write_done:
 
     if (nwrite > 0)
     {
+#ifdef WIO_TCP_ZEROCOPY
+        if (nwrite == len && ! __nio_zerocopy_hold(io, buf))
+#else
         if (nwrite == len)
+#endif
         {
             bufferpoolReuseBuffer(io->loop->bufpool, buf);
         }
@@ -586,7 +1798,14 @@ disconnect:
      * if wio_close_sync, we have to be very careful to avoid using freed resources.
      * But if wioCloseAsync, we do not have to worry about this.
      */
-    bufferpoolReuseBuffer(io->loop->bufpool, buf);
+#ifdef WIO_TCP_ZEROCOPY
+    // NOTE: only a partial send of buf itself pins it, otherwise the pin belongs to the queue front and
+    // __nio_zerocopy_close takes that one over
+    if (nwrite <= 0 || ! __nio_zerocopy_hold(io, buf))
+#endif
+    {
+        bufferpoolReuseBuffer(io->loop->bufpool, buf);
+    }
     if (io->io_type & WIO_TYPE_SOCK_STREAM)
     {
         wioCloseAsync(io);
@@ -612,15 +1831,39 @@ int wioClose(wio_t *io)
 
         wlogd("write_queue not empty, close later.");
         int timeout_ms            = io->close_timeout ? io->close_timeout : WIO_DEFAULT_CLOSE_TIMEOUT;
-        io->close_timer           = wtimerAdd(io->loop, __close_timeout_cb, (uint32_t) timeout_ms, 1);
+        io->close_timer           = wtimerAddCoarse(io->loop, __close_timeout_cb, (uint32_t) timeout_ms, 1);
         io->close_timer->privdata = io;
         return 0;
     }
     bool has_pending = io->pending;
 
+#ifdef WIO_UDP_MMSG
+    if (io->io_type == WIO_TYPE_UDP && (io->loop->udp_sendq_len > 0 || io->loop->udp_flushing_len > 0))
+    {
+        nio_flush_udp_writes_of(io);
+    }
+#endif
+#ifdef WIO_TCP_COALESCE
+    if (io->loop->tcp_flushq_len > 0 || io->loop->tcp_flushing_len > 0)
+    {
+        nio_forget_tcp_flush(io);
+    }
+#endif
     io->closed    = 1;
     wloop_t *loop = io->loop;
 
+#ifdef WIO_TCP_ZEROCOPY
+    if (io->zerocopy != NULL)
+    {
+        __nio_zerocopy_close(io);
+    }
+#endif
+#ifdef WIO_TCP_ZEROCOPY_RECEIVE
+    if (io->zerocopy_rx_window != NULL)
+    {
+        __nio_zerocopy_receive_close(io);
+    }
+#endif
     wioDone(io);
     __close_cb(io);
     // SAFE_FREE(io->hostname);
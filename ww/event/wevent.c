@@ -64,6 +64,18 @@ static void fillIoType(wio_t *io)
     }
 }
 
+static void wioSocketAllocAddrs(wio_t *io)
+{
+    if (io->localaddr == NULL)
+    {
+        EVENTLOOP_ALLOC(io->localaddr, sizeof(sockaddr_u));
+    }
+    if (io->peeraddr == NULL)
+    {
+        EVENTLOOP_ALLOC(io->peeraddr, sizeof(sockaddr_u));
+    }
+}
+
 static void wioSocketInit(wio_t *io)
 {
     if ((io->io_type & WIO_TYPE_SOCK_DGRAM) || (io->io_type & WIO_TYPE_SOCK_RAW))
@@ -76,14 +88,7 @@ static void wioSocketInit(wio_t *io)
         nonBlocking(io->fd);
     }
     // fill io->localaddr io->peeraddr
-    if (io->localaddr == NULL)
-    {
-        EVENTLOOP_ALLOC(io->localaddr, sizeof(sockaddr_u));
-    }
-    if (io->peeraddr == NULL)
-    {
-        EVENTLOOP_ALLOC(io->peeraddr, sizeof(sockaddr_u));
-    }
+    wioSocketAllocAddrs(io);
     socklen_t addrlen = sizeof(sockaddr_u);
     int       ret     = getsockname(io->fd, io->localaddr, &addrlen);
     discard ret;
@@ -97,6 +102,24 @@ static void wioSocketInit(wio_t *io)
     }
 }
 
+void wioApplyBusyPoll(wio_t *io)
+{
+#ifdef SO_BUSY_POLL
+    if (io->loop->busy_poll_max_us == 0 || ! (io->io_type & WIO_TYPE_SOCKET))
+    {
+        return;
+    }
+    int budget_us = (int) io->loop->busy_poll_max_us;
+    // NOTE: raising it above net.core.busy_read needs CAP_NET_ADMIN, the spin in wloopProcessEvents works without it
+    if (setsockopt(io->fd, SOL_SOCKET, SO_BUSY_POLL, (const char *) &budget_us, sizeof(budget_us)) != 0)
+    {
+        wlogd("setsockopt SO_BUSY_POLL fd=%d error=%d", io->fd, socketERRNO());
+    }
+#else
+    discard io;
+#endif
+}
+
 void wioInit(wio_t *io)
 {
     // alloc localaddr,peeraddr when wioSocketInit
@@ -116,10 +139,8 @@ void wioInit(wio_t *io)
     discard io;
 }
 
-void wioReady(wio_t *io)
+static void wioResetState(wio_t *io)
 {
-    if (io->ready)
-        return;
     // flags
     io->ready     = 1;
     io->connected = 0;
@@ -128,6 +149,9 @@ void wioReady(wio_t *io)
     io->recv = io->send = 0;
     io->recvfrom = io->sendto = 0;
     io->close                 = 0;
+    io->udp_gro = io->udp_gso = 0;
+    io->zerocopy_rx           = 0;
+    io->write_coalesced       = 0;
     // public:
     io->id      = wioSetNextID();
     io->io_type = WIO_TYPE_UNKNOWN;
@@ -135,10 +159,25 @@ void wioReady(wio_t *io)
     io->events = io->revents = 0;
     io->last_read_hrtime = io->last_write_hrtime = io->loop->cur_hrtime;
 
-    io->read_flags = 0;
+    io->read_flags         = 0;
+    io->gro_segment_size   = 0;
+    io->udp_recv_batch     = 1;
+    io->read_size_hint     = 0;
+    io->zerocopy_rx_skip   = 0;
+    io->zerocopy_rx_mapped = 0;
+    io->zerocopy_rx_copied = 0;
+    io->zerocopy_rx_window = NULL;
+#ifdef EVENT_IO_URING
+    io->uring_rx_error    = 0;
+    io->uring_rx_state    = IO_URING_RX_OFF;
+    io->uring_rx_inflight = 0;
+#endif
     // write_queue
-    io->write_bufsize     = 0;
-    io->max_write_bufsize = MAX_WRITE_BUFSIZE;
+    io->write_bufsize         = 0;
+    io->max_write_bufsize     = MAX_WRITE_BUFSIZE;
+    io->write_syscalls        = 0;
+    io->write_syscall_buffers = 0;
+    io->zerocopy              = NULL;
     // callbacks
     io->read_cb    = NULL;
     io->write_cb   = NULL;
@@ -161,22 +200,45 @@ void wioReady(wio_t *io)
     io->heartbeat_timer    = NULL;
 
     // private:
-#if defined(EVENT_POLL) || defined(EVENT_KQUEUE)
+#if defined(EVENT_POLL) || defined(EVENT_KQUEUE) || defined(EVENT_IO_URING)
     io->event_index[0] = io->event_index[1] = -1;
 #endif
 #ifdef EVENT_IOCP
     io->hovlp = NULL;
 
 #endif
+}
+
+void wioReady(wio_t *io)
+{
+    if (io->ready)
+        return;
+    wioResetState(io);
 
     // io_type
     fillIoType(io);
     if (io->io_type & WIO_TYPE_SOCKET)
     {
         wioSocketInit(io);
+        wioApplyBusyPoll(io);
     }
 }
 
+void wioReadyAccepted(wio_t *io, const sockaddr_u *peeraddr)
+{
+    if (io->ready)
+        return;
+    wioResetState(io);
+
+    // NOTE: saves the SO_TYPE, fcntl and getpeername syscalls of wioReady, the listener already knows all of it
+    io->io_type = WIO_TYPE_TCP;
+    wioSocketAllocAddrs(io);
+    memoryCopy(io->peeraddr, peeraddr, sizeof(sockaddr_u));
+    socklen_t addrlen = sizeof(sockaddr_u);
+    getsockname(io->fd, io->localaddr, &addrlen);
+    wioApplyBusyPoll(io);
+}
+
 void wioDone(wio_t *io)
 {
     if (! io->ready)
@@ -196,6 +258,21 @@ void wioDone(wio_t *io)
     }
     write_queue_cleanup(&io->write_queue);
     io->write_queue.ptr = NULL;
+
+#ifdef EVENT_IO_URING
+    // received but never handed out, the recv itself was cancelled by wioDel
+    while (! read_queue_empty(&io->uring_rx_queue))
+    {
+        buf = *read_queue_front(&io->uring_rx_queue);
+        if (buf != NULL)
+        {
+            bufferpoolReuseBuffer(io->loop->bufpool, buf);
+        }
+        read_queue_pop_front(&io->uring_rx_queue);
+    }
+    read_queue_cleanup(&io->uring_rx_queue);
+    io->uring_rx_queue.ptr = NULL;
+#endif
 }
 
 void wioFree(wio_t *io)
@@ -204,9 +281,16 @@ void wioFree(wio_t *io)
         return;
     io->destroy = 1;
     wioClose(io);
-    EVENTLOOP_FREE(io->localaddr);
-    EVENTLOOP_FREE(io->peeraddr);
-    EVENTLOOP_FREE(io);
+    wio_block_t *block = (wio_block_t *) io;
+    if (io->localaddr != &block->localaddr.sa)
+    {
+        EVENTLOOP_FREE(io->localaddr);
+    }
+    if (io->peeraddr != &block->peeraddr.sa)
+    {
+        EVENTLOOP_FREE(io->peeraddr);
+    }
+    wslabFree(io->loop->io_slab, io);
 }
 
 bool wioIsOpened(wio_t *io)
@@ -542,7 +626,7 @@ void wioSetReadTimeout(wio_t *io, int timeout_ms)
     else
     {
         // add
-        io->read_timer           = wtimerAdd(io->loop, __read_timeout_cb, (uint32_t) timeout_ms, 1);
+        io->read_timer           = wtimerAddCoarse(io->loop, __read_timeout_cb, (uint32_t) timeout_ms, 1);
         io->read_timer->privdata = io;
     }
     io->read_timeout = timeout_ms;
@@ -587,7 +671,7 @@ void wiosSetWriteTimeout(wio_t *io, int timeout_ms)
     else
     {
         // add
-        io->write_timer           = wtimerAdd(io->loop, __write_timeout_cb, (uint32_t) timeout_ms, 1);
+        io->write_timer           = wtimerAddCoarse(io->loop, __write_timeout_cb, (uint32_t) timeout_ms, 1);
         io->write_timer->privdata = io;
     }
     io->write_timeout = timeout_ms;
@@ -633,7 +717,7 @@ void wioSetKeepaliveTimeout(wio_t *io, int timeout_ms)
     else
     {
         // add
-        io->keepalive_timer           = wtimerAdd(io->loop, __keepalive_timeout_cb, (uint32_t) timeout_ms, 1);
+        io->keepalive_timer           = wtimerAddCoarse(io->loop, __keepalive_timeout_cb, (uint32_t) timeout_ms, 1);
         io->keepalive_timer->privdata = io;
     }
     io->keepalive_timeout = timeout_ms;
@@ -665,7 +749,7 @@ void wioSetHeartBeat(wio_t *io, int interval_ms, wio_send_heartbeat_fn fn)
     else
     {
         // add
-        io->heartbeat_timer           = wtimerAdd(io->loop, __heartbeat_timer_cb, (uint32_t) interval_ms, INFINITE);
+        io->heartbeat_timer           = wtimerAddCoarse(io->loop, __heartbeat_timer_cb, (uint32_t) interval_ms, INFINITE);
         io->heartbeat_timer->privdata = io;
     }
     io->heartbeat_interval = interval_ms;
@@ -684,6 +768,109 @@ size_t wioGetWriteBufSize(wio_t *io)
     return io->write_bufsize;
 }
 
+double wioGetBuffersPerWriteCall(wio_t *io)
+{
+    if (io->write_syscalls == 0)
+    {
+        return 0;
+    }
+    return (double) io->write_syscall_buffers / (double) io->write_syscalls;
+}
+
+int wioEnableUdpGro(wio_t *io)
+{
+#ifdef WIO_UDP_OFFLOAD
+    int on = 1;
+    if (setsockopt(io->fd, SOL_UDP, UDP_GRO, (const char *) &on, sizeof(int)) == 0)
+    {
+        io->udp_gro = 1;
+        return 0;
+    }
+    wlogw("UDP_GRO not supported on fd=%d: %s", io->fd, socketStrError(socketERRNO()));
+#else
+    discard io;
+#endif
+    return -1;
+}
+
+int wioEnableUdpGso(wio_t *io)
+{
+#ifdef WIO_UDP_OFFLOAD
+    // NOTE: the segment size goes with every sendmsg, getsockopt only probes kernel support (4.18+)
+    int       size = 0;
+    socklen_t len  = sizeof(int);
+    if (getsockopt(io->fd, SOL_UDP, UDP_SEGMENT, (char *) &size, &len) == 0)
+    {
+        io->udp_gso = 1;
+        return 0;
+    }
+    wlogw("UDP_SEGMENT not supported on fd=%d: %s", io->fd, socketStrError(socketERRNO()));
+#else
+    discard io;
+#endif
+    return -1;
+}
+
+uint16_t wioGetUdpGroSegmentSize(wio_t *io)
+{
+    return io->gro_segment_size;
+}
+
+int wioEnableTcpZeroCopy(wio_t *io, uint32_t threshold)
+{
+#ifdef WIO_TCP_ZEROCOPY
+    int on = 1;
+    if (io->io_type == WIO_TYPE_TCP && setsockopt(io->fd, SOL_SOCKET, SO_ZEROCOPY, (const char *) &on, sizeof(int)) == 0)
+    {
+        if (io->zerocopy == NULL)
+        {
+            EVENTLOOP_ALLOC_SIZEOF(io->zerocopy);
+            io->zerocopy->fd = -1;
+            zerocopy_queue_init(&io->zerocopy->pending, 16);
+        }
+        io->zerocopy->threshold = threshold;
+        return 0;
+    }
+    // NOTE: the kernel answers the same for every socket, warn once and let the io send plainly
+    static atomic_bool unsupported_logged = false;
+    if (! atomic_exchange_explicit(&unsupported_logged, true, memory_order_relaxed))
+    {
+        wlogw("SO_ZEROCOPY not supported (fd=%d: %s), tcp ios fall back to plain sends", io->fd,
+              socketStrError(socketERRNO()));
+    }
+#else
+    discard io;
+    discard threshold;
+#endif
+    return -1;
+}
+
+void wioGetZeroCopyStats(wio_t *io, uint64_t *sends, uint64_t *copied)
+{
+    *sends  = io->zerocopy ? io->zerocopy->sends : 0;
+    *copied = io->zerocopy ? io->zerocopy->copied : 0;
+}
+
+int wioEnableTcpZeroCopyReceive(wio_t *io)
+{
+#ifdef WIO_TCP_ZEROCOPY_RECEIVE
+    if (io->io_type == WIO_TYPE_TCP)
+    {
+        io->zerocopy_rx = 1;
+        return 0;
+    }
+#else
+    discard io;
+#endif
+    return -1;
+}
+
+void wioGetZeroCopyReceiveStats(wio_t *io, uint64_t *mapped, uint64_t *copied)
+{
+    *mapped = io->zerocopy_rx_mapped;
+    *copied = io->zerocopy_rx_copied;
+}
+
 int wioReadOnce(wio_t *io)
 {
     io->read_flags |= WIO_READ_ONCE;
@@ -10,8 +10,10 @@
 #include "array.h"
 #include "list.h"
 #include "heap.h"
+#include "twheel.h"
 #include "queue.h"
 #include "buffer_pool.h"
+#include "wslab.h"
 
 
 // #define WLOOP_READ_BUFSIZE          (1U << 15)  // 32K
@@ -24,9 +26,85 @@
 #define WIO_READ_UNTIL_LENGTH   0x2
 #define WIO_READ_UNTIL_DELIM    0x4
 
+// batched udp io: recvmmsg on read, sendmmsg at the end of each loop iteration
+#if defined(OS_LINUX) && !defined(EVENT_IOCP)
+#define WIO_UDP_MMSG            1
+#endif
+#define UDP_RECV_BATCH          32 // upper limit, each io asks for about what its last recvmmsg returned
+#define UDP_SENDQ_SIZE          64
+
+// tcp write coalescing: small writes of one loop iteration stay in the write queue of their io and every such io is
+// flushed once when the iteration ends (one gathered send), an io flushes right away once it holds the max bytes
+#if !defined(EVENT_IOCP)
+#define WIO_TCP_COALESCE        1
+#endif
+#define TCP_COALESCE_MAX_BYTES  (1U << 16)  // 64K
+#define TCP_FLUSHQ_SIZE         256
+
+// connections accepted per readiness event of a listener (see wloopSetAcceptBudget); when the budget runs out while
+// the listen backlog is filling up, the budget grows with the backlog depth (linux, TCP_INFO) up to the max
+#define WIO_ACCEPT_BUDGET       16
+#define WIO_ACCEPT_BUDGET_MAX   1024
+
+// udp offloads (opt-in per io): GRO on read, UDP_SEGMENT (GSO) on the batched sendmmsg path
+#ifdef WIO_UDP_MMSG
+#define WIO_UDP_OFFLOAD         1
+#endif
+#define UDP_GRO_BUFFER_SIZE     65535
+#define UDP_GSO_MAX_SEGMENTS    64
+#define UDP_GSO_MAX_BYTES       65507
+
+// tcp zerocopy sends (opt-in per io): buffers are held until the kernel reports it is done with their pages,
+// an io that sees most of its sends copied anyway (loopback, no sg support) goes back to plain sends
+#if defined(OS_LINUX) && !defined(EVENT_IOCP)
+#define WIO_TCP_ZEROCOPY        1
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY             60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY            0x4000000
+#endif
+#endif
+#define ZEROCOPY_PROBE_SENDS    64      // completions seen before deciding whether zerocopy pays off
+#define ZEROCOPY_LINGER_MS      30000   // a closed io waits this long for the last completions
+#define ZEROCOPY_ABORT_GRACE_MS 1000    // then it is reset, and waits this long for the completions of the dropped data
+#define ZEROCOPY_REAP_MS        100
+
+// tcp zero-copy receive (opt-in per io): whole pages of payload are mapped from the socket instead of copied and
+// handed out as read only views (Mapped views in shiftbuffer.h), the bytes before the next page are copied
+#if defined(WIO_TCP_ZEROCOPY) && defined(TCP_ZEROCOPY_RECEIVE)
+#define WIO_TCP_ZEROCOPY_RECEIVE 1
+#endif
+#define ZEROCOPY_RECEIVE_WINDOW      (1U << 18)  // 256K window per io, reused by every mapping read
+#define ZEROCOPY_RECEIVE_PROBE_BYTES (1U << 22)  // 4M received before deciding whether mapping pays off
+
+// adaptive tcp reads: the receive buffer class follows an ewma of the read sizes of each io (weight 1/2^shift),
+// a read that fills its buffer is followed by more reads in the same event, up to the budget
+#define TCP_READ_EWMA_SHIFT     2
+#define TCP_READ_BUDGET         (1U << 18)  // 256K
+
+// adaptive busy polling: a miss halves the spin budget down to max/BUSY_POLL_MIN_SHIFT, a hit doubles it back
+#define BUSY_POLL_MIN_SHIFT     4
+
+// coarse timers (wtimerAddCoarse) live on a timing wheel with this resolution, they fire up to one tick late
+#define WTIMER_WHEEL_TICK_US    10000   // 10ms
+
 ARRAY_DECL(wio_t*, io_array)
 QUEUE_DECL(wevent_t, event_queue)
 
+// wloopPostEvent ring, one cell per posted event (Vyukov bounded mpmc, used with a single consumer)
+typedef struct post_cell_s {
+    atomic_size_t   seq;
+    wevent_t        ev;
+} post_cell_t;
+
+typedef struct udp_sendq_item_s {
+    wio_t*      io;
+    uint32_t    io_id;
+    sbuf_t*     buf;
+    sockaddr_u  peeraddr;
+} udp_sendq_item_t;
+
 struct wloop_s {
     uint32_t                    flags;
     wloop_status_e              status;
@@ -51,6 +129,7 @@ struct wloop_s {
     // timers
     struct heap                 timers;     // monotonic time
     struct heap                 realtimers; // realtime
+    struct twheel               timer_wheel; // coarse monotonic timers, WTIMER_WHEEL_TICK_US per tick
     uint32_t                    ntimers;
     // ios: with fd as array.index
     struct io_array             ios;
@@ -60,8 +139,43 @@ struct wloop_s {
     void*                       iowatcher;
     // custom_events
     int                         eventfds[2];
+    // posted events: lock-free ring, custom_events only takes what does not fit
+    post_cell_t*                post_ring;
+    atomic_size_t               post_tail;      // claimed by producers
+    size_t                      post_head;      // consumer only
+    atomic_bool                 post_overflow;  // custom_events holds events, producers must queue behind them
+    atomic_bool                 post_waiting;   // consumer is about to block, the next producer writes the eventfd
+    uint64_t                    post_wakeups;   // eventfd writes that woke this loop
     event_queue                 custom_events;
     wmutex_t                    custom_events_mutex;
+    // udp datagrams written during this iteration, see wloopFlushUdpWrites
+    udp_sendq_item_t*           udp_sendq;
+    udp_sendq_item_t*           udp_sendq_spare;
+    uint32_t                    udp_sendq_len;
+    // the batch wloopFlushUdpWrites is reporting, a closing io takes itself out of it
+    udp_sendq_item_t*           udp_flushing;
+    uint32_t                    udp_flushing_len;
+    // UDP_GRO_BUFFER_SIZE bytes, takes the part of a gro burst that does not fit a large buffer
+    uint8_t*                    udp_gro_spill;
+    // tcp ios holding coalesced writes of this iteration, see wloopFlushTcpWrites
+    wio_t**                     tcp_flushq;
+    uint32_t                    tcp_flushq_len;
+    // the batch wloopFlushTcpWrites is working through, a closing io takes itself out of it
+    wio_t**                     tcp_flushing;
+    uint32_t                    tcp_flushing_len;
+    // busy polling, see wloopSetBusyPoll
+    uint32_t                    busy_poll_max_us;   // configured spin budget, 0 = off
+    uint32_t                    busy_poll_us;       // current budget, shrinks while spinning finds nothing
+    uint64_t                    busy_poll_spins;    // iterations that spun before blocking
+    uint64_t                    busy_poll_hits;     // spins that found work, so the loop never slept
+    // connections accepted per listener event, see wloopSetAcceptBudget
+    uint32_t                    accept_budget;
+    // closed tcp ios whose zerocopy sends are still in flight
+    struct wio_zerocopy_s*      zerocopy_parked;
+    wtimer_t*                   zerocopy_reaper;
+    // object slabs, see wslab.h: wio_block_t, and timers + idles
+    wslab_t*                    io_slab;
+    wslab_t*                    event_slab;
 };
 
 uint64_t wloopGetNextEventID(void);
@@ -76,8 +190,12 @@ struct widle_s {
 #define WTIMER_FIELDS                   \
     WEVENT_FIELDS                       \
     uint32_t    repeat;                 \
+    uint32_t    coarse;                 \
     uint64_t    next_timeout;           \
-    struct heap_node node;
+    union {                             \
+        struct heap_node node;          \
+        struct twheel_node wheel_node;  \
+    };
 
 struct wtimer_s {
     WTIMER_FIELDS
@@ -99,6 +217,42 @@ struct hperiod_s {
 
 QUEUE_DECL(sbuf_t*, write_queue)
 
+#ifdef EVENT_IO_URING
+QUEUE_DECL(sbuf_t*, read_queue)
+
+// tcp reads of the io_uring backend (io_uring.c), off = readiness based like every other backend
+#define IO_URING_RX_OFF     0
+#define IO_URING_RX_IDLE    1   // completion based, no recv request in flight
+#define IO_URING_RX_ARMED   2   // completion based, a multishot recv is in flight
+#define IO_URING_RX_ENDED   3   // completion based, eof or an error was queued, nothing is read anymore
+#endif
+
+typedef struct zerocopy_pending_s {
+    sbuf_t*     buf;
+    uint32_t    seq;    // the last zerocopy send that read from buf
+} zerocopy_pending_t;
+
+QUEUE_DECL(zerocopy_pending_t, zerocopy_queue)
+
+// MSG_ZEROCOPY state of a tcp io, see wioEnableTcpZeroCopy
+// only the buffer at the front of the write queue is ever sent with MSG_ZEROCOPY, once it leaves the queue it
+// waits in pending until the completion of its last send arrives on the socket error queue
+typedef struct wio_zerocopy_s {
+    struct wio_zerocopy_s*  next;           // parked list of the loop, after the io closed
+    int                     fd;             // parked only: a dup of the socket, completions are read from it
+    uint64_t                parked_ms;
+    uint32_t                threshold;      // buffers at least this long are sent with MSG_ZEROCOPY
+    uint32_t                next_seq;       // id the kernel gives to the next zerocopy send
+    uint32_t                done_seq;       // every send before this id has completed
+    uint32_t                front_seq;      // last zerocopy send of the front buffer, valid if front_pinned
+    bool                    front_pinned;
+    bool                    aborted;        // parked only: linger ran out and the connection was reset
+    zerocopy_queue          pending;
+    uint64_t                sends;          // sendmsg calls with MSG_ZEROCOPY
+    uint64_t                completions;
+    uint64_t                copied;         // completions where the kernel fell back to copying
+} wio_zerocopy_t;
+
 // sizeof(struct wio_s)=416 on linux-x64
 struct wio_s {
     WEVENT_FIELDS
@@ -114,6 +268,10 @@ struct wio_s {
     unsigned    recvfrom    :1;
     unsigned    sendto      :1;
     unsigned    close       :1;
+    unsigned    udp_gro     :1;
+    unsigned    udp_gso     :1;
+    unsigned    zerocopy_rx :1;
+    unsigned    write_coalesced :1; // queued writes wait for the end of the iteration
 // public:
     wio_type_e  io_type;
     uint32_t    id; // fd cannot be used as unique identifier, so we provide an id
@@ -139,11 +297,21 @@ struct wio_s {
     uint64_t            last_write_hrtime;
     // read
     unsigned int        read_flags;
+    uint16_t            gro_segment_size; // segment size of the buffer being delivered, 0 when gro is off
+    uint8_t             udp_recv_batch;   // udp: datagrams (buffers) the next recvmmsg asks for
+    uint32_t            read_size_hint;   // tcp: ewma of recent read sizes, picks the receive buffer class
+    uint32_t            zerocopy_rx_skip;   // bytes to copy before the kernel can map again
+    uint64_t            zerocopy_rx_mapped; // bytes received as mapped views
+    uint64_t            zerocopy_rx_copied; // bytes copied while zero-copy receive was on
+    sbuf_mapping_t*     zerocopy_rx_window; // window the views are mapped into, NULL until the first one
     // write
     struct write_queue  write_queue;
     // wrecursive_mutex_t  write_mutex; // lock write and write_queue
     uint32_t            write_bufsize;
     uint32_t            max_write_bufsize;
+    uint64_t            write_syscalls;        // number of write/send/writev calls that succeeded
+    uint64_t            write_syscall_buffers; // number of queued buffers those calls carried
+    wio_zerocopy_t*     zerocopy;              // NULL unless wioEnableTcpZeroCopy
     // callbacks
     wread_cb    read_cb;
     wwrite_cb   write_cb;
@@ -166,8 +334,15 @@ struct wio_s {
     wtimer_t*   heartbeat_timer;
 
 // private:
-#if defined(EVENT_POLL) || defined(EVENT_KQUEUE)
-    int         event_index[2]; // for poll,kqueue
+#if defined(EVENT_POLL) || defined(EVENT_KQUEUE) || defined(EVENT_IO_URING)
+    int         event_index[2]; // for poll,kqueue,io_uring
+#endif
+#ifdef EVENT_IO_URING
+    struct read_queue uring_rx_queue; // buffers the multishot recv filled, NULL marks the end of the stream
+    int         uring_rx_error;       // error that ended the stream, set on the io once NULL is reached
+    uint8_t     uring_rx_state;       // IO_URING_RX_*
+    uint8_t     uring_rx_gen;         // generation of the recv in flight, older completions can not end it
+    uint8_t     uring_rx_inflight;    // recv requests the kernel has not ended yet, cancelled ones included
 #endif
 
 #ifdef EVENT_IOCP
@@ -175,20 +350,31 @@ struct wio_s {
 #endif
 
 };
+
+// one io_slab object: the wio and the addresses it would otherwise allocate on its first socket init
+typedef struct wio_block_s {
+    wio_t       io;
+    sockaddr_u  localaddr;
+    sockaddr_u  peeraddr;
+} wio_block_t;
+
 /*
  * wio lifeline:
  *
  * fd =>
- * wioGet => EVENTLOOP_ALLOC_SIZEOF(io) => wioInit => wioReady
+ * wioGet => wslabAlloc(loop->io_slab) => wioInit => wioReady
  *
  * wioRead  => wioAdd(WW_READ) => wioReadCallBack
  * wioWrite => wioAdd(WW_WRITE) => wioWriteCallBack
  * wioClose => wioDone => wioDel(WW_RDWR) => wioCloseCallBack
  *
- * wloopStop => wloopDestroy => wioFree => EVENTLOOP_FREE(io)
+ * wloopStop => wloopDestroy => wioFree => wslabFree(loop->io_slab, io)
  */
 void wioInit(wio_t* io);
 void wioReady(wio_t* io);
+// wioReady for a tcp socket fresh out of accept4: non-blocking already and the peer is known
+void wioReadyAccepted(wio_t* io, const sockaddr_u* peeraddr);
+wio_t* wioGetAccepted(wloop_t* loop, int fd, const sockaddr_u* peeraddr);
 void wioDone(wio_t* io);
 void wioFree(wio_t* io);
 uint32_t wioSetNextID(void);
@@ -200,6 +386,18 @@ void wioReadCallBack(wio_t* io, sbuf_t* buf);
 void wioWriteCallBack(wio_t* io);
 void wioCloseCallBack(wio_t* io);
 
+#ifdef WIO_TCP_COALESCE
+void wloopFlushTcpWrites(wloop_t* loop);
+#endif
+#ifdef WIO_UDP_MMSG
+void wloopFlushUdpWrites(wloop_t* loop);
+#endif
+void wioApplyBusyPoll(wio_t* io);
+
+#ifdef WIO_TCP_ZEROCOPY
+void wloopDropZeroCopyParked(wloop_t* loop);
+#endif
+
 void wioDelConnectTimer(wio_t* io);
 void wioDelCloseTimer(wio_t* io);
 void wioDelReadTimer(wio_t* io);
@@ -212,6 +410,7 @@ void wioDelHeartBeatTimer(wio_t* io);
 #define EVENT_ENTRY(p)          container_of(p, wevent_t, pending_node)
 #define IDLE_ENTRY(p)           container_of(p, widle_t,  node)
 #define TIMER_ENTRY(p)          container_of(p, wtimer_t, node)
+#define WHEEL_TIMER_ENTRY(p)    container_of(p, wtimer_t, wheel_node.link)
 
 #define EVENT_ACTIVE(ev) \
     if (!ev->active) {\
@@ -248,7 +447,7 @@ void wioDelHeartBeatTimer(wio_t* io);
     do {\
         EVENT_INACTIVE(ev);\
         if (!ev->pending) {\
-            EVENTLOOP_FREE(ev);\
+            wslabFree(ev->loop->event_slab, ev);\
         }\
     } while(0)
 
@@ -22,6 +22,7 @@
 
 #define IO_ARRAY_INIT_SIZE           1024
 #define CUSTOM_EVENT_QUEUE_INIT_SIZE 16
+#define POST_RING_SIZE               1024 // power of 2
 
 #define EVENTFDS_READ_INDEX  0
 #define EVENTFDS_WRITE_INDEX 1
@@ -107,18 +108,89 @@ static int __wloop_process_timers(struct heap *timers, uint64_t timeout)
     return ntimers;
 }
 
+static uint64_t wheelTickOf(uint64_t hrtime_us)
+{
+    // NOTE: round up, a coarse timer may fire late but never early
+    return (hrtime_us + WTIMER_WHEEL_TICK_US - 1) / WTIMER_WHEEL_TICK_US;
+}
+
+static void wheelTimerInsert(wloop_t *loop, wtimer_t *timer)
+{
+    twheel_settle(&loop->timer_wheel, loop->cur_hrtime / WTIMER_WHEEL_TICK_US);
+    timer->wheel_node.expire = wheelTickOf(timer->next_timeout);
+    twheel_insert(&loop->timer_wheel, &timer->wheel_node);
+}
+
+static int __wloop_process_wheel_timers(wloop_t *loop)
+{
+    struct twheel   *wheel = &loop->timer_wheel;
+    struct list_head expired;
+    list_init(&expired);
+    twheel_advance(wheel, loop->cur_hrtime / WTIMER_WHEEL_TICK_US, &expired);
+
+    int ntimers = 0;
+    while (! list_empty(&expired))
+    {
+        wtimer_t *timer = WHEEL_TIMER_ENTRY(expired.next);
+        if (timer->repeat != INFINITE)
+        {
+            --timer->repeat;
+        }
+        if (timer->repeat == 0)
+        {
+            // NOTE: Just mark it as destroy and remove from wheel.
+            // Real deletion occurs after wloopProcessPendings.
+            __wtimer_del(timer);
+        }
+        else
+        {
+            twheel_remove(wheel, &timer->wheel_node);
+            while (timer->next_timeout <= loop->cur_hrtime)
+            {
+                timer->next_timeout += (uint64_t) ((htimeout_t *) timer)->timeout * 1000;
+            }
+            wheelTimerInsert(loop, timer);
+        }
+        EVENT_PENDING(timer);
+        ++ntimers;
+    }
+    return ntimers;
+}
+
 static int wloopProcessTimers(wloop_t *loop)
 {
     uint64_t now     = wloopNowUS(loop);
     int      ntimers = __wloop_process_timers(&loop->timers, loop->cur_hrtime);
     ntimers += __wloop_process_timers(&loop->realtimers, now);
+    if (loop->timer_wheel.nelts)
+    {
+        ntimers += __wloop_process_wheel_timers(loop);
+    }
     return ntimers;
 }
 
+static bool wloopHasPostedEvents(wloop_t *loop)
+{
+    post_cell_t *cell = &loop->post_ring[loop->post_head & (POST_RING_SIZE - 1)];
+    return atomicLoadExplicit(&cell->seq, memory_order_acquire) == loop->post_head + 1 ||
+           atomicLoadExplicit(&loop->post_overflow, memory_order_acquire);
+}
+
 static int wloopProcessIOS(wloop_t *loop, int timeout)
 {
+    if (timeout != 0)
+    {
+        // NOTE: announce the sleep before the last look at the queue, pairs with the fence in wloopPostEvent
+        atomicStoreExplicit(&loop->post_waiting, true, memory_order_relaxed);
+        atomicThreadFence(memory_order_seq_cst);
+        if (wloopHasPostedEvents(loop))
+        {
+            timeout = 0;
+        }
+    }
     // That is to call IO multiplexing function such as select, poll, epoll, etc.
     int nevents = iowatcherPollEvents(loop, timeout);
+    atomicStoreExplicit(&loop->post_waiting, false, memory_order_relaxed);
     if (nevents < 0)
     {
         wlogd("poll_events error=%d", -nevents);
@@ -126,6 +198,85 @@ static int wloopProcessIOS(wloop_t *loop, int timeout)
     return nevents < 0 ? 0 : nevents;
 }
 
+// spins on a zero timeout poll for the current budget, then falls back to a blocking wait
+static int wloopBusyPollIOS(wloop_t *loop, int32_t blocktime_ms)
+{
+    uint64_t budget_us = min((uint64_t) loop->busy_poll_us, (uint64_t) blocktime_ms * 1000);
+    uint64_t start     = getHRTimeUs();
+    uint64_t elapsed   = 0;
+    ++loop->busy_poll_spins;
+    do
+    {
+        int nevents = iowatcherPollEvents(loop, 0);
+        if (nevents > 0 || loop->npendings > 0 || wloopHasPostedEvents(loop))
+        {
+            ++loop->busy_poll_hits;
+            loop->busy_poll_us = min(loop->busy_poll_us * 2, loop->busy_poll_max_us);
+            return nevents < 0 ? 0 : nevents;
+        }
+        YIELD_CPU();
+        elapsed = getHRTimeUs() - start;
+    } while (elapsed < budget_us);
+
+    loop->busy_poll_us = max(loop->busy_poll_us / 2, loop->busy_poll_max_us >> BUSY_POLL_MIN_SHIFT);
+    if (loop->busy_poll_us == 0)
+    {
+        loop->busy_poll_us = 1;
+    }
+    int32_t remain_ms = blocktime_ms - (int32_t) (elapsed / 1000);
+    return wloopProcessIOS(loop, remain_ms > 0 ? remain_ms : 0);
+}
+
+static int wloopProcessPostedEvents(wloop_t *loop)
+{
+    wevent_t ev;
+    int      ncbs = 0;
+
+    // NOTE: bounded, so producers that never stop can not starve the rest of the loop
+    while (ncbs < POST_RING_SIZE)
+    {
+        post_cell_t *cell = &loop->post_ring[loop->post_head & (POST_RING_SIZE - 1)];
+        if (atomicLoadExplicit(&cell->seq, memory_order_acquire) != loop->post_head + 1)
+        {
+            break;
+        }
+        ev = cell->ev;
+        atomicStoreExplicit(&cell->seq, loop->post_head + POST_RING_SIZE, memory_order_release);
+        loop->post_head++;
+        if (ev.cb)
+        {
+            ev.cb(&ev);
+        }
+        ++ncbs;
+    }
+    if (ncbs == POST_RING_SIZE || ! atomicLoadExplicit(&loop->post_overflow, memory_order_acquire))
+    {
+        return ncbs;
+    }
+
+    // NOTE: the ring is drained, so everything spilled here was posted after it
+    for (;;)
+    {
+        mutexLock(&loop->custom_events_mutex);
+        if (event_queue_empty(&loop->custom_events))
+        {
+            atomicStoreExplicit(&loop->post_overflow, false, memory_order_release);
+            mutexUnlock(&loop->custom_events_mutex);
+            break;
+        }
+        ev = *event_queue_front(&loop->custom_events);
+        event_queue_pop_front(&loop->custom_events);
+        // NOTE: unlock before cb, avoid deadlock if wloopPostEvent called in cb.
+        mutexUnlock(&loop->custom_events_mutex);
+        if (ev.cb)
+        {
+            ev.cb(&ev);
+        }
+        ++ncbs;
+    }
+    return ncbs;
+}
+
 static int wloopProcessPendings(wloop_t *loop)
 {
     if (loop->npendings == 0)
@@ -193,15 +344,34 @@ int wloopProcessEvents(wloop_t *loop, int timeout_ms)
             uint64_t min_timeout = TIMER_ENTRY(loop->realtimers.root)->next_timeout - wloopNowUS(loop);
             blocktime_us         = min(blocktime_us, (int64_t) min_timeout);
         }
+        if (loop->timer_wheel.nelts)
+        {
+            uint64_t min_timeout = twheel_next_tick(&loop->timer_wheel) * WTIMER_WHEEL_TICK_US - loop->cur_hrtime;
+            blocktime_us         = min(blocktime_us, (int64_t) min_timeout);
+        }
         if (blocktime_us < 0)
             goto process_timers;
         blocktime_ms = (int32_t) ((blocktime_us / 1000) + 1);
         blocktime_ms = min(blocktime_ms, timeout_ms);
     }
 
+#ifdef WIO_TCP_COALESCE
+    // NOTE: writes coalesced outside of an iteration (before wloopRun, ...) must not wait for an unrelated event
+    if (loop->tcp_flushq_len)
+    {
+        blocktime_ms = 0;
+    }
+#endif
     if (loop->nios)
     {
-        nios = wloopProcessIOS(loop, blocktime_ms);
+        if (loop->busy_poll_max_us > 0 && blocktime_ms > 0)
+        {
+            nios = wloopBusyPollIOS(loop, blocktime_ms);
+        }
+        else
+        {
+            nios = wloopProcessIOS(loop, blocktime_ms);
+        }
     }
     else
     {
@@ -229,6 +399,19 @@ process_timers:
         }
     }
     int ncbs = wloopProcessPendings(loop);
+    ncbs += wloopProcessPostedEvents(loop);
+#ifdef WIO_UDP_MMSG
+    if (loop->udp_sendq_len)
+    {
+        wloopFlushUdpWrites(loop);
+    }
+#endif
+#ifdef WIO_TCP_COALESCE
+    if (loop->tcp_flushq_len)
+    {
+        wloopFlushTcpWrites(loop);
+    }
+#endif
     printd("blocktime=%d nios=%d/%u ntimers=%d/%u nidles=%d/%u nactives=%d npendings=%d ncbs=%d\n", blocktime, nios,
            loop->nios, ntimers, loop->ntimers, nidles, loop->nidles, loop->nactives, npendings, ncbs);
     discard nios;
@@ -239,47 +422,28 @@ static void wloopStatTimerCallBack(wtimer_t *timer)
 {
     wloop_t *loop = timer->loop;
     // wlog_set_level(LOG_LEVEL_DEBUG);
-    wlogd("[Eventloop] worker=%ld pid=%ld uptime=%lluus cnt=%llu nactives=%u nios=%u ntimers=%u nidles=%u", loop->wid,
-          loop->pid, (unsigned long long) loop->cur_hrtime - loop->start_hrtime, (unsigned long long) loop->loop_cnt,
-          loop->nactives, loop->nios, loop->ntimers, loop->nidles);
+    // NOTE: slab stats are in use/free/chunks of objects of the given size, in use counts those lent to other loops
+    wlogd("[Eventloop] worker=%ld pid=%ld uptime=%lluus cnt=%llu nactives=%u nios=%u ntimers=%u nidles=%u "
+          "post_wakeups=%llu busy_poll=%uus/%uus hits=%llu/%llu io_slab=%u/%u/%u*%uB event_slab=%u/%u/%u*%uB",
+          loop->wid, loop->pid, (unsigned long long) loop->cur_hrtime - loop->start_hrtime,
+          (unsigned long long) loop->loop_cnt, loop->nactives, loop->nios, loop->ntimers, loop->nidles,
+          (unsigned long long) loop->post_wakeups, loop->busy_poll_us, loop->busy_poll_max_us,
+          (unsigned long long) loop->busy_poll_hits, (unsigned long long) loop->busy_poll_spins,
+          wslabGetInUseCount(loop->io_slab), wslabGetFreeCount(loop->io_slab), wslabGetChunksCount(loop->io_slab),
+          wslabGetObjectSize(loop->io_slab), wslabGetInUseCount(loop->event_slab),
+          wslabGetFreeCount(loop->event_slab), wslabGetChunksCount(loop->event_slab),
+          wslabGetObjectSize(loop->event_slab));
 }
 
 static void eventFDReadCB(wio_t *io, sbuf_t *buf)
 {
-    wloop_t  *loop = io->loop;
-    wevent_t *pev  = NULL;
-    wevent_t  ev;
-    uint64_t  count = sbufGetLength(buf);
+    // NOTE: the wakeup itself is all we need, wloopProcessEvents drains the posted events
+    uint64_t count = sbufGetLength(buf);
 #if defined(OS_UNIX) && HAVE_EVENTFD
     assert(sbufGetLength(buf) == sizeof(count));
     sbufReadUnAlignedUI64(buf, &count);
 #endif
-    discard count;
-    for (uint64_t i = 0; i < count; ++i)
-    {
-        mutexLock(&loop->custom_events_mutex);
-        if (event_queue_empty(&loop->custom_events))
-        {
-            goto unlock;
-        }
-        pev = event_queue_front(&loop->custom_events);
-        if (pev == NULL)
-        {
-            goto unlock;
-        }
-        ev = *pev;
-        event_queue_pop_front(&loop->custom_events);
-        // NOTE: unlock before cb, avoid deadlock if wloopPostEvent called in cb.
-        mutexUnlock(&loop->custom_events_mutex);
-        if (ev.cb)
-        {
-            ev.cb(&ev);
-        }
-    }
-    bufferpoolReuseBuffer(io->loop->bufpool, buf);
-    return;
-unlock:
-    mutexUnlock(&loop->custom_events_mutex);
+    io->loop->post_wakeups += count;
     bufferpoolReuseBuffer(io->loop->bufpool, buf);
 }
 
@@ -328,6 +492,36 @@ static void wloopDestroyEventFDS(wloop_t *loop)
     loop->eventfds[0] = loop->eventfds[1] = -1;
 }
 
+static bool wloopPostRingPush(wloop_t *loop, const wevent_t *ev)
+{
+    size_t pos = atomicLoadExplicit(&loop->post_tail, memory_order_relaxed);
+    for (;;)
+    {
+        post_cell_t *cell = &loop->post_ring[pos & (POST_RING_SIZE - 1)];
+        size_t       seq  = atomicLoadExplicit(&cell->seq, memory_order_acquire);
+        intptr_t     diff = (intptr_t) seq - (intptr_t) pos;
+        if (diff == 0)
+        {
+            if (atomicCompareExchangeExplicit(&loop->post_tail, &pos, pos + 1, memory_order_relaxed,
+                                              memory_order_relaxed))
+            {
+                cell->ev = *ev;
+                atomicStoreExplicit(&cell->seq, pos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // full
+            return false;
+        }
+        else
+        {
+            pos = atomicLoadExplicit(&loop->post_tail, memory_order_relaxed);
+        }
+    }
+}
+
 bool wloopPostEvent(wloop_t *loop, wevent_t *ev)
 {
     if (atomicLoadExplicit(&GSTATE.application_stopping_flag, memory_order_acquire))
@@ -348,15 +542,40 @@ bool wloopPostEvent(wloop_t *loop, wevent_t *ev)
         ev->event_id = wloopGetNextEventID();
     }
 
-    int nwrite = 0;
-    mutexLock(&loop->custom_events_mutex);
     if (loop->eventfds[EVENTFDS_WRITE_INDEX] == -1)
     {
-        if (wloopCreateEventFDS(loop) != 0)
+        mutexLock(&loop->custom_events_mutex);
+        if (loop->eventfds[EVENTFDS_WRITE_INDEX] == -1 && wloopCreateEventFDS(loop) != 0)
+        {
+            mutexUnlock(&loop->custom_events_mutex);
+            return true;
+        }
+        mutexUnlock(&loop->custom_events_mutex);
+    }
+
+    // NOTE: once something spilled to custom_events, the ring is closed until the consumer empties it,
+    // otherwise a producer could see its later events overtake the earlier ones
+    if (atomicLoadExplicit(&loop->post_overflow, memory_order_acquire) || ! wloopPostRingPush(loop, ev))
+    {
+        mutexLock(&loop->custom_events_mutex);
+        if (loop->custom_events.maxsize == 0)
         {
-            goto unlock;
+            event_queue_init(&loop->custom_events, CUSTOM_EVENT_QUEUE_INIT_SIZE);
         }
+        event_queue_push_back(&loop->custom_events, ev);
+        atomicStoreExplicit(&loop->post_overflow, true, memory_order_release);
+        mutexUnlock(&loop->custom_events_mutex);
+    }
+
+    // NOTE: a loop that is awake drains the queue on its own, only a sleeping one needs the eventfd
+    atomicThreadFence(memory_order_seq_cst);
+    if (! atomicLoadExplicit(&loop->post_waiting, memory_order_relaxed) ||
+        ! atomicExchangeExplicit(&loop->post_waiting, false, memory_order_relaxed))
+    {
+        return true;
     }
+
+    int nwrite = 0;
 #if defined(OS_UNIX) && HAVE_EVENTFD
     uint64_t count = 1;
     nwrite         = (int) write(loop->eventfds[EVENTFDS_WRITE_INDEX], &count, sizeof(count));
@@ -368,15 +587,7 @@ bool wloopPostEvent(wloop_t *loop, wevent_t *ev)
     if (nwrite <= 0)
     {
         wloge("wloopPostEvent failed!");
-        goto unlock;
-    }
-    if (loop->custom_events.maxsize == 0)
-    {
-        event_queue_init(&loop->custom_events, CUSTOM_EVENT_QUEUE_INIT_SIZE);
     }
-    event_queue_push_back(&loop->custom_events, ev);
-unlock:
-    mutexUnlock(&loop->custom_events_mutex);
     return true;
 }
 
@@ -400,6 +611,8 @@ static void wloopInit(wloop_t *loop)
     // timers
     heap_init(&loop->timers, timersCompare);
     heap_init(&loop->realtimers, timersCompare);
+    // NOTE: wheel time is synced with cur_hrtime by wheelTimerInsert
+    twheel_init(&loop->timer_wheel, 0);
 
     // ios
     // NOTE: io_array_init when wioGet -> io_array_resize
@@ -412,6 +625,17 @@ static void wloopInit(wloop_t *loop)
     mutexInit(&loop->custom_events_mutex);
     // NOTE: wloopCreateEventFDS when wloopPostEvent or wloopRun
     loop->eventfds[0] = loop->eventfds[1] = -1;
+    EVENTLOOP_ALLOC(loop->post_ring, sizeof(post_cell_t) * POST_RING_SIZE);
+    for (size_t i = 0; i < POST_RING_SIZE; ++i)
+    {
+        atomicStoreExplicit(&loop->post_ring[i].seq, i, memory_order_relaxed);
+    }
+    atomicStoreExplicit(&loop->post_tail, 0, memory_order_relaxed);
+    atomicStoreExplicit(&loop->post_overflow, false, memory_order_relaxed);
+    atomicStoreExplicit(&loop->post_waiting, false, memory_order_relaxed);
+    loop->post_head = 0;
+
+    loop->accept_budget = WIO_ACCEPT_BUDGET;
 
     // NOTE: init start_time here, because wtimerAdd use it.
     loop->start_ms     = getTimeOfDayMS();
@@ -447,7 +671,7 @@ static void wloopCleanup(wloop_t *loop)
     {
         idle = IDLE_ENTRY(node);
         node = node->next;
-        EVENTLOOP_FREE(idle);
+        wslabFree(loop->event_slab, idle);
     }
     list_init(&loop->idles);
 
@@ -458,16 +682,40 @@ static void wloopCleanup(wloop_t *loop)
     {
         timer = TIMER_ENTRY(loop->timers.root);
         heap_dequeue(&loop->timers);
-        EVENTLOOP_FREE(timer);
+        wslabFree(loop->event_slab, timer);
     }
     heap_init(&loop->timers, NULL);
     while (loop->realtimers.root)
     {
         timer = TIMER_ENTRY(loop->realtimers.root);
         heap_dequeue(&loop->realtimers);
-        EVENTLOOP_FREE(timer);
+        wslabFree(loop->event_slab, timer);
     }
     heap_init(&loop->realtimers, NULL);
+    struct twheel_node *wheel_node;
+    while ((wheel_node = twheel_any(&loop->timer_wheel)) != NULL)
+    {
+        timer = WHEEL_TIMER_ENTRY(&wheel_node->link);
+        twheel_remove(&loop->timer_wheel, wheel_node);
+        wslabFree(loop->event_slab, timer);
+    }
+
+    // udp_sendq
+    for (uint32_t i = 0; i < loop->udp_sendq_len; ++i)
+    {
+        bufferpoolReuseBuffer(loop->bufpool, loop->udp_sendq[i].buf);
+    }
+    loop->udp_sendq_len = 0;
+    EVENTLOOP_FREE(loop->udp_sendq);
+    EVENTLOOP_FREE(loop->udp_sendq_spare);
+    EVENTLOOP_FREE(loop->udp_gro_spill);
+    // tcp_flushq, the coalesced buffers themselves sit in the write queues of the ios
+    loop->tcp_flushq_len = 0;
+    EVENTLOOP_FREE(loop->tcp_flushq);
+
+#ifdef WIO_TCP_ZEROCOPY
+    wloopDropZeroCopyParked(loop);
+#endif
 
     // iowatcher
     iowatcherCleanUp(loop);
@@ -478,6 +726,20 @@ static void wloopCleanup(wloop_t *loop)
     event_queue_cleanup(&loop->custom_events);
     mutexUnlock(&loop->custom_events_mutex);
     mutexDestroy(&loop->custom_events_mutex);
+    EVENTLOOP_FREE(loop->post_ring);
+
+    // slabs, objects that moved to other loops keep theirs alive
+    wslabRelease(loop->io_slab);
+    wslabRelease(loop->event_slab);
+}
+
+static void wloopCreateSlabs(wloop_t *loop)
+{
+    const bool bypass = (loop->flags & WLOOP_FLAG_NO_SLAB) != 0;
+    loop->io_slab     = wslabCreate(sizeof(wio_block_t), bypass);
+    // NOTE: timers and idles share one slab, sized for the largest of them
+    loop->event_slab =
+        wslabCreate((uint32_t) max(max(sizeof(htimeout_t), sizeof(hperiod_t)), sizeof(widle_t)), bypass);
 }
 
 wloop_t *wloopCreate(int flags, buffer_pool_t *swimmingpool, long wid)
@@ -488,6 +750,7 @@ wloop_t *wloopCreate(int flags, buffer_pool_t *swimmingpool, long wid)
     loop->flags |= (uint32_t) flags;
     loop->bufpool = swimmingpool;
     loop->wid     = wid;
+    wloopCreateSlabs(loop);
     // wlogd("wloopCreate tid=%ld", loop->tid);
     return loop;
 }
@@ -701,6 +964,26 @@ long wloopGetWID(wloop_t *loop)
     return loop->wid;
 }
 
+void wloopSetBusyPoll(wloop_t *loop, uint32_t budget_us)
+{
+    loop->busy_poll_max_us = budget_us;
+    loop->busy_poll_us     = budget_us;
+}
+
+void wloopSetAcceptBudget(wloop_t *loop, uint32_t budget)
+{
+    loop->accept_budget = min(max(budget, (uint32_t) 1), (uint32_t) WIO_ACCEPT_BUDGET_MAX);
+}
+
+double wloopGetBusyPollHitRatio(wloop_t *loop)
+{
+    if (loop->busy_poll_spins == 0)
+    {
+        return 0;
+    }
+    return (double) loop->busy_poll_hits / (double) loop->busy_poll_spins;
+}
+
 void wloopSetUserData(wloop_t *loop, void *userdata)
 {
     loop->userdata = userdata;
@@ -713,8 +996,7 @@ void *wloopGetUserData(wloop_t *loop)
 
 widle_t *widleAdd(wloop_t *loop, widle_cb cb, uint32_t repeat)
 {
-    widle_t *idle;
-    EVENTLOOP_ALLOC_SIZEOF(idle);
+    widle_t *idle    = wslabAlloc(loop->event_slab);
     idle->event_type = WEVENT_TYPE_IDLE;
     idle->priority   = WEVENT_LOWEST_PRIORITY;
     idle->repeat     = repeat;
@@ -745,8 +1027,7 @@ wtimer_t *wtimerAdd(wloop_t *loop, wtimer_cb cb, uint32_t timeout_ms, uint32_t r
 {
     if (timeout_ms == 0)
         return NULL;
-    htimeout_t *timer;
-    EVENTLOOP_ALLOC_SIZEOF(timer);
+    htimeout_t *timer = wslabAlloc(loop->event_slab);
     timer->event_type = WEVENT_TYPE_TIMEOUT;
     timer->priority   = WEVENT_HIGHEST_PRIORITY;
     timer->repeat     = repeat;
@@ -764,6 +1045,24 @@ wtimer_t *wtimerAdd(wloop_t *loop, wtimer_cb cb, uint32_t timeout_ms, uint32_t r
     return (wtimer_t *) timer;
 }
 
+wtimer_t *wtimerAddCoarse(wloop_t *loop, wtimer_cb cb, uint32_t timeout_ms, uint32_t repeat)
+{
+    if (timeout_ms == 0)
+        return NULL;
+    htimeout_t *timer = wslabAlloc(loop->event_slab);
+    timer->event_type = WEVENT_TYPE_TIMEOUT;
+    timer->priority   = WEVENT_HIGHEST_PRIORITY;
+    timer->repeat     = repeat;
+    timer->coarse     = 1;
+    timer->timeout    = timeout_ms;
+    wloopUpdateTime(loop);
+    timer->next_timeout = loop->cur_hrtime + (uint64_t) timeout_ms * 1000;
+    wheelTimerInsert(loop, (wtimer_t *) timer);
+    EVENT_ADD(loop, timer, cb);
+    loop->ntimers++;
+    return (wtimer_t *) timer;
+}
+
 void wtimerReset(wtimer_t *timer, uint32_t timeout_ms)
 {
     if (timer->event_type != WEVENT_TYPE_TIMEOUT)
@@ -776,6 +1075,10 @@ void wtimerReset(wtimer_t *timer, uint32_t timeout_ms)
     {
         loop->ntimers++;
     }
+    else if (timer->coarse)
+    {
+        twheel_remove(&loop->timer_wheel, &timer->wheel_node);
+    }
     else
     {
         heap_remove(&loop->timers, &timer->node);
@@ -789,6 +1092,12 @@ void wtimerReset(wtimer_t *timer, uint32_t timeout_ms)
         timeout->timeout = timeout_ms;
     }
     timer->next_timeout = loop->cur_hrtime + (uint64_t) timeout->timeout * 1000;
+    if (timer->coarse)
+    {
+        wheelTimerInsert(loop, timer);
+        EVENT_RESET(timer);
+        return;
+    }
     // NOTE: Limit granularity to 100ms
     if (timeout->timeout >= 1000 && timeout->timeout % 100 == 0)
     {
@@ -805,8 +1114,7 @@ wtimer_t *wtimerAddPeriod(wloop_t *loop, wtimer_cb cb, int8_t minute, int8_t hou
     {
         return NULL;
     }
-    hperiod_t *timer;
-    EVENTLOOP_ALLOC_SIZEOF(timer);
+    hperiod_t *timer    = wslabAlloc(loop->event_slab);
     timer->event_type   = WEVENT_TYPE_PERIOD;
     timer->priority     = WEVENT_HIGH_PRIORITY;
     timer->repeat       = repeat;
@@ -826,7 +1134,11 @@ static void __wtimer_del(wtimer_t *timer)
 {
     if (timer->destroy)
         return;
-    if (timer->event_type == WEVENT_TYPE_TIMEOUT)
+    if (timer->coarse)
+    {
+        twheel_remove(&timer->loop->timer_wheel, &timer->wheel_node);
+    }
+    else if (timer->event_type == WEVENT_TYPE_TIMEOUT)
     {
         heap_remove(&timer->loop->timers, &timer->node);
     }
@@ -854,6 +1166,8 @@ const char *wioGetEngine(void)
     return "poll";
 #elif defined(EVENT_EPOLL)
     return "epoll";
+#elif defined(EVENT_IO_URING)
+    return "io_uring";
 #elif defined(EVENT_KQUEUE)
     return "kqueue";
 #elif defined(EVENT_IOCP)
@@ -876,12 +1190,15 @@ static inline wio_t *__wio_get(wloop_t *loop, int fd)
     return loop->ios.ptr[fd];
 }
 
-wio_t *wioGet(wloop_t *loop, int fd)
+static wio_t *__wio_get_or_alloc(wloop_t *loop, int fd)
 {
     wio_t *io = __wio_get(loop, fd);
     if (io == NULL)
     {
-        EVENTLOOP_ALLOC_SIZEOF(io);
+        wio_block_t *block = wslabAlloc(loop->io_slab);
+        io                 = &block->io;
+        io->localaddr      = &block->localaddr.sa;
+        io->peeraddr       = &block->peeraddr.sa;
         wioInit(io);
         io->event_type    = WEVENT_TYPE_IO;
         io->loop          = loop;
@@ -889,7 +1206,12 @@ wio_t *wioGet(wloop_t *loop, int fd)
         loop->ios.ptr[fd] = io;
     }
     io->fd = fd;
+    return io;
+}
 
+wio_t *wioGet(wloop_t *loop, int fd)
+{
+    wio_t *io = __wio_get_or_alloc(loop, fd);
     if (! io->ready)
     {
         wioReady(io);
@@ -898,11 +1220,30 @@ wio_t *wioGet(wloop_t *loop, int fd)
     return io;
 }
 
+wio_t *wioGetAccepted(wloop_t *loop, int fd, const sockaddr_u *peeraddr)
+{
+    wio_t *io = __wio_get_or_alloc(loop, fd);
+    if (! io->ready)
+    {
+        wioReadyAccepted(io, peeraddr);
+    }
+
+    return io;
+}
+
+
 void wioDetach(wio_t *io)
 {
     assert(io->fd >= 0);
     assert((io->events & WW_READ) != WW_READ);
     assert((io->events & WW_WRITE) != WW_WRITE);
+#ifdef EVENT_IO_URING
+    // NOTE: a recv left on this loop's ring would fill its buffers and look the io up here after it moved
+    if (io->uring_rx_state != IO_URING_RX_OFF)
+    {
+        iowatcherDetachIo(io->loop, io);
+    }
+#endif
 
     wloop_t *loop = io->loop;
     int      fd   = io->fd;
@@ -922,6 +1263,11 @@ void wioAttach(wloop_t *loop, wio_t *io)
     }
 
     int fd = io->fd;
+    if (io->loop == loop && __wio_get(loop, fd) == io)
+    {
+        // never left this loop (the socket manager keeps sockets it hands to its own worker attached)
+        return;
+    }
     // NOTE: wio was not freed for reused when closed, but attached wio can't be reused,
     // so we need to free it if fd exists to avoid memory leak.
     wio_t *preio = __wio_get(loop, fd);
@@ -933,6 +1279,7 @@ void wioAttach(wloop_t *loop, wio_t *io)
 
     io->loop          = loop;
     loop->ios.ptr[fd] = io;
+    wioApplyBusyPoll(io);
 }
 
 bool wioExists(wloop_t *loop, int fd)
@@ -1123,7 +1470,8 @@ wio_t *wSendTo(wloop_t *loop, int sockfd, sbuf_t *buf, wwrite_cb write_cb)
 }
 
 //-----------------top-level apis---------------------------------------------
-wio_t *wioCreateSocket(wloop_t *loop, const char *host, int port, wio_type_e type, wio_side_e side)
+static wio_t *createSocket(wloop_t *loop, const char *host, int port, wio_type_e type, wio_side_e side,
+                           bool reuse_port)
 {
     int sock_type = (type & WIO_TYPE_SOCK_STREAM)  ? SOCK_STREAM
                     : (type & WIO_TYPE_SOCK_DGRAM) ? SOCK_DGRAM
@@ -1161,7 +1509,14 @@ wio_t *wioCreateSocket(wloop_t *loop, const char *host, int port, wio_type_e typ
     {
 #ifdef OS_UNIX
         socketOptionReuseAddr(sockfd, 1);
-        // so_reuseport(sockfd, 1);
+        if (reuse_port && socketOptionReusePort(sockfd, 1) != 0)
+        {
+            printError("syscall return error , call: setsockopt SO_REUSEPORT , value: %d\n", -1);
+            closesocket(sockfd);
+            return NULL;
+        }
+#else
+        discard reuse_port;
 #endif
         if (addr.sa.sa_family == AF_INET6)
         {
@@ -1198,6 +1553,11 @@ wio_t *wioCreateSocket(wloop_t *loop, const char *host, int port, wio_type_e typ
     return io;
 }
 
+wio_t *wioCreateSocket(wloop_t *loop, const char *host, int port, wio_type_e type, wio_side_e side)
+{
+    return createSocket(loop, host, port, type, side, false);
+}
+
 wio_t *wloopCreateTcpServer(wloop_t *loop, const char *host, int port, waccept_cb accept_cb)
 {
     wio_t *io = wioCreateSocket(loop, host, port, WIO_TYPE_TCP, WIO_SERVER_SIDE);
@@ -1209,6 +1569,17 @@ wio_t *wloopCreateTcpServer(wloop_t *loop, const char *host, int port, waccept_c
     return io;
 }
 
+wio_t *wloopCreateTcpServerReusePort(wloop_t *loop, const char *host, int port, waccept_cb accept_cb)
+{
+    wio_t *io = createSocket(loop, host, port, WIO_TYPE_TCP, WIO_SERVER_SIDE, true);
+    if (io == NULL)
+        return NULL;
+    wioSetCallBackAccept(io, accept_cb);
+    if (wioAccept(io) != 0)
+        return NULL;
+    return io;
+}
+
 wio_t *wloopCreateTcpClient(wloop_t *loop, const char *host, int port, wconnect_cb connect_cb, wclose_cb close_cb)
 {
     wio_t *io = wioCreateSocket(loop, host, port, WIO_TYPE_TCP, WIO_CLIENT_SIDE);
@@ -1226,6 +1597,11 @@ wio_t *wloopCreateUdpServer(wloop_t *loop, const char *host, int port)
     return wioCreateSocket(loop, host, port, WIO_TYPE_UDP, WIO_SERVER_SIDE);
 }
 
+wio_t *wloopCreateUdpServerReusePort(wloop_t *loop, const char *host, int port)
+{
+    return createSocket(loop, host, port, WIO_TYPE_UDP, WIO_SERVER_SIDE, true);
+}
+
 wio_t *wloopCreateUdpClient(wloop_t *loop, const char *host, int port)
 {
     return wioCreateSocket(loop, host, port, WIO_TYPE_UDP, WIO_CLIENT_SIDE);
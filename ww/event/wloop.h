@@ -124,6 +124,8 @@ typedef enum {
 #define WLOOP_FLAG_RUN_ONCE 0x00000001
 #define WLOOP_FLAG_AUTO_FREE 0x00000002
 #define WLOOP_FLAG_QUIT_WHEN_NO_ACTIVE_EVENTS 0x00000004
+// NOTE: ios, timers and idles come straight from the allocator instead of the loop slabs, see wslab.h
+#define WLOOP_FLAG_NO_SLAB 0x00000008
 WW_EXPORT wloop_t* wloopCreate(int flags DEFAULT(WLOOP_FLAG_AUTO_FREE),buffer_pool_t* swimmingpool, long wid);
 
 // WARN: Forbid to call wloopDestroy if WLOOP_FLAG_AUTO_FREE set.
@@ -170,6 +172,17 @@ WW_EXPORT buffer_pool_t* wloopGetBufferPool(wloop_t* loop);
 // @return the loop thread id
 WW_EXPORT long wloopGetWID(wloop_t* loop);
 
+// busy polling: spin up to budget_us on a zero timeout poll before blocking, 0 turns it off.
+// sockets of this loop also get SO_BUSY_POLL where supported.
+// NOTE: burns cpu while idle, meant for latency critical workers.
+WW_EXPORT void wloopSetBusyPoll(wloop_t* loop, uint32_t budget_us);
+// @return spins that found work / spins, 0 if busy polling never ran
+WW_EXPORT double wloopGetBusyPollHitRatio(wloop_t* loop);
+
+// connections a listener of this loop accepts per readiness event before other ios get their turn (default
+// WIO_ACCEPT_BUDGET); on linux a listen backlog that is filling up is drained beyond it, up to WIO_ACCEPT_BUDGET_MAX
+WW_EXPORT void wloopSetAcceptBudget(wloop_t* loop, uint32_t budget);
+
 // userdata
 WW_EXPORT void wloopSetUserData(wloop_t* loop, void* userdata);
 WW_EXPORT void* wloopGetUserData(wloop_t* loop);
@@ -192,6 +205,9 @@ WW_EXPORT void widleDelete(widle_t* idle);
 
 // timer
 WW_EXPORT wtimer_t* wtimerAdd(wloop_t* loop, wtimer_cb cb, uint32_t timeout_ms, uint32_t repeat DEFAULT(INFINITE));
+// same as wtimerAdd but O(1) to add, reset and delete, fires within 10ms after the timeout.
+// NOTE: meant for connection timeouts that are reset on every read/write and rarely fire.
+WW_EXPORT wtimer_t* wtimerAddCoarse(wloop_t* loop, wtimer_cb cb, uint32_t timeout_ms, uint32_t repeat DEFAULT(INFINITE));
 /*
  * minute   hour    day     week    month       cb
  * 0~59     0~23    1~31    0~6     1~12
@@ -293,6 +309,32 @@ WW_EXPORT void wioSetMaxWriteBufSize(wio_t* io, uint32_t size);
 WW_EXPORT size_t wioGetWriteBufSize(wio_t* io);
 #define wioCheckWriteComplete(io) (wioGetWriteBufSize(io) == 0)
 
+// NOTE: queued buffers are gathered into a single writev/sendmsg when the socket becomes writable.
+// @return average number of buffers carried by each successful write syscall of this io.
+WW_EXPORT double wioGetBuffersPerWriteCall(wio_t* io);
+
+// udp offloads (linux only), return 0 on success or -1 if the kernel does not support it
+// @wioEnableUdpGro: one read may deliver many same-sized datagrams back to back, see wioGetUdpGroSegmentSize
+WW_EXPORT int wioEnableUdpGro(wio_t* io);
+// @wioEnableUdpGso: queued datagrams of equal size to the same peer leave as one UDP_SEGMENT send
+WW_EXPORT int wioEnableUdpGso(wio_t* io);
+// size of each datagram in the buffer given to the read callback (the last one may be shorter), 0 if the buffer
+// holds a single datagram. a burst bigger than a large buffer comes in several reads cut at datagram boundaries
+WW_EXPORT uint16_t wioGetUdpGroSegmentSize(wio_t* io);
+
+// tcp zerocopy (linux 4.14+), returns 0 on success or -1 if the kernel does not support it
+// @wioEnableTcpZeroCopy: writes of at least threshold bytes are sent with MSG_ZEROCOPY, their buffers go back to
+// the pool once the kernel is done with them
+WW_EXPORT int wioEnableTcpZeroCopy(wio_t* io, uint32_t threshold);
+// zerocopy sends of this io so far and how many of them the kernel copied anyway
+WW_EXPORT void wioGetZeroCopyStats(wio_t* io, uint64_t* sends, uint64_t* copied);
+// @wioEnableTcpZeroCopyReceive: reads map whole pages of payload instead of copying them, the read callback gets
+// read only views for those (see Mapped views in shiftbuffer.h), only for ios whose data is forwarded untouched;
+// there is one view out at a time, reads copy while the last one is still queued
+WW_EXPORT int wioEnableTcpZeroCopyReceive(wio_t* io);
+// bytes this io received as mapped views and bytes it had to copy since zero-copy receive was enabled
+WW_EXPORT void wioGetZeroCopyReceiveStats(wio_t* io, uint64_t* mapped, uint64_t* copied);
+
 WW_EXPORT uint64_t wioGetLastReadTime(wio_t* io);  // ms
 WW_EXPORT uint64_t wioGetLastWriteTime(wio_t* io); // ms
 
@@ -357,6 +399,8 @@ WW_EXPORT int wioReadRemain(wio_t* io);
 
 // NOTE: wioWrite is thread-safe, locked by recursive_mutex, allow to be called by other threads.
 // wio_try_write => wioAdd(io, WW_WRITE) => write => wwrite_cb
+// tcp: small writes are coalesced until the end of the loop iteration and count as written (the full length is
+// returned), they stay in the write queue until then so wioCheckWriteComplete is false; see TCP_COALESCE_MAX_BYTES
 WW_EXPORT int wioWrite(wio_t* io, sbuf_t* buf);
 
 // NOTE: wioClose is thread-safe, wioCloseAsync will be called actually in other thread.
@@ -404,6 +448,10 @@ WW_EXPORT wio_t* wioCreateSocket(wloop_t* loop, const char* host, int port, wio_
 // @see examples/tcp_echo_server.c
 WW_EXPORT wio_t* wloopCreateTcpServer(wloop_t* loop, const char* host, int port, waccept_cb accept_cb);
 
+// @tcp_server with SO_REUSEPORT set before bind, every loop can own a listener on the same address
+// and the kernel spreads new connections between them.
+WW_EXPORT wio_t* wloopCreateTcpServerReusePort(wloop_t* loop, const char* host, int port, waccept_cb accept_cb);
+
 // @tcp_client: wioCreateSocket(loop, host, port, WIO_TYPE_TCP, WIO_CLIENT_SIDE) -> wioSetCallBackConnect -> wioSetCallBackClose -> wioConnect
 // @see examples/nc.c
 WW_EXPORT wio_t* wloopCreateTcpClient(wloop_t* loop, const char* host, int port, wconnect_cb connect_cb, wclose_cb close_cb);
@@ -412,6 +460,9 @@ WW_EXPORT wio_t* wloopCreateTcpClient(wloop_t* loop, const char* host, int port,
 // @see examples/udp_echo_server.c
 WW_EXPORT wio_t* wloopCreateUdpServer(wloop_t* loop, const char* host, int port);
 
+// @udp_server with SO_REUSEPORT set before bind, the kernel hashes each 4-tuple to one socket of the group
+WW_EXPORT wio_t* wloopCreateUdpServerReusePort(wloop_t* loop, const char* host, int port);
+
 // @udp_server: wioCreateSocket(loop, host, port, WIO_TYPE_UDP, WIO_CLIENT_SIDE)
 // @see examples/nc.c
 WW_EXPORT wio_t* wloopCreateUdpClient(wloop_t* loop, const char* host, int port);
@@ -0,0 +1,189 @@
+#include "wslab.h"
+#include "ev_memory.h"
+#include "watomic.h"
+
+typedef union wslab_header_u {
+    struct
+    {
+        union wslab_header_u *next;
+        wslab_t              *slab; // NULL when the object came from eventloopZalloc
+    };
+    max_align_t align; // keeps the object after the header aligned
+
+} wslab_header_t;
+
+typedef struct wslab_chunk_s
+{
+    struct wslab_chunk_s *next;
+    max_align_t           align;
+
+} wslab_chunk_t;
+
+struct wslab_s
+{
+    uint32_t        object_size;
+    uint32_t        stride; // header + object, rounded to the header alignment
+    bool            bypass;
+    wslab_header_t *free_list;
+    uint32_t        nfree;
+    wslab_chunk_t  *chunks;
+    uint32_t        nchunks;
+    uint8_t        *carve;      // untouched tail of the newest chunk
+    uint32_t        carve_left; // objects left in it
+    // live objects + 1 for the owning loop
+    atomic_size_t refs;
+    _Atomic(wslab_header_t *) remote_frees;
+};
+
+wslab_t *wslabCreate(uint32_t object_size, bool bypass)
+{
+    wslab_t *slab;
+    EVENTLOOP_ALLOC_SIZEOF(slab);
+    slab->object_size = object_size;
+    slab->stride      = (uint32_t) sizeof(wslab_header_t) *
+                   (1 + (object_size + (uint32_t) sizeof(wslab_header_t) - 1) / (uint32_t) sizeof(wslab_header_t));
+    slab->bypass      = bypass;
+    atomicStoreExplicit(&slab->refs, 1, memory_order_relaxed);
+    atomicStoreExplicit(&slab->remote_frees, NULL, memory_order_relaxed);
+    return slab;
+}
+
+static void wslabDestroy(wslab_t *slab)
+{
+    wslab_chunk_t *chunk = slab->chunks;
+    while (chunk)
+    {
+        wslab_chunk_t *next = chunk->next;
+        EVENTLOOP_FREE(chunk);
+        chunk = next;
+    }
+    EVENTLOOP_FREE(slab);
+}
+
+static void wslabUnref(wslab_t *slab)
+{
+    if (atomicSubExplicit(&slab->refs, 1, memory_order_acq_rel) == 1)
+    {
+        wslabDestroy(slab);
+    }
+}
+
+void wslabRelease(wslab_t *slab)
+{
+    wslabUnref(slab);
+}
+
+static void wslabTakeRemoteFrees(wslab_t *slab)
+{
+    wslab_header_t *header = atomic_exchange_explicit(&slab->remote_frees, NULL, memory_order_acquire);
+    while (header)
+    {
+        wslab_header_t *next = header->next;
+        header->next         = slab->free_list;
+        slab->free_list      = header;
+        slab->nfree++;
+        header = next;
+    }
+}
+
+static wslab_header_t *wslabCarve(wslab_t *slab)
+{
+    if (slab->carve_left == 0)
+    {
+        wslab_chunk_t *chunk;
+        EVENTLOOP_ALLOC(chunk, sizeof(wslab_chunk_t) + (size_t) slab->stride * WSLAB_CHUNK_OBJECTS);
+        chunk->next      = slab->chunks;
+        slab->chunks     = chunk;
+        slab->carve      = (uint8_t *) (chunk + 1);
+        slab->carve_left = WSLAB_CHUNK_OBJECTS;
+        slab->nchunks++;
+    }
+    wslab_header_t *header = (wslab_header_t *) slab->carve;
+    slab->carve += slab->stride;
+    slab->carve_left--;
+    return header;
+}
+
+void *wslabAlloc(wslab_t *slab)
+{
+    wslab_header_t *header;
+    if (slab->bypass)
+    {
+        EVENTLOOP_ALLOC(header, slab->stride);
+        header->slab = NULL;
+        return header + 1;
+    }
+
+    if (slab->free_list == NULL && atomicLoadExplicit(&slab->remote_frees, memory_order_relaxed) != NULL)
+    {
+        wslabTakeRemoteFrees(slab);
+    }
+    if (slab->free_list)
+    {
+        header          = slab->free_list;
+        slab->free_list = header->next;
+        slab->nfree--;
+        memorySet(header + 1, 0, slab->object_size);
+    }
+    else
+    {
+        // NOTE: chunks come zeroed from eventloopZalloc
+        header = wslabCarve(slab);
+    }
+    header->slab = slab;
+    atomicAddExplicit(&slab->refs, 1, memory_order_relaxed);
+    return header + 1;
+}
+
+void wslabFree(wslab_t *local, void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    wslab_header_t *header = ((wslab_header_t *) ptr) - 1;
+    wslab_t        *slab   = header->slab;
+    if (slab == NULL)
+    {
+        EVENTLOOP_FREE(header);
+        return;
+    }
+
+    if (slab == local)
+    {
+        header->next    = slab->free_list;
+        slab->free_list = header;
+        slab->nfree++;
+    }
+    else
+    {
+        // only the owner pops, and it takes the whole stack at once, so this push has no aba problem
+        wslab_header_t *head = atomicLoadExplicit(&slab->remote_frees, memory_order_relaxed);
+        do
+        {
+            header->next = head;
+        } while (! atomic_compare_exchange_weak_explicit(&slab->remote_frees, &head, header, memory_order_release,
+                                                         memory_order_relaxed));
+    }
+    wslabUnref(slab);
+}
+
+uint32_t wslabGetObjectSize(wslab_t *slab)
+{
+    return slab->object_size;
+}
+
+uint32_t wslabGetChunksCount(wslab_t *slab)
+{
+    return slab->nchunks;
+}
+
+uint32_t wslabGetInUseCount(wslab_t *slab)
+{
+    return (uint32_t) (atomicLoadExplicit(&slab->refs, memory_order_relaxed) - 1);
+}
+
+uint32_t wslabGetFreeCount(wslab_t *slab)
+{
+    return slab->nfree;
+}
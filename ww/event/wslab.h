@@ -0,0 +1,37 @@
+#ifndef WW_SLAB_H_
+#define WW_SLAB_H_
+
+#include "wlibc.h"
+
+/*
+ * Fixed size object slab of one loop, backs the wio_t and timer/idle objects of the event layer.
+ *
+ * Objects are carved out of chunks of WSLAB_CHUNK_OBJECTS and recycled through a free list, chunks are only
+ * returned when the slab is released. Each object carries a header naming its slab, so an object may be freed
+ * by another loop (accepted ios are allocated by the accepting loop and freed by the worker that adopted them):
+ * such frees are pushed to a lock-free stack that the owner takes on its next allocation.
+ *
+ * The slab is reference counted by its live objects, a released slab stays around until the last object that
+ * left its loop comes back.
+ */
+
+#define WSLAB_CHUNK_OBJECTS 64
+
+typedef struct wslab_s wslab_t;
+
+// bypass: every object comes from eventloopZalloc, for comparing against the plain allocator
+WW_EXPORT wslab_t *wslabCreate(uint32_t object_size, bool bypass);
+// drops the owner reference, objects still out keep the chunks alive
+WW_EXPORT void wslabRelease(wslab_t *slab);
+
+// returns a zeroed object
+WW_EXPORT void *wslabAlloc(wslab_t *slab);
+// local: the slab of the calling loop for this kind of object
+WW_EXPORT void wslabFree(wslab_t *local, void *ptr);
+
+WW_EXPORT uint32_t wslabGetObjectSize(wslab_t *slab);
+WW_EXPORT uint32_t wslabGetChunksCount(wslab_t *slab);
+WW_EXPORT uint32_t wslabGetInUseCount(wslab_t *slab);
+WW_EXPORT uint32_t wslabGetFreeCount(wslab_t *slab);
+
+#endif // WW_SLAB_H_
@@ -62,11 +62,13 @@ static void destroyWorkerMessage(master_pool_t *pool, master_pool_item_t *item,
 
 static void initializeMasterPools(void)
 {
-    GSTATE.masterpool_buffer_pools_large   = masterpoolCreateWithCapacity(2 * RAM_PROFILE);
-    GSTATE.masterpool_buffer_pools_small   = masterpoolCreateWithCapacity(2 * RAM_PROFILE);
+    // NOTE: buffers and messages keep migrating between workers, their pools are hit the most
+    GSTATE.masterpool_buffer_pools_large   = masterpoolCreateWithCapacityLockFree(2 * RAM_PROFILE);
+    GSTATE.masterpool_buffer_pools_small   = masterpoolCreateWithCapacityLockFree(2 * RAM_PROFILE);
+    GSTATE.masterpool_buffer_pools_medium  = masterpoolCreateWithCapacityLockFree(2 * RAM_PROFILE);
     GSTATE.masterpool_context_pools        = masterpoolCreateWithCapacity(2 * RAM_PROFILE);
-    GSTATE.masterpool_pipetunnel_msg_pools = masterpoolCreateWithCapacity(2 * RAM_PROFILE);
-    GSTATE.masterpool_messages             = masterpoolCreateWithCapacity(2 * RAM_PROFILE);
+    GSTATE.masterpool_pipetunnel_msg_pools = masterpoolCreateWithCapacityLockFree(2 * RAM_PROFILE);
+    GSTATE.masterpool_messages             = masterpoolCreateWithCapacityLockFree(2 * RAM_PROFILE);
 
     masterpoolInstallCallBacks(GSTATE.masterpool_messages, allocWorkerMessage, destroyWorkerMessage);
 }
@@ -243,8 +245,10 @@ void createGlobalState(const ww_construction_data_t init_data)
     // workers and pools creation
     {
         WORKERS_COUNT         = init_data.workers_count;
-        GSTATE.ram_profile    = init_data.ram_profile;
-        GSTATE.distribute_wid = 0;
+        GSTATE.ram_profile        = init_data.ram_profile;
+        GSTATE.pool_purge_idle_ms = init_data.pool_purge_idle_ms;
+        GSTATE.buffer_arena_mb    = init_data.buffer_arena_mb;
+        GSTATE.distribute_wid     = 0;
 
         // this check was required to avoid overflow in older version when workers_count was limited to 254
         if (WORKERS_COUNT <= 0 || WORKERS_COUNT > (254))
@@ -261,6 +265,15 @@ void createGlobalState(const ww_construction_data_t init_data)
         for (wid_t i = 0; i < getWorkersCount() - WORKER_ADDITIONS; ++i)
         {
             workerInit(getWorker(i), i, true);
+            if (init_data.busy_poll_us != NULL && i < init_data.workers_count && init_data.busy_poll_us[i] > 0)
+            {
+                wloopSetBusyPoll(getWorker(i)->loop, init_data.busy_poll_us[i]);
+                LOGD("Worker %d busy polls for up to %u us before blocking", i, init_data.busy_poll_us[i]);
+            }
+            if (init_data.accept_budget > 0)
+            {
+                wloopSetAcceptBudget(getWorker(i)->loop, init_data.accept_budget);
+            }
         }
 
         // WORKER_ADDITIONS 1 : lwip worker dose not have event loop
@@ -430,6 +443,7 @@ WW_EXPORT void destroyGlobalState(void)
 
     masterpoolDestroy(GSTATE.masterpool_buffer_pools_large);
     masterpoolDestroy(GSTATE.masterpool_buffer_pools_small);
+    masterpoolDestroy(GSTATE.masterpool_buffer_pools_medium);
     masterpoolDestroy(GSTATE.masterpool_context_pools);
     masterpoolDestroy(GSTATE.masterpool_pipetunnel_msg_pools);
 
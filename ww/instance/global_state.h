@@ -34,6 +34,7 @@ typedef struct ww_global_state_s
     generic_pool_t           **shortcut_pipetunnel_msg_pools;
     master_pool_t             *masterpool_buffer_pools_large;
     master_pool_t             *masterpool_buffer_pools_small;
+    master_pool_t             *masterpool_buffer_pools_medium;
     master_pool_t             *masterpool_context_pools;
     master_pool_t             *masterpool_pipetunnel_msg_pools;
     master_pool_t             *masterpool_messages;
@@ -51,6 +52,9 @@ typedef struct ww_global_state_s
     void                      *windivert_dll_handle;
     uint32_t                   workers_count;
     uint32_t                   ram_profile;
+    uint32_t                   pool_purge_idle_ms;
+    uint32_t                   buffer_arena_mb;
+    atomic_uint                pool_purge_epoch; // bumped when idle master pools were emptied
     uint64_t                   main_thread_id;
     wid_t                      lwip_wid;
     atomic_wid_t               distribute_wid;
@@ -73,6 +77,10 @@ typedef struct
     unsigned int               workers_count;
     enum ram_profiles_e        ram_profile;
     uint16_t                   mtu_size;
+    const uint32_t            *busy_poll_us; // one entry per worker, NULL = no busy polling
+    uint32_t                   pool_purge_idle_ms; // 0 = pooled memory is never given back to the os
+    uint32_t                   buffer_arena_mb;    // 0 = large buffers come from the heap
+    uint32_t                   accept_budget;      // connections per listener event, 0 = event loop default
     logger_construction_data_t internal_logger_data;
     logger_construction_data_t core_logger_data;
     logger_construction_data_t network_logger_data;
@@ -12,6 +12,12 @@
 
 thread_local wid_t tl_wid;
 
+enum
+{
+    kPoolsAdaptIntervalMs = 1000,
+    kArenaReportTicks     = 60
+};
+
 void workerFinish(worker_t *worker)
 {
     if (worker->tid == getTID())
@@ -72,6 +78,16 @@ void workerInit(worker_t *worker, wid_t wid, bool eventloop)
     worker->buffer_pool = bufferpoolCreate(GSTATE.masterpool_buffer_pools_large, GSTATE.masterpool_buffer_pools_small,
                                            RAM_PROFILE, PROPER_LARGE_BUFFER_SIZE(RAM_PROFILE), SMALL_BUFFER_SIZE);
 
+    if (MEDIUM_BUFFER_SIZE < PROPER_LARGE_BUFFER_SIZE(RAM_PROFILE))
+    {
+        bufferpoolEnableMediumBuffers(worker->buffer_pool, GSTATE.masterpool_buffer_pools_medium, MEDIUM_BUFFER_SIZE);
+    }
+
+    if (GSTATE.buffer_arena_mb > 0)
+    {
+        bufferpoolEnableSlabArena(worker->buffer_pool, (size_t) GSTATE.buffer_arena_mb * 1024 * 1024);
+    }
+
     if (eventloop)
     {
         // note that loop depeneds on worker->buffer_pool
@@ -83,6 +99,63 @@ void workerInit(worker_t *worker, wid_t wid, bool eventloop)
     }
 }
 
+/**
+ * Empties the global master pools that went idle, only worker 0 does this so each pool has a single purger.
+ * Per worker pools are passed as userdata, the destroy handles only need one of the same kind.
+ */
+static void purgeIdleMasterPools(worker_t *worker, uint64_t now_ms)
+{
+    const uint32_t idle_ms = GSTATE.pool_purge_idle_ms;
+    bool           purged  = false;
+
+    purged |= masterpoolPurgeIfIdle(GSTATE.masterpool_buffer_pools_large, now_ms, idle_ms, worker->buffer_pool);
+    purged |= masterpoolPurgeIfIdle(GSTATE.masterpool_buffer_pools_small, now_ms, idle_ms, worker->buffer_pool);
+    purged |= masterpoolPurgeIfIdle(GSTATE.masterpool_buffer_pools_medium, now_ms, idle_ms, worker->buffer_pool);
+    purged |= masterpoolPurgeIfIdle(GSTATE.masterpool_context_pools, now_ms, idle_ms, worker->context_pool);
+    purged |= masterpoolPurgeIfIdle(GSTATE.masterpool_pipetunnel_msg_pools, now_ms, idle_ms,
+                                    worker->pipetunnel_msg_pool);
+    purged |= masterpoolPurgeIfIdle(GSTATE.masterpool_messages, now_ms, idle_ms, NULL);
+
+    if (purged)
+    {
+        LOGD("Worker %d: master pools were idle for %u ms, released their items", worker->wid, idle_ms);
+        atomicAddExplicit(&GSTATE.pool_purge_epoch, 1, memory_order_release);
+    }
+}
+
+static void onPoolsAdaptTimer(wtimer_t *timer)
+{
+    worker_t *worker = weventGetUserdata(timer);
+
+    bufferpoolAdaptToDemand(worker->buffer_pool);
+
+    sbuf_arena_stats_t arena_stats;
+    if (++worker->pools_adapt_ticks % kArenaReportTicks == 0 &&
+        bufferpoolGetSlabArenaStats(worker->buffer_pool, &arena_stats))
+    {
+        LOGD("Worker %d: buffer arena %u/%u slots used, %u/%u chunks, numa node %d, %s", worker->wid,
+             arena_stats.slots_used, arena_stats.slots_total, arena_stats.chunks, arena_stats.chunks_max,
+             arena_stats.numa_node, arena_stats.hugepages ? "hugetlb pages" : "transparent hugepages");
+    }
+
+    if (GSTATE.pool_purge_idle_ms == 0)
+    {
+        return;
+    }
+    if (worker->wid == 0)
+    {
+        purgeIdleMasterPools(worker, wloopNowMS(weventGetLoop(timer)));
+    }
+
+    // NOTE: the allocator keeps freed pages per thread, every worker has to collect its own
+    const uint32_t epoch = atomicLoadExplicit(&GSTATE.pool_purge_epoch, memory_order_acquire);
+    if (epoch != worker->pool_purge_epoch)
+    {
+        worker->pool_purge_epoch = epoch;
+        memoryReleaseUnused();
+    }
+}
+
 void workerRun(worker_t *worker)
 {
     tl_wid    = worker->wid;
@@ -100,6 +173,9 @@ void workerRun(worker_t *worker)
         wwSleepMS(10);
     }
 
+    wtimer_t *adapt_timer = wtimerAdd(worker->loop, onPoolsAdaptTimer, kPoolsAdaptIntervalMs, INFINITE);
+    weventSetUserData(adapt_timer, worker);
+
     wloopRun(worker->loop);
 
     if (worker->context_pool)
@@ -20,6 +20,8 @@ typedef struct worker_s
     generic_pool_t *pipetunnel_msg_pool; // Generic pool for managing pipe tunnel messages.
     wthread_t       thread;              // Thread associated with the worker.
     tid_t           tid;                 // Os Thread Id
+    uint32_t        pool_purge_epoch;    // Last GSTATE purge this worker released its own memory for.
+    uint32_t        pools_adapt_ticks;   // Runs of the pools adapt timer.
     wid_t           wid;                 // Worker ID.
 
 } worker_t;
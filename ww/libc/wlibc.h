@@ -30,6 +30,7 @@ void *memoryAllocate(size_t size);
 void *memoryAllocateZero(size_t size);
 void *memoryReAllocate(void *ptr, size_t size);
 void  memoryFree(void *ptr);
+void  memoryReleaseUnused(void); // return freed memory of the calling thread to the os
 
 void *memoryDedicatedAllocate(dedicated_memory_t *dm, size_t size);
 void *memoryDedicatedReallocate(dedicated_memory_t *dm, void *ptr, size_t size);
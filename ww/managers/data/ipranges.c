@@ -0,0 +1,30 @@
+#include "ipranges.h"
+#include "wlibc.h"
+
+typedef struct iprange_set_entry_s
+{
+    const char   *name;
+    const char  **ranges;
+    unsigned int *length;
+} iprange_set_entry_t;
+
+static const iprange_set_entry_t kIpRangeSets[] = {
+    {"iran", iran_ip_ranges, &iran_ip_ranges_length},
+    {"mci", mci_ip_ranges, &mci_ip_ranges_length},
+    {"irancell", irancell_ip_ranges, &irancell_ip_ranges_length},
+    {"rightel", rightel_ip_ranges, &rightel_ip_ranges_length},
+    {"mokhaberat", mokhaberat_ip_ranges, &mokhaberat_ip_ranges_length},
+};
+
+const char **iprangesFindByName(const char *name, unsigned int *length)
+{
+    for (unsigned int i = 0; i < ARRAY_SIZE(kIpRangeSets); i++)
+    {
+        if (stringCompare(kIpRangeSets[i].name, name) == 0)
+        {
+            *length = *kIpRangeSets[i].length;
+            return kIpRangeSets[i].ranges;
+        }
+    }
+    return NULL;
+}
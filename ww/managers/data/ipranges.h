@@ -14,3 +14,6 @@ extern unsigned int mokhaberat_ip_ranges_length;
 
 extern const char  *iran_ip_ranges[];
 extern unsigned int iran_ip_ranges_length;
+
+// bundled range set by name ("iran", "mci", "irancell", "rightel", "mokhaberat"), NULL if there is no such set
+const char **iprangesFindByName(const char *name, unsigned int *length);
@@ -3,6 +3,9 @@
 #include "wmutex.h"
 
 #include <assert.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -69,6 +72,12 @@ void memoryFree(void *ptr)
     mi_free(ptr);
 }
 
+void memoryReleaseUnused(void)
+{
+    // forced collect also purges the pages this thread freed but mimalloc was keeping committed
+    mi_collect(true);
+}
+
 /*
 
     Note: temporarily map to default allocators since mimalloc has no api for dedicated memory pools
@@ -135,6 +144,13 @@ void memoryFree(void *ptr)
     free(ptr);
 }
 
+void memoryReleaseUnused(void)
+{
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
 dedicated_memory_t *memorymanagerCreateDedicatedMemory(void)
 {
     return NULL;
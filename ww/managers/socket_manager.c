@@ -10,6 +10,7 @@
 #include "wloop.h"
 #include "wmutex.h"
 #include "wproc.h"
+#include "wsysinfo.h"
 
 #define i_type balancegroup_registry_t // NOLINT
 #define i_key  hash_t                  // NOLINT
@@ -23,6 +24,7 @@ typedef struct socket_filter_s
         wio_t  *listen_io;
         wio_t **listen_ios;
     };
+    wio_t                **worker_listen_ios; // reuse_port only, indexed by wid
     socket_filter_option_t option;
     tunnel_t              *tunnel;
     onAccept               cb;
@@ -42,26 +44,75 @@ enum
     kSoOriginalDest         = 80,
     kFilterLevels           = 4,
     kMaxBalanceSelections   = 64,
-    kDefaultBalanceInterval = 60 * 1000
+    kDefaultBalanceInterval = 60 * 1000,
+    kPortsCount             = 65536
 };
 
-typedef struct socket_manager_s
+enum
 {
-    filters_t filters[kFilterLevels];
+    kDispatchTcp,
+    kDispatchUdp,
+    kDispatchProtocols
+};
 
-    struct
-    {
-        generic_pool_t *pool; /* holds udp_payload_t */
-        wmutex_t        mutex;
+// a filter that may take a socket on some port, with what the distribute loops need already resolved
+typedef struct filter_candidate_s
+{
+    socket_filter_t *filter;
+    widle_table_t   *balance_table;
+    uint32_t         balance_interval;
+} filter_candidate_t;
+
+// filters of one protocol that cover the same ports, in priority order
+typedef struct port_dispatch_s
+{
+    filter_candidate_t *candidates;
+    uint32_t            count;
+} port_dispatch_t;
 
-    } *udp_pools;
+/*
+    built by socketmanagerStart and read only afterwards, ports_index[port] is the index of the port's entry
+    in entries, 0 means no filter listens on that port
+*/
+typedef struct port_dispatch_table_s
+{
+    uint16_t        *ports_index;
+    port_dispatch_t *entries;
+    uint32_t         entries_count;
+} port_dispatch_table_t;
 
+/*
+    udp_payload_t and socket_accept_result_t are taken on one worker and usually destroyed on another one
+
+    every item is taken from the pool of the worker that takes it, only that worker touches its generic pool,
+    an item destroyed on another worker is pushed to the owner's remote_frees stack (lock-free, many producers)
+    and the owner takes the whole stack back with one exchange the next time it needs an item
+*/
+typedef union recycle_header_u
+{
     struct
     {
-        generic_pool_t *pool; /* holds socket_accept_result_t */
-        wmutex_t        mutex;
+        union recycle_header_u *next;
+        wid_t                   owner;
+    };
+    max_align_t align; // keeps the item after the header aligned
+
+} recycle_header_t;
+
+typedef struct recycle_pool_s
+{
+    generic_pool_t *pool;
+    _Atomic(recycle_header_t *) remote_frees;
+
+} recycle_pool_t;
+
+typedef struct socket_manager_s
+{
+    filters_t             filters[kFilterLevels];
+    port_dispatch_table_t dispatch[kDispatchProtocols];
 
-    } *tcp_pools;
+    recycle_pool_t *udp_pools; /* hold udp_payload_t, indexed by wid */
+    recycle_pool_t *tcp_pools; /* hold socket_accept_result_t, indexed by wid */
 
     master_pool_t *mp_udp;
     master_pool_t *mp_tcp;
@@ -85,51 +136,94 @@ static socket_manager_state_t *state = NULL;
 static pool_item_t *allocTcpResultObjectPoolHandle(generic_pool_t *pool)
 {
     discard pool;
-    return memoryAllocate(sizeof(socket_accept_result_t));
+    recycle_header_t *header = memoryAllocate(sizeof(recycle_header_t) + sizeof(socket_accept_result_t));
+    return header + 1;
 }
 
-static void destroyTcpResultObjectPoolHandle(generic_pool_t *pool, pool_item_t *item)
+static pool_item_t *allocUdpPayloadPoolHandle(generic_pool_t *pool)
 {
     discard pool;
-    memoryFree(item);
+    recycle_header_t *header = memoryAllocate(sizeof(recycle_header_t) + sizeof(udp_payload_t));
+    return header + 1;
 }
 
-static pool_item_t *allocUdpPayloadPoolHandle(generic_pool_t *pool)
+static void destroyRecycledItemPoolHandle(generic_pool_t *pool, pool_item_t *item)
 {
     discard pool;
-    return memoryAllocate(sizeof(udp_payload_t));
+    memoryFree(((recycle_header_t *) item) - 1);
 }
 
-static void destroyUdpPayloadPoolHandle(generic_pool_t *pool, pool_item_t *item)
+static void recyclepoolTakeRemoteFrees(recycle_pool_t *rp)
 {
-    discard pool;
-    memoryFree(item);
+    recycle_header_t *header = atomic_exchange_explicit(&rp->remote_frees, NULL, memory_order_acquire);
+    while (header)
+    {
+        recycle_header_t *next = header->next;
+        genericpoolReuseItem(rp->pool, header + 1);
+        header = next;
+    }
 }
 
-void socketacceptresultDestroy(socket_accept_result_t *sar)
+static void *recyclepoolGetItem(recycle_pool_t *pools)
 {
-    const wid_t wid = sar->wid;
+    const wid_t     wid = getWID();
+    recycle_pool_t *rp  = &pools[wid];
 
-    mutexLock(&(state->tcp_pools[wid].mutex));
-    genericpoolReuseItem(state->tcp_pools[wid].pool, sar);
-    mutexUnlock(&(state->tcp_pools[wid].mutex));
+    if (atomicLoadExplicit(&rp->remote_frees, memory_order_relaxed) != NULL)
+    {
+        recyclepoolTakeRemoteFrees(rp);
+    }
+    // NOTE: the owner is set on every take, items move between the worker pools through the master pool
+    recycle_header_t *header = ((recycle_header_t *) genericpoolGetItem(rp->pool)) - 1;
+    header->owner            = wid;
+    return header + 1;
 }
 
-static udp_payload_t *newUpdPayload(wid_t wid)
+static void recyclepoolReuseItem(recycle_pool_t *pools, void *item)
 {
-    mutexLock(&(state->udp_pools[wid].mutex));
-    udp_payload_t *item = genericpoolGetItem(state->udp_pools[wid].pool);
-    mutexUnlock(&(state->udp_pools[wid].mutex));
-    return item;
+    recycle_header_t *header = ((recycle_header_t *) item) - 1;
+    const wid_t       owner  = header->owner;
+
+    if (owner == getWID())
+    {
+        genericpoolReuseItem(pools[owner].pool, item);
+        return;
+    }
+
+    // only the owner pops, and it takes the whole stack at once, so this push has no aba problem
+    recycle_header_t *head = atomicLoadExplicit(&pools[owner].remote_frees, memory_order_relaxed);
+    do
+    {
+        header->next = head;
+    } while (! atomic_compare_exchange_weak_explicit(&pools[owner].remote_frees, &head, header, memory_order_release,
+                                                     memory_order_relaxed));
 }
 
-void udppayloadDestroy(udp_payload_t *upl)
+static void recyclepoolDestroy(recycle_pool_t *rp)
 {
-    const wid_t wid = upl->wid;
+    recycle_header_t *header = atomicLoadExplicit(&rp->remote_frees, memory_order_acquire);
+    while (header)
+    {
+        recycle_header_t *next = header->next;
+        memoryFree(header);
+        header = next;
+    }
+    genericpoolDestroy(rp->pool);
+}
+
+void socketacceptresultDestroy(socket_accept_result_t *sar)
+{
+    recyclepoolReuseItem(state->tcp_pools, sar);
+}
 
-    mutexLock(&(state->udp_pools[wid].mutex));
-    genericpoolReuseItem(state->udp_pools[wid].pool, upl);
-    mutexUnlock(&(state->udp_pools[wid].mutex));
+static udp_payload_t *newUpdPayload(void)
+{
+    return recyclepoolGetItem(state->udp_pools);
+}
+
+void udppayloadDestroy(udp_payload_t *upl)
+{
+    recyclepoolReuseItem(state->udp_pools, upl);
 }
 
 static bool redirectPortRangeTcp(unsigned int pmin, unsigned int pmax, unsigned int to)
@@ -220,6 +314,23 @@ static inline bool needsV4SocketStrategy(const ip6_addr_t addr)
             segments[5] == 0xFFFF);
 }
 
+// NOTE: lists are compiled once here, matching a peer costs the same no matter how many ranges are listed
+static ip_prefix_set_t *buildIpPrefixSet(const vec_ipmask_t *list, const char *list_name)
+{
+    if (vec_ipmask_t_size(list) <= 0)
+    {
+        return NULL;
+    }
+    ip_prefix_set_t *set = ipprefixsetCreate();
+    c_foreach(i, vec_ipmask_t, *list)
+    {
+        ipprefixsetInsert(set, i.ref);
+    }
+    LOGD("SocketManager: %slist of %d ranges compiled into %u trie nodes", list_name, (int) vec_ipmask_t_size(list),
+         ipprefixsetNodesCount(set));
+    return set;
+}
+
 void socketacceptorRegister(tunnel_t *tunnel, socket_filter_option_t option, onAccept cb)
 {
     if (state->started)
@@ -266,6 +377,9 @@ void socketacceptorRegister(tunnel_t *tunnel, socket_filter_option_t option, onA
         option.shared_balance_table = b_table;
     }
 
+    option.white_set = buildIpPrefixSet(&option.white_list, "white");
+    option.black_set = buildIpPrefixSet(&option.black_list, "black");
+
     *filter = (socket_filter_t) {.tunnel = tunnel, .option = option, .cb = cb, .listen_io = NULL};
 
     mutexLock(&(state->mutex));
@@ -273,15 +387,18 @@ void socketacceptorRegister(tunnel_t *tunnel, socket_filter_option_t option, onA
     mutexUnlock(&(state->mutex));
 }
 
-static void distributeSocket(void *io, socket_filter_t *filter, uint16_t local_port)
+// local: the socket was accepted by a per worker listener and stays on this worker
+static void distributeSocket(void *io, socket_filter_t *filter, uint16_t local_port, bool local)
 {
-    wioDetach(io);
+    wid_t wid = local ? getWID() : getNextDistributionWID();
 
-    wid_t wid = getNextDistributionWID();
+    // NOTE: a socket that stays on this worker stays attached, the filter callback finds it in place
+    if (wid != getWID())
+    {
+        wioDetach(io);
+    }
 
-    mutexLock(&(state->tcp_pools[wid].mutex));
-    socket_accept_result_t *result = genericpoolGetItem(state->tcp_pools[wid].pool);
-    mutexUnlock(&(state->tcp_pools[wid].mutex));
+    socket_accept_result_t *result = recyclepoolGetItem(state->tcp_pools);
 
     *result = (socket_accept_result_t) {
         .io             = io,
@@ -295,7 +412,7 @@ static void distributeSocket(void *io, socket_filter_t *filter, uint16_t local_p
 
     ev.userdata = result;
 
-    if (wid == state->wid)
+    if (wid == getWID())
     {
         filter->cb(&ev);
     }
@@ -305,151 +422,227 @@ static void distributeSocket(void *io, socket_filter_t *filter, uint16_t local_p
     }
 }
 
-static void noTcpSocketConsumerFound(wio_t *io)
+static int comparePortEdges(const void *a, const void *b)
 {
-    char localaddrstr[SOCKADDR_STRLEN] = {0};
-    char peeraddrstr[SOCKADDR_STRLEN]  = {0};
-
-    LOGE("SocketManager: could not find consumer for Tcp socket FD:%x [%s] <= [%s]", wioGetFD(io),
-         SOCKADDR_STR(wioGetLocaladdrU(io), localaddrstr), SOCKADDR_STR(wioGetPeerAddrU(io), peeraddrstr));
-    wioClose(io);
+    return (int) (*(const uint32_t *) a) - (int) (*(const uint32_t *) b);
 }
 
-static bool checkIpIsWhiteList(const ip_addr_t addr, const socket_filter_option_t option)
+static void buildPortDispatchTable(port_dispatch_table_t *table, uint8_t protocol)
 {
-    const bool is_v4 = addr.type == IPADDR_TYPE_V4;
-    ip4_addr_t ipv4_addr;
-
-    if (is_v4)
+    uint32_t filters_count = 0;
+    for (int ri = (kFilterLevels - 1); ri >= 0; ri--)
     {
-        ip4_addr_copy(ipv4_addr, addr.u_addr.ip4);
-    v4checks:
-        for (int i = 0; i < vec_ipmask_t_size(&option.white_list); i++)
+        c_foreach(k, filters_t, state->filters[ri])
         {
-
-            if (checkIPRange4(ipv4_addr, vec_ipmask_t_at(&option.white_list, i)->ip.u_addr.ip4,
-                              vec_ipmask_t_at(&option.white_list, i)->mask.u_addr.ip4))
+            if ((*k.ref)->option.protocol == protocol)
             {
-                return true;
+                filters_count++;
             }
         }
     }
-    else
+
+    // NOTE: the matching filters only change at the edge of a range, all ports between two edges share one entry
+    uint32_t  edges_count = 0;
+    uint32_t *edges       = memoryAllocate(sizeof(uint32_t) * (2 * filters_count + 2));
+    edges[edges_count++]  = 0;
+    edges[edges_count++]  = kPortsCount;
+    for (int ri = (kFilterLevels - 1); ri >= 0; ri--)
     {
-        if (needsV4SocketStrategy(addr.u_addr.ip6))
+        c_foreach(k, filters_t, state->filters[ri])
         {
-            memoryCopy(&ipv4_addr, &(addr.u_addr.ip6.addr[3]), sizeof(ipv4_addr.addr));
-            goto v4checks;
+            const socket_filter_option_t *option = &(*k.ref)->option;
+            if (option->protocol == protocol && option->port_min <= option->port_max)
+            {
+                edges[edges_count++] = option->port_min;
+                edges[edges_count++] = (uint32_t) option->port_max + 1;
+            }
         }
+    }
+    qsort(edges, edges_count, sizeof(uint32_t), comparePortEdges);
+
+    table->ports_index = memoryAllocate(sizeof(uint16_t) * kPortsCount);
+    memorySet(table->ports_index, 0, sizeof(uint16_t) * kPortsCount);
+    table->entries = memoryAllocate(sizeof(port_dispatch_t) * edges_count);
+    memorySet(table->entries, 0, sizeof(port_dispatch_t) * edges_count);
+    table->entries_count = 1; // entry 0 stands for no filter
 
-        for (int i = 0; i < vec_ipmask_t_size(&option.white_list); i++)
+    for (uint32_t e = 0; e + 1 < edges_count; e++)
+    {
+        uint32_t first = edges[e];
+        uint32_t last  = edges[e + 1];
+        if (first == last)
         {
+            continue;
+        }
 
-            if (checkIPRange6(addr.u_addr.ip6, vec_ipmask_t_at(&option.white_list, i)->ip.u_addr.ip6,
-                              vec_ipmask_t_at(&option.white_list, i)->mask.u_addr.ip6))
+        port_dispatch_t entry = {.candidates = NULL, .count = 0};
+        for (int ri = (kFilterLevels - 1); ri >= 0; ri--)
+        {
+            c_foreach(k, filters_t, state->filters[ri])
             {
-                return true;
+                socket_filter_t              *filter = *(k.ref);
+                const socket_filter_option_t *option = &filter->option;
+                if (option->protocol != protocol || option->port_min > first || option->port_max < first)
+                {
+                    continue;
+                }
+                if (entry.candidates == NULL)
+                {
+                    entry.candidates = memoryAllocate(sizeof(filter_candidate_t) * filters_count);
+                }
+                entry.candidates[entry.count++] = (filter_candidate_t) {
+                    .filter        = filter,
+                    .balance_table = option->shared_balance_table,
+                    .balance_interval =
+                        option->balance_group_interval == 0 ? kDefaultBalanceInterval : option->balance_group_interval};
             }
         }
+        if (entry.count == 0)
+        {
+            continue;
+        }
+
+        uint16_t index                        = (uint16_t) table->entries_count;
+        table->entries[table->entries_count++] = entry;
+        for (uint32_t port = first; port < last; port++)
+        {
+            table->ports_index[port] = index;
+        }
     }
+    memoryFree(edges);
+
+    LOGD("SocketManager: %s dispatch table has %u entries for %u filters", protocol == IPPROTO_TCP ? "tcp" : "udp",
+         table->entries_count - 1, filters_count);
+}
 
-    return false;
+static void destroyPortDispatchTable(port_dispatch_table_t *table)
+{
+    if (table->entries == NULL)
+    {
+        return;
+    }
+    for (uint32_t i = 1; i < table->entries_count; i++)
+    {
+        memoryFree(table->entries[i].candidates);
+    }
+    memoryFree(table->entries);
+    memoryFree(table->ports_index);
+    *table = (port_dispatch_table_t) {0};
+}
+
+// NULL if no filter of the protocol covers the port
+static inline const port_dispatch_t *getPortDispatch(int protocol_index, uint16_t port)
+{
+    const port_dispatch_table_t *table = &state->dispatch[protocol_index];
+    uint16_t                     index = table->ports_index[port];
+    return index == 0 ? NULL : &table->entries[index];
+}
+
+static void noTcpSocketConsumerFound(wio_t *io)
+{
+    char localaddrstr[SOCKADDR_STRLEN] = {0};
+    char peeraddrstr[SOCKADDR_STRLEN]  = {0};
+
+    LOGE("SocketManager: could not find consumer for Tcp socket FD:%x [%s] <= [%s]", wioGetFD(io),
+         SOCKADDR_STR(wioGetLocaladdrU(io), localaddrstr), SOCKADDR_STR(wioGetPeerAddrU(io), peeraddrstr));
+    wioClose(io);
 }
 
-static void distributeTcpSocket(wio_t *io, uint16_t local_port)
+static void distributeTcpSocket(wio_t *io, uint16_t local_port, bool local)
 {
     ip_addr_t paddr;
 
     sockaddrToIpAddr(wioGetPeerAddrU(io), &paddr);
 
-    static socket_filter_t *balance_selection_filters[kMaxBalanceSelections];
-    uint8_t                 balance_selection_filters_length = 0;
-    widle_table_t          *selected_balance_table           = NULL;
-    hash_t                  src_hash                         = 0x0;
-    bool                    src_hashed                       = false;
-    const uint8_t           this_wid                         = state->wid;
+    // NOTE: not static, per worker listeners run this on every worker at once
+    const filter_candidate_t *balance_selections[kMaxBalanceSelections];
+    uint8_t                   balance_selections_length = 0;
+    widle_table_t            *selected_balance_table    = NULL;
+    hash_t                    src_hash                  = 0x0;
+    bool                      src_hashed                = false;
+    const uint8_t             this_wid                  = (uint8_t) getWID();
+    const port_dispatch_t    *dispatch                  = getPortDispatch(kDispatchTcp, local_port);
 
-    for (int ri = (kFilterLevels - 1); ri >= 0; ri--)
+    for (uint32_t ci = 0; dispatch != NULL && ci < dispatch->count; ci++)
     {
-        c_foreach(k, filters_t, state->filters[ri])
+        const filter_candidate_t     *candidate = &dispatch->candidates[ci];
+        socket_filter_t              *filter    = candidate->filter;
+        const socket_filter_option_t *option    = &filter->option;
+
+        if (selected_balance_table != NULL && candidate->balance_table != selected_balance_table)
         {
-            socket_filter_t       *filter   = *(k.ref);
-            socket_filter_option_t option   = filter->option;
-            uint16_t               port_min = option.port_min;
-            uint16_t               port_max = option.port_max;
+            continue;
+        }
 
-            if (selected_balance_table != NULL && option.shared_balance_table != selected_balance_table)
-            {
-                continue;
-            }
+        if (option->white_set && ! ipprefixsetContains(option->white_set, &paddr))
+        {
+            continue;
+        }
+        if (option->black_set && ipprefixsetContains(option->black_set, &paddr))
+        {
+            continue;
+        }
 
-            if (option.protocol != IPPROTO_TCP || port_min > local_port || port_max < local_port)
+        if (candidate->balance_table)
+        {
+            if (! src_hashed)
             {
-                continue;
+                src_hash   = ipaddrCalcHashNoPort(paddr);
+                src_hashed = true;
             }
+            // NOTE: with per worker listeners the client may have been balanced by another worker
+            socket_filter_t *target_filter =
+                idleTableKeepIdleItemByHashForAtleast(candidate->balance_table, src_hash, candidate->balance_interval);
 
-            if (vec_ipmask_t_size(&option.white_list) > 0)
+            if (target_filter)
             {
-                if (! checkIpIsWhiteList(paddr, option))
+                if (option->no_delay)
                 {
-                    continue;
+                    tcpNoDelay(wioGetFD(io), 1);
                 }
+                distributeSocket(io, target_filter, local_port, local);
+                return;
             }
 
-            if (option.shared_balance_table)
+            if (UNLIKELY(balance_selections_length >= kMaxBalanceSelections))
             {
-                if (! src_hashed)
-                {
-                    src_hash = ipaddrCalcHashNoPort(paddr);
-                }
-                widle_item_t *idle_item = idleTableGetIdleItemByHash(this_wid, option.shared_balance_table, src_hash);
-
-                if (idle_item)
-                {
-                    socket_filter_t *target_filter = idle_item->userdata;
-                    idleTableKeepIdleItemForAtleast(option.shared_balance_table, idle_item,
-                                                    option.balance_group_interval == 0 ? kDefaultBalanceInterval
-                                                                                       : option.balance_group_interval);
-                    if (option.no_delay)
-                    {
-                        tcpNoDelay(wioGetFD(io), 1);
-                    }
-                    distributeSocket(io, target_filter, local_port);
-                    return;
-                }
-
-                if (UNLIKELY(balance_selection_filters_length >= kMaxBalanceSelections))
-                {
-                    // probably never but the limit can be simply increased
-                    LOGW("SocketManager: balance between more than %d tunnels is not supported", kMaxBalanceSelections);
-                    continue;
-                }
-                balance_selection_filters[balance_selection_filters_length++] = filter;
-                selected_balance_table                                        = option.shared_balance_table;
+                // probably never but the limit can be simply increased
+                LOGW("SocketManager: balance between more than %d tunnels is not supported", kMaxBalanceSelections);
                 continue;
             }
+            balance_selections[balance_selections_length++] = candidate;
+            selected_balance_table                          = candidate->balance_table;
+            continue;
+        }
 
-            if (option.no_delay)
-            {
-                tcpNoDelay(wioGetFD(io), 1);
-            }
-            wioDetach(io);
-            distributeSocket(io, filter, local_port);
-            return;
+        if (option->no_delay)
+        {
+            tcpNoDelay(wioGetFD(io), 1);
         }
+        distributeSocket(io, filter, local_port, local);
+        return;
     }
 
-    if (balance_selection_filters_length > 0)
+    if (balance_selections_length > 0)
     {
-        socket_filter_t *filter = balance_selection_filters[fastRand() % balance_selection_filters_length];
-        idleItemNew(filter->option.shared_balance_table, src_hash, filter, NULL, this_wid,
-                    filter->option.balance_group_interval == 0 ? kDefaultBalanceInterval
-                                                               : filter->option.balance_group_interval);
-        if (filter->option.no_delay)
+        const filter_candidate_t *candidate = balance_selections[fastRand() % balance_selections_length];
+        socket_filter_t          *target    = candidate->filter;
+        if (idleItemNew(candidate->balance_table, src_hash, target, NULL, this_wid, candidate->balance_interval) ==
+            NULL)
+        {
+            // another worker balanced the same client in the meantime, follow its choice
+            socket_filter_t *other =
+                idleTableKeepIdleItemByHashForAtleast(candidate->balance_table, src_hash, candidate->balance_interval);
+            if (other != NULL)
+            {
+                target = other;
+            }
+        }
+        if (target->option.no_delay)
         {
             tcpNoDelay(wioGetFD(io), 1);
         }
-        distributeSocket(io, filter, local_port);
+        distributeSocket(io, target, local_port, local);
     }
     else
     {
@@ -459,7 +652,12 @@ static void distributeTcpSocket(wio_t *io, uint16_t local_port)
 
 static void onAcceptTcpSinglePort(wio_t *io)
 {
-    distributeTcpSocket(io, sockaddrPort(wioGetLocaladdrU(io)));
+    distributeTcpSocket(io, sockaddrPort(wioGetLocaladdrU(io)), false);
+}
+
+static void onAcceptTcpReusePort(wio_t *io)
+{
+    distributeTcpSocket(io, sockaddrPort(wioGetLocaladdrU(io)), true);
 }
 
 static void onAcceptTcpMultiPort(wio_t *io)
@@ -489,7 +687,7 @@ static void onAcceptTcpMultiPort(wio_t *io)
         return;
     }
 
-    distributeTcpSocket(io, (uint16_t) ((pbuf[2] << 8) | pbuf[3]));
+    distributeTcpSocket(io, (uint16_t) ((pbuf[2] << 8) | pbuf[3]), false);
 #else
     onAcceptTcpSinglePort(io);
 #endif
@@ -614,6 +812,71 @@ static void listenTcpMultiPortSockets(wloop_t *loop, socket_filter_t *filter, ch
     }
 }
 
+static wio_t *createWorkerTcpListener(wloop_t *loop, socket_filter_t *filter, uint16_t port, wid_t wid)
+{
+    char       host_if[60] = {0};
+    const char *host       = filter->option.host;
+    if (filter->option.interface != NULL)
+    {
+        ip4_addr_t if_ip;
+        if (! getInterfaceIp(filter->option.interface, &if_ip, stringLength(filter->option.interface)))
+        {
+            LOGF("SocketManager: Could not get interface \"%s\" ip", filter->option.interface);
+            terminateProgram(1);
+        }
+        ip4AddrAddressToNetwork(host_if, &if_ip);
+        host = host_if;
+    }
+
+    wio_t *io = wloopCreateTcpServerReusePort(loop, host, port, onAcceptTcpReusePort);
+    if (io == NULL)
+    {
+        LOGF("SocketManager: worker %d could not listen on %s:[%u] (%s)", wid, host, port, "TCP");
+        terminateProgram(1);
+    }
+    if (filter->option.incoming_cpu && socketOptionIncomingCpu(wioGetFD(io), (int) (wid % getNCPU())) != 0)
+    {
+        LOGW("SocketManager: SO_INCOMING_CPU failed on %s:[%u] for worker %d", host, port, wid);
+    }
+    filter->worker_listen_ios[wid] = io;
+    return io;
+}
+
+static void listenTcpOnWorker(worker_t *worker, void *arg1, void *arg2, void *arg3)
+{
+    discard arg3;
+    createWorkerTcpListener(worker->loop, arg1, (uint16_t) (uintptr_t) arg2, worker->wid);
+}
+
+// every worker accepts on its own SO_REUSEPORT socket and runs the filters locally, nothing is distributed
+static void listenTcpSinglePortReusePort(wloop_t *loop, socket_filter_t *filter, char *host, uint16_t port,
+                                         uint8_t *ports_overlapped)
+{
+    if (ports_overlapped[port] == 1)
+    {
+        return;
+    }
+    ports_overlapped[port] = 1;
+    LOGI("SocketManager: listening on %s:[%u] (%s) with a SO_REUSEPORT listener per worker", host, port, "TCP");
+
+    const wid_t loop_workers  = getWorkersCount() - WORKER_ADDITIONS;
+    filter->worker_listen_ios = memoryAllocate(sizeof(wio_t *) * loop_workers);
+    memorySet(filter->worker_listen_ios, 0, sizeof(wio_t *) * loop_workers);
+
+    // NOTE: our own listener binds first and synchronously so a busy port fails right here,
+    // the others are created by their workers because an io must be added to its loop on the loop thread
+    filter->listen_io    = createWorkerTcpListener(loop, filter, port, state->wid);
+    filter->v6_dualstack = wioGetLocaladdr(filter->listen_io)->sa_family == AF_INET6;
+
+    for (wid_t wid = 0; wid < loop_workers; wid++)
+    {
+        if (wid != state->wid)
+        {
+            sendWorkerMessageForceQueue(wid, listenTcpOnWorker, filter, (void *) (uintptr_t) port, NULL);
+        }
+    }
+}
+
 static void listenTcpSinglePort(wloop_t *loop, socket_filter_t *filter, char *host, uint16_t port,
                                 uint8_t *ports_overlapped)
 {
@@ -675,6 +938,11 @@ static void listenTcp(wloop_t *loop, uint8_t *ports_overlapped)
             }
             if (option.protocol == IPPROTO_TCP)
             {
+                if (option.reuse_port && option.multiport_backend != kMultiportBackendNone)
+                {
+                    LOGW("SocketManager: reuseport only applies to a single port, ignored for %s:[%u - %u]",
+                         option.host, port_min, port_max);
+                }
                 if (option.multiport_backend == kMultiportBackendIptables)
                 {
                     listenTcpMultiPortIptables(loop, filter, option.host, port_min, ports_overlapped, port_max);
@@ -683,6 +951,10 @@ static void listenTcp(wloop_t *loop, uint8_t *ports_overlapped)
                 {
                     listenTcpMultiPortSockets(loop, filter, option.host, port_min, ports_overlapped, port_max);
                 }
+                else if (option.reuse_port)
+                {
+                    listenTcpSinglePortReusePort(loop, filter, option.host, port_min, ports_overlapped);
+                }
                 else
                 {
                     listenTcpSinglePort(loop, filter, option.host, port_min, ports_overlapped);
@@ -697,8 +969,8 @@ static void noUdpSocketConsumerFound(const udp_payload_t upl)
     char localaddrstr[SOCKADDR_STRLEN] = {0};
     char peeraddrstr[SOCKADDR_STRLEN]  = {0};
     LOGE("SocketManager: could not find consumer for Udp socket  [%s] <= [%s]",
-         SOCKADDR_STR(wioGetLocaladdrU(upl.sock->io), localaddrstr),
-         SOCKADDR_STR(wioGetPeerAddrU(upl.sock->io), peeraddrstr));
+         SOCKADDR_STR(wioGetLocaladdrU(upl.sock->io), localaddrstr), SOCKADDR_STR(&upl.peer_addr, peeraddrstr));
+    bufferpoolReuseBuffer(getWorkerBufferPool(getWID()), upl.buf);
 }
 
 /*
@@ -708,18 +980,15 @@ static void noUdpSocketConsumerFound(const udp_payload_t upl)
  */
 static void postUdpPayload(udp_payload_t post_pl, socket_filter_t *filter)
 {
-
-    mutexLock(&(state->udp_pools[post_pl.wid].mutex));
-    udp_payload_t *pl = genericpoolGetItem(state->udp_pools[post_pl.wid].pool);
-    mutexUnlock(&(state->udp_pools[post_pl.wid].mutex));
-    *pl = post_pl;
+    udp_payload_t *pl = newUpdPayload();
+    *pl               = post_pl;
 
     pl->tunnel           = filter->tunnel;
     wloop_t *worker_loop = getWorkerLoop(pl->wid);
     wevent_t ev          = (wevent_t) {.loop = worker_loop, .cb = filter->cb};
     ev.userdata          = (void *) pl;
 
-    if (pl->wid == state->wid)
+    if (pl->wid == getWID())
     {
         filter->cb(&ev);
         return;
@@ -735,83 +1004,83 @@ static void distributeUdpPayload(const udp_payload_t pl)
 {
 
     ip_addr_t paddr;
-    sockaddrToIpAddr(wioGetPeerAddrU(pl.sock->io), &paddr);
-
-    uint16_t local_port = pl.real_localport;
-
-    static socket_filter_t *balance_selection_filters[kMaxBalanceSelections];
-    uint8_t                 balance_selection_filters_length = 0;
-    widle_table_t          *selected_balance_table           = NULL;
-    hash_t                  src_hash                         = 0x0;
-    bool                    src_hashed                       = false;
-    const uint8_t           this_wid                         = state->wid;
-
-    for (int ri = (kFilterLevels - 1); ri >= 0; ri--)
+    sockaddrToIpAddr(&pl.peer_addr, &paddr);
+
+    // NOTE: not static, per worker sockets run this on every worker at once
+    const filter_candidate_t *balance_selections[kMaxBalanceSelections];
+    uint8_t                   balance_selections_length = 0;
+    widle_table_t            *selected_balance_table    = NULL;
+    hash_t                    src_hash                  = 0x0;
+    bool                      src_hashed                = false;
+    const uint8_t             this_wid                  = (uint8_t) getWID();
+    const port_dispatch_t    *dispatch                  = getPortDispatch(kDispatchUdp, pl.real_localport);
+
+    for (uint32_t ci = 0; dispatch != NULL && ci < dispatch->count; ci++)
     {
-        c_foreach(k, filters_t, state->filters[ri])
-        {
+        const filter_candidate_t     *candidate = &dispatch->candidates[ci];
+        socket_filter_t              *filter    = candidate->filter;
+        const socket_filter_option_t *option    = &filter->option;
 
-            socket_filter_t       *filter   = *(k.ref);
-            socket_filter_option_t option   = filter->option;
-            uint16_t               port_min = option.port_min;
-            uint16_t               port_max = option.port_max;
+        if (selected_balance_table != NULL && candidate->balance_table != selected_balance_table)
+        {
+            continue;
+        }
 
-            if (selected_balance_table != NULL && option.shared_balance_table != selected_balance_table)
+        if (option->white_set && ! ipprefixsetContains(option->white_set, &paddr))
+        {
+            continue;
+        }
+        if (option->black_set && ipprefixsetContains(option->black_set, &paddr))
+        {
+            continue;
+        }
+        if (candidate->balance_table)
+        {
+            if (! src_hashed)
             {
-                continue;
+                src_hash   = ipaddrCalcHashNoPort(paddr);
+                src_hashed = true;
             }
+            // NOTE: with per worker sockets the peer may have been balanced by another worker
+            socket_filter_t *target_filter =
+                idleTableKeepIdleItemByHashForAtleast(candidate->balance_table, src_hash, candidate->balance_interval);
 
-            if (option.protocol != IPPROTO_UDP || port_min > local_port || port_max < local_port)
-            {
-                continue;
-            }
-            if (vec_ipmask_t_size(&option.white_list) > 0)
+            if (target_filter)
             {
-                if (! checkIpIsWhiteList(paddr, option))
-                {
-                    continue;
-                }
+                postUdpPayload(pl, target_filter);
+                return;
             }
-            if (option.shared_balance_table)
-            {
-                if (! src_hashed)
-                {
-                    src_hash = ipaddrCalcHashNoPort(paddr);
-                }
-                widle_item_t *idle_item = idleTableGetIdleItemByHash(this_wid, option.shared_balance_table, src_hash);
-
-                if (idle_item)
-                {
-                    socket_filter_t *target_filter = idle_item->userdata;
-                    idleTableKeepIdleItemForAtleast(option.shared_balance_table, idle_item,
-                                                    option.balance_group_interval == 0 ? kDefaultBalanceInterval
-                                                                                       : option.balance_group_interval);
-                    postUdpPayload(pl, target_filter);
-                    return;
-                }
 
-                if (UNLIKELY(balance_selection_filters_length >= kMaxBalanceSelections))
-                {
-                    // probably never but the limit can be simply increased
-                    LOGW("SocketManager: balance between more than %d tunnels is not supported", kMaxBalanceSelections);
-                    continue;
-                }
-                balance_selection_filters[balance_selection_filters_length++] = filter;
-                selected_balance_table                                        = option.shared_balance_table;
+            if (UNLIKELY(balance_selections_length >= kMaxBalanceSelections))
+            {
+                // probably never but the limit can be simply increased
+                LOGW("SocketManager: balance between more than %d tunnels is not supported", kMaxBalanceSelections);
                 continue;
             }
-
-            postUdpPayload(pl, filter);
-            return;
+            balance_selections[balance_selections_length++] = candidate;
+            selected_balance_table                          = candidate->balance_table;
+            continue;
         }
+
+        postUdpPayload(pl, filter);
+        return;
     }
-    if (balance_selection_filters_length > 0)
+    if (balance_selections_length > 0)
     {
-        socket_filter_t *filter = balance_selection_filters[fastRand() % balance_selection_filters_length];
-        idleItemNew(filter->option.shared_balance_table, src_hash, filter, NULL, this_wid,
-                    filter->option.balance_group_interval == 0 ? kDefaultBalanceInterval
-                                                               : filter->option.balance_group_interval);
-        postUdpPayload(pl, filter);
+        const filter_candidate_t *candidate = balance_selections[fastRand() % balance_selections_length];
+        socket_filter_t          *target    = candidate->filter;
+        if (idleItemNew(candidate->balance_table, src_hash, target, NULL, this_wid, candidate->balance_interval) ==
+            NULL)
+        {
+            // another worker balanced the same peer in the meantime, follow its choice
+            socket_filter_t *other =
+                idleTableKeepIdleItemByHashForAtleast(candidate->balance_table, src_hash, candidate->balance_interval);
+            if (other != NULL)
+            {
+                target = other;
+            }
+        }
+        postUdpPayload(pl, target);
     }
     else
     {
@@ -823,14 +1092,57 @@ static void onUdpPacketReceived(wio_t *io, sbuf_t *buf)
 {
     udpsock_t *socket     = weventGetUserdata(io);
     uint16_t   local_port = sockaddrPort(wioGetLocaladdrU(io));
-    wid_t      target_wid = (wid_t) local_port % getWorkersCount();
 
-    udp_payload_t item = (udp_payload_t) {
-        .sock = socket, .buf = buf, .wid = target_wid, .peer_addr = *wioGetPeerAddrU(io), .real_localport = local_port};
+    // NOTE: hash the peer, not the port, so sessions of one busy port spread over the workers and every
+    // datagram of a peer still lands on the same worker
+    const sockaddr_u *peer_addr  = wioGetPeerAddrU(io);
+    wid_t             target_wid = (wid_t) (sockaddrCalcHashWithPort(peer_addr) %
+                                           (hash_t) (getWorkersCount() - WORKER_ADDITIONS));
+
+    udp_payload_t item = (udp_payload_t) {.sock             = socket,
+                                          .buf              = buf,
+                                          .wid              = target_wid,
+                                          .peer_addr        = *peer_addr,
+                                          .real_localport   = local_port,
+                                          .gro_segment_size = wioGetUdpGroSegmentSize(io)};
+
+    distributeUdpPayload(item);
+}
+
+// per worker sockets: the kernel already picked this worker by the 4-tuple hash
+static void onUdpPacketReceivedReusePort(wio_t *io, sbuf_t *buf)
+{
+    udpsock_t *socket = weventGetUserdata(io);
+
+    udp_payload_t item = (udp_payload_t) {.sock             = socket,
+                                          .buf              = buf,
+                                          .wid              = getWID(),
+                                          .peer_addr        = *wioGetPeerAddrU(io),
+                                          .real_localport   = sockaddrPort(wioGetLocaladdrU(io)),
+                                          .gro_segment_size = wioGetUdpGroSegmentSize(io)};
 
     distributeUdpPayload(item);
 }
 
+static void setupUdpListenSocket(wloop_t *loop, socket_filter_t *filter, wio_t *io, char *host, uint16_t port,
+                                 wread_cb read_cb)
+{
+    udpsock_t *socket = memoryAllocate(sizeof(udpsock_t));
+    *socket           = (udpsock_t) {.io = io, .table = idleTableCreate(loop)};
+    weventSetUserData(io, socket);
+    // NOTE: the first filter listening on a port decides the offloads for everyone sharing it
+    if (filter->option.udp_gro && wioEnableUdpGro(io) == 0)
+    {
+        LOGD("SocketManager: udp gro enabled on %s:[%u]", host, port);
+    }
+    if (filter->option.udp_gso && wioEnableUdpGso(io) == 0)
+    {
+        LOGD("SocketManager: udp gso enabled on %s:[%u]", host, port);
+    }
+    wioSetCallBackRead(io, read_cb);
+    wioRead(io);
+}
+
 static void listenUdpSinglePort(wloop_t *loop, socket_filter_t *filter, char *host, uint16_t port,
                                 uint8_t *ports_overlapped)
 {
@@ -847,11 +1159,53 @@ static void listenUdpSinglePort(wloop_t *loop, socket_filter_t *filter, char *ho
         LOGF("SocketManager: stopping due to null socket handle");
         terminateProgram(1);
     }
-    udpsock_t *socket = memoryAllocate(sizeof(udpsock_t));
-    *socket           = (udpsock_t) {.io = filter->listen_io, .table = idleTableCreate(loop)};
-    weventSetUserData(filter->listen_io, socket);
-    wioSetCallBackRead(filter->listen_io, onUdpPacketReceived);
-    wioRead(filter->listen_io);
+    setupUdpListenSocket(loop, filter, filter->listen_io, host, port, onUdpPacketReceived);
+}
+
+static wio_t *createWorkerUdpListener(wloop_t *loop, socket_filter_t *filter, uint16_t port, wid_t wid)
+{
+    wio_t *io = wloopCreateUdpServerReusePort(loop, filter->option.host, port);
+    if (io == NULL)
+    {
+        LOGF("SocketManager: worker %d could not listen on %s:[%u] (%s)", wid, filter->option.host, port, "UDP");
+        terminateProgram(1);
+    }
+    setupUdpListenSocket(loop, filter, io, filter->option.host, port, onUdpPacketReceivedReusePort);
+    filter->worker_listen_ios[wid] = io;
+    return io;
+}
+
+static void listenUdpOnWorker(worker_t *worker, void *arg1, void *arg2, void *arg3)
+{
+    discard arg3;
+    createWorkerUdpListener(worker->loop, arg1, (uint16_t) (uintptr_t) arg2, worker->wid);
+}
+
+// every worker reads its own SO_REUSEPORT socket, receive and filtering never leave the worker
+static void listenUdpSinglePortReusePort(wloop_t *loop, socket_filter_t *filter, char *host, uint16_t port,
+                                         uint8_t *ports_overlapped)
+{
+    if (ports_overlapped[port] == 1)
+    {
+        return;
+    }
+    ports_overlapped[port] = 1;
+    LOGI("SocketManager: listening on %s:[%u] (%s) with a SO_REUSEPORT socket per worker", host, port, "UDP");
+
+    const wid_t loop_workers  = getWorkersCount() - WORKER_ADDITIONS;
+    filter->worker_listen_ios = memoryAllocate(sizeof(wio_t *) * loop_workers);
+    memorySet(filter->worker_listen_ios, 0, sizeof(wio_t *) * loop_workers);
+
+    // NOTE: same as tcp, bind ours synchronously and let the other workers add their sockets on their own loops
+    filter->listen_io = createWorkerUdpListener(loop, filter, port, state->wid);
+
+    for (wid_t wid = 0; wid < loop_workers; wid++)
+    {
+        if (wid != state->wid)
+        {
+            sendWorkerMessageForceQueue(wid, listenUdpOnWorker, filter, (void *) (uintptr_t) port, NULL);
+        }
+    }
 }
 
 // todo (udp manager)
@@ -890,6 +1244,10 @@ static void listenUdp(wloop_t *loop, uint8_t *ports_overlapped)
                 {
                     // listenUdpMultiPortSockets(loop, filter, option.host, port_min, ports_overlapped, port_max);
                 }
+                else if (option.reuse_port)
+                {
+                    listenUdpSinglePortReusePort(loop, filter, option.host, port_min, ports_overlapped);
+                }
                 else
                 {
                     listenUdpSinglePort(loop, filter, option.host, port_min, ports_overlapped);
@@ -901,25 +1259,28 @@ static void listenUdp(wloop_t *loop, uint8_t *ports_overlapped)
 
 static void writeUdpThisLoop(wevent_t *ev)
 {
-    udp_payload_t *upl    = weventGetUserdata(ev);
-    int            nwrite = wioWrite(upl->sock->io, upl->buf);
-    discard        nwrite;
+    udp_payload_t *upl = weventGetUserdata(ev);
+    wioSetPeerAddr(upl->sock->io, &upl->peer_addr.sa, (int) sockaddrLen(&upl->peer_addr));
+    int     nwrite = wioWrite(upl->sock->io, upl->buf);
+    discard nwrite;
     udppayloadDestroy(upl);
 }
 
-void postUdpWrite(udpsock_t *socket_io, wid_t wid_from, sbuf_t *buf)
+void postUdpWrite(udpsock_t *socket_io, wid_t wid_from, const sockaddr_u *peer_addr, sbuf_t *buf)
 {
-    if (wid_from == state->wid)
+    if (wid_from == wloopGetWID(weventGetLoop(socket_io->io)))
     {
+        // NOTE: the listen socket is shared by all peers, the destination is set right before every write
+        wioSetPeerAddr(socket_io->io, (struct sockaddr *) &peer_addr->sa, (int) SOCKADDR_LEN(peer_addr));
         int     nwrite = wioWrite(socket_io->io, buf);
         discard nwrite;
 
         return;
     }
 
-    udp_payload_t *item = newUpdPayload(wid_from);
+    udp_payload_t *item = newUpdPayload();
 
-    *item = (udp_payload_t) {.sock = socket_io, .buf = buf, .wid = wid_from};
+    *item = (udp_payload_t) {.sock = socket_io, .buf = buf, .peer_addr = *peer_addr, .wid = wid_from};
 
     wevent_t ev = (wevent_t) {.loop = weventGetLoop(socket_io->io), .userdata = item, .cb = writeUdpThisLoop};
 
@@ -945,6 +1306,10 @@ void socketmanagerStart(void)
 
     mutexLock(&(state->mutex));
 
+    // NOTE: built before any listener exists, workers only read them from now on
+    buildPortDispatchTable(&state->dispatch[kDispatchTcp], IPPROTO_TCP);
+    buildPortDispatchTable(&state->dispatch[kDispatchUdp], IPPROTO_UDP);
+
     {
         uint8_t ports_overlapped[65536] = {0};
         listenTcp(state->worker->loop, ports_overlapped);
@@ -985,20 +1350,13 @@ socket_manager_state_t *socketmanagerCreate(void)
 
     for (unsigned int i = 0; i < getWorkersCount(); ++i)
     {
-
         state->udp_pools[i].pool = genericpoolCreateWithCapacity(
-            state->mp_udp, (8) + RAM_PROFILE, allocUdpPayloadPoolHandle, destroyUdpPayloadPoolHandle);
-        mutexInit(&(state->udp_pools[i].mutex));
+            state->mp_udp, (8) + RAM_PROFILE, allocUdpPayloadPoolHandle, destroyRecycledItemPoolHandle);
+        atomicStoreExplicit(&state->udp_pools[i].remote_frees, NULL, memory_order_relaxed);
 
         state->tcp_pools[i].pool = genericpoolCreateWithCapacity(
-            state->mp_tcp, (8) + RAM_PROFILE, allocTcpResultObjectPoolHandle, destroyTcpResultObjectPoolHandle);
-        mutexInit(&(state->tcp_pools[i].mutex));
-
-#ifdef DEBUG
-        // we already protect these pools with mutex
-        state->udp_pools[i].pool->no_thread_check = true;
-        state->tcp_pools[i].pool->no_thread_check = true;
-#endif
+            state->mp_tcp, (8) + RAM_PROFILE, allocTcpResultObjectPoolHandle, destroyRecycledItemPoolHandle);
+        atomicStoreExplicit(&state->tcp_pools[i].remote_frees, NULL, memory_order_relaxed);
     }
 
 #ifdef OS_UNIX
@@ -1022,10 +1380,18 @@ void socketmanagerDestroy(void)
     {
         resetIptables(true);
     }
+    for (int i = 0; i < kDispatchProtocols; i++)
+    {
+        destroyPortDispatchTable(&state->dispatch[i]);
+    }
     for (size_t i = 0; i < kFilterLevels; i++)
     {
         c_foreach(filter, filters_t, state->filters[i])
         {
+            if ((*filter.ref)->worker_listen_ios)
+            {
+                memoryFree((*filter.ref)->worker_listen_ios);
+            }
             socketfilteroptionDeInit(&((*filter.ref)->option));
             memoryFree(*filter.ref);
         }
@@ -1035,10 +1401,8 @@ void socketmanagerDestroy(void)
 
     for (unsigned int i = 0; i < getWorkersCount(); ++i)
     {
-        mutexDestroy(&(state->udp_pools[i].mutex));
-        genericpoolDestroy(state->udp_pools[i].pool);
-        mutexDestroy(&(state->tcp_pools[i].mutex));
-        genericpoolDestroy(state->tcp_pools[i].pool);
+        recyclepoolDestroy(&state->udp_pools[i]);
+        recyclepoolDestroy(&state->tcp_pools[i]);
     }
 
     memoryFree(state->udp_pools);
@@ -40,6 +40,7 @@ typedef struct udp_payload_s
     sbuf_t    *buf;
     sockaddr_u peer_addr;
     uint16_t   real_localport;
+    uint16_t   gro_segment_size; // non zero if buf holds gro coalesced datagrams of this size
     wid_t      wid;
 
 } udp_payload_t;
@@ -53,4 +54,4 @@ void                     socketmanagerDestroy(void);
 void                     socketmanagerSet(struct socket_manager_s *state);
 void                     socketmanagerStart(void);
 void                     socketacceptorRegister(tunnel_t *tunnel, socket_filter_option_t option, onAccept cb);
-void                     postUdpWrite(udpsock_t *socket_io, wid_t wid_from, sbuf_t *buf);
+void                     postUdpWrite(udpsock_t *socket_io, wid_t wid_from, const sockaddr_u *peer_addr, sbuf_t *buf);
@@ -0,0 +1,184 @@
+#include "ip_prefix_set.h"
+
+enum
+{
+    kStrideBits   = 8,
+    kStrideSlots  = 1 << kStrideBits,
+    kV4Levels     = 4,
+    kV6Levels     = 16,
+    kInitialNodes = 16
+};
+
+// slot encoding: 0 nothing, 1 covered by a range, anything else is the index of the child node + 2
+enum
+{
+    kSlotEmpty     = 0,
+    kSlotMatch     = 1,
+    kSlotChildBase = 2
+};
+
+typedef uint32_t prefix_node_t[kStrideSlots];
+
+typedef struct prefix_trie_s
+{
+    prefix_node_t *nodes;
+    uint32_t       nodes_count;
+    uint32_t       nodes_cap;
+    bool           match_all; // a /0 was inserted
+} prefix_trie_t;
+
+struct ip_prefix_set_s
+{
+    prefix_trie_t v4;
+    prefix_trie_t v6;
+};
+
+ip_prefix_set_t *ipprefixsetCreate(void)
+{
+    ip_prefix_set_t *set = memoryAllocate(sizeof(ip_prefix_set_t));
+    memorySet(set, 0, sizeof(ip_prefix_set_t));
+    return set;
+}
+
+void ipprefixsetDestroy(ip_prefix_set_t *set)
+{
+    if (set->v4.nodes)
+    {
+        memoryFree(set->v4.nodes);
+    }
+    if (set->v6.nodes)
+    {
+        memoryFree(set->v6.nodes);
+    }
+    memoryFree(set);
+}
+
+static uint32_t trieNewNode(prefix_trie_t *trie)
+{
+    if (trie->nodes_count == trie->nodes_cap)
+    {
+        trie->nodes_cap = trie->nodes_cap == 0 ? kInitialNodes : trie->nodes_cap * 2;
+        trie->nodes     = memoryReAllocate(trie->nodes, sizeof(prefix_node_t) * trie->nodes_cap);
+    }
+    memorySet(trie->nodes[trie->nodes_count], 0, sizeof(prefix_node_t));
+    return trie->nodes_count++;
+}
+
+static void trieInsert(prefix_trie_t *trie, const uint8_t *bytes, unsigned int prefix_len)
+{
+    if (prefix_len == 0)
+    {
+        trie->match_all = true;
+        return;
+    }
+    if (trie->nodes_count == 0)
+    {
+        trieNewNode(trie);
+    }
+
+    uint32_t     node  = 0;
+    unsigned int level = 0;
+    while (prefix_len > (level + 1) * kStrideBits)
+    {
+        uint32_t slot = trie->nodes[node][bytes[level]];
+        if (slot == kSlotMatch)
+        {
+            // a shorter range already covers this one
+            return;
+        }
+        if (slot == kSlotEmpty)
+        {
+            // NOTE: trieNewNode may move the nodes array, index it again afterwards
+            uint32_t child                   = trieNewNode(trie);
+            trie->nodes[node][bytes[level]] = child + kSlotChildBase;
+            node                             = child;
+        }
+        else
+        {
+            node = slot - kSlotChildBase;
+        }
+        level++;
+    }
+
+    // expand the remaining 1..8 bits to every slot they cover, a subtree under these slots is now redundant
+    unsigned int span  = 1U << ((level + 1) * kStrideBits - prefix_len);
+    unsigned int first = bytes[level] & ~(span - 1) & (kStrideSlots - 1);
+    for (unsigned int i = first; i < first + span; i++)
+    {
+        trie->nodes[node][i] = kSlotMatch;
+    }
+}
+
+static bool trieContains(const prefix_trie_t *trie, const uint8_t *bytes, unsigned int levels)
+{
+    if (trie->match_all)
+    {
+        return true;
+    }
+    if (trie->nodes_count == 0)
+    {
+        return false;
+    }
+    uint32_t node = 0;
+    for (unsigned int level = 0; level < levels; level++)
+    {
+        uint32_t slot = trie->nodes[node][bytes[level]];
+        if (slot == kSlotEmpty)
+        {
+            return false;
+        }
+        if (slot == kSlotMatch)
+        {
+            return true;
+        }
+        node = slot - kSlotChildBase;
+    }
+    return false;
+}
+
+static unsigned int maskBitsCount(const uint32_t *words, unsigned int count)
+{
+    unsigned int bits = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        bits += (unsigned int) __builtin_popcount(words[i]);
+    }
+    return bits;
+}
+
+void ipprefixsetInsert(ip_prefix_set_t *set, const ipmask_t *range)
+{
+    if (IP_IS_V4_VAL(range->ip))
+    {
+        uint32_t     addr       = range->ip.u_addr.ip4.addr;
+        unsigned int prefix_len = maskBitsCount(&range->mask.u_addr.ip4.addr, 1);
+        trieInsert(&set->v4, (const uint8_t *) &addr, prefix_len);
+    }
+    else
+    {
+        unsigned int prefix_len = IP_IS_V6_VAL(range->mask) ? maskBitsCount(range->mask.u_addr.ip6.addr, 4)
+                                                            : maskBitsCount(&range->mask.u_addr.ip4.addr, 1);
+        trieInsert(&set->v6, (const uint8_t *) range->ip.u_addr.ip6.addr, prefix_len);
+    }
+}
+
+bool ipprefixsetContains(const ip_prefix_set_t *set, const ip_addr_t *addr)
+{
+    if (IP_IS_V4(addr))
+    {
+        return trieContains(&set->v4, (const uint8_t *) &addr->u_addr.ip4.addr, kV4Levels);
+    }
+
+    const uint8_t *bytes = (const uint8_t *) addr->u_addr.ip6.addr;
+    static const uint8_t kV4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+    if (memoryCompare(bytes, kV4MappedPrefix, sizeof(kV4MappedPrefix)) == 0)
+    {
+        return trieContains(&set->v4, bytes + sizeof(kV4MappedPrefix), kV4Levels);
+    }
+    return trieContains(&set->v6, bytes, kV6Levels);
+}
+
+uint32_t ipprefixsetNodesCount(const ip_prefix_set_t *set)
+{
+    return set->v4.nodes_count + set->v6.nodes_count;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "wlibc.h"
+#include "wsocket.h"
+
+/*
+    ip_prefix_set_t is a longest prefix match table for ipv4 and ipv6 ranges (whitelist, blacklist, ...)
+
+    each family is a multibit trie with a stride of 8 bits, prefixes are expanded to the stride when inserted
+    so a lookup is at most 4 (ipv4) or 16 (ipv6) array loads and does not depend on how many ranges are in the set
+
+    the set is built once (at startup) and is read only afterwards, lookups need no locking
+*/
+
+typedef struct ip_prefix_set_s ip_prefix_set_t;
+
+ip_prefix_set_t *ipprefixsetCreate(void);
+void             ipprefixsetDestroy(ip_prefix_set_t *set);
+
+// prefix length is taken from the mask, ipmask_t as filled by parseIPWithSubnetMask
+void ipprefixsetInsert(ip_prefix_set_t *set, const ipmask_t *range);
+
+// v4 mapped ipv6 addresses (::ffff:a.b.c.d) are looked up as ipv4
+bool ipprefixsetContains(const ip_prefix_set_t *set, const ip_addr_t *addr);
+
+// number of trie nodes (1KB each), for logging
+uint32_t ipprefixsetNodesCount(const ip_prefix_set_t *set);
@@ -1,4 +1,7 @@
 #include "socket_filter_option.h"
+#include "loggers/internal_logger.h"
+#include "managers/data/ipranges.h"
+#include "utils/json_helpers.h"
 
 void socketfilteroptionInit(socket_filter_option_t *sfo)
 {
@@ -13,4 +16,78 @@ void socketfilteroptionDeInit(socket_filter_option_t *sfo)
 {
     vec_ipmask_t_drop(&sfo->white_list);
     vec_ipmask_t_drop(&sfo->black_list);
+    if (sfo->white_set)
+    {
+        ipprefixsetDestroy(sfo->white_set);
+        sfo->white_set = NULL;
+    }
+    if (sfo->black_set)
+    {
+        ipprefixsetDestroy(sfo->black_set);
+        sfo->black_set = NULL;
+    }
+}
+
+bool socketfilteroptionAddIpRange(vec_ipmask_t *list, char *range)
+{
+    ipmask_t ipmask;
+
+    if (range[0] == '@')
+    {
+        unsigned int length = 0;
+        const char **ranges = iprangesFindByName(range + 1, &length);
+        if (ranges == NULL)
+        {
+            LOGE("SocketFilterOption: there is no bundled ip range set named \"%s\"", range + 1);
+            return false;
+        }
+        for (unsigned int i = 0; i < length; i++)
+        {
+            if (parseIPWithSubnetMask(ranges[i], &(ipmask.ip), &(ipmask.mask)) == ERR_ARG)
+            {
+                LOGW("SocketFilterOption: skipped invalid range \"%s\" of the \"%s\" set", ranges[i], range + 1);
+                continue;
+            }
+            vec_ipmask_t_push(list, ipmask);
+        }
+        return true;
+    }
+
+    if (! verifyIPCdir(range) || parseIPWithSubnetMask(range, &(ipmask.ip), &(ipmask.mask)) == ERR_ARG)
+    {
+        return false;
+    }
+    vec_ipmask_t_push(list, ipmask);
+    return true;
+}
+
+void socketfilteroptionParseIpRangeList(vec_ipmask_t *list, const cJSON *settings, const char *field,
+                                        const char *node_name)
+{
+    const cJSON *jlist = cJSON_GetObjectItemCaseSensitive(settings, field);
+    if (! cJSON_IsArray(jlist))
+    {
+        return;
+    }
+
+    int          i         = 0;
+    const cJSON *list_item = NULL;
+    cJSON_ArrayForEach(list_item, jlist)
+    {
+        char *ip_str = NULL;
+
+        if (! getStringFromJson(&(ip_str), list_item))
+        {
+            LOGF("JSON Error: %s->settings->%s (array of strings field) index %d : The data was empty or invalid",
+                 node_name, field, i);
+            terminateProgram(1);
+        }
+        if (! socketfilteroptionAddIpRange(list, ip_str))
+        {
+            LOGF("%s: stopping due to %s address [%d] \"%s\" parse failure", node_name, field, i, ip_str);
+            terminateProgram(1);
+        }
+        memoryFree(ip_str);
+        i++;
+    }
 }
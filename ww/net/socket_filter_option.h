@@ -1,6 +1,8 @@
 #pragma once
 
 #include "net/address_context.h"
+#include "net/ip_prefix_set.h"
+#include "cJSON.h"
 #include "widle_table.h"
 #include "wlibc.h"
 #include "wsocket.h"
@@ -35,15 +37,31 @@ typedef struct socket_filter_option_s
     uint16_t            port_max;
     bool                fast_open;
     bool                no_delay;
+    bool                udp_gro; // udp only, see wioEnableUdpGro
+    bool                udp_gso; // udp only, see wioEnableUdpGso
+    bool                reuse_port;   // single port only, every worker owns a SO_REUSEPORT socket
+    bool                incoming_cpu; // with reuse_port, pin each worker listener to a cpu with SO_INCOMING_CPU
     unsigned int        balance_group_interval;
 
     vec_ipmask_t white_list;
     vec_ipmask_t black_list;
     // Internal use
 
+    // built from the lists by socketacceptorRegister
+    ip_prefix_set_t *white_set;
+    ip_prefix_set_t *black_set;
+
     widle_table_t *shared_balance_table;
 
 } socket_filter_option_t;
 
 void socketfilteroptionInit(socket_filter_option_t *sfo);
 void socketfilteroptionDeInit(socket_filter_option_t *sfo);
+
+// range is "ip/prefix" or "@name" of a bundled range set (managers/data/ipranges.h), false if it is not valid
+bool socketfilteroptionAddIpRange(vec_ipmask_t *list, char *range);
+
+// adds every entry of the settings->field array of ranges to list, terminates on an invalid entry
+// node_name: names the node in the error logs, e.g. "TcpListener"
+void socketfilteroptionParseIpRangeList(vec_ipmask_t *list, const cJSON *settings, const char *field,
+                                        const char *node_name);